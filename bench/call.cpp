@@ -0,0 +1,64 @@
+/******************************************************************************
+ * Benchmark for calls of small Lisp functions from C++.
+ *
+ * The callback (lambda (x y) (+ x y)) is called n times through
+ * Vm::eval with cells and through Vm::call<R> with C++ values.
+ * Reports nanoseconds per call.
+ ******************************************************************************/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <lpp/core/vm.h>
+#include <lpp/core/types/function.h>
+#include <lpp/scheme/language.h>
+
+using Vm = Lisp::Vm;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+using Language = Lisp::Scheme::Language;
+
+template<typename F>
+static double nsPerCall(std::size_t n, F func)
+{
+  auto start = std::chrono::steady_clock::now();
+  func();
+  auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() / n;
+}
+
+int main(int argc, const char ** argv)
+{
+  std::size_t n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (define add (lambda (x y) (+ x y)))
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("add"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("x"),
+                                                vm.make<Symbol>("y")),
+                                        vm.list(vm.make<Symbol>("+"),
+                                                vm.make<Symbol>("x"),
+                                                vm.make<Symbol>("y"))))));
+  Object add = vm.find("add");
+  UIntegerType sum = 0;
+  double evalNs = nsPerCall(n, [&]() {
+      for(std::size_t i = 0; i < n; i++)
+      {
+        sum += vm.eval(add, Cell(UIntegerType(i)), Cell(UIntegerType(1))).as<UIntegerType>();
+      }
+  });
+  double callNs = nsPerCall(n, [&]() {
+      for(std::size_t i = 0; i < n; i++)
+      {
+        sum += vm.call<UIntegerType>(add, i, 1);
+      }
+  });
+  std::cout << "calls:     " << n << " (checksum " << sum << ")" << std::endl;
+  std::cout << "eval:      " << evalNs << " ns/call" << std::endl;
+  std::cout << "call<R>:   " << callNs << " ns/call" << std::endl;
+  return 0;
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+ * Call-heavy benchmark for the instruction dispatch of Continuation::eval.
+ *
+ * Evaluates a binary tree of nested function calls
+ * (second (second ... ...) (second ... ...))
+ * and reports the time per call.
+ * Build with -DTHREADED_DISPATCH=OFF to measure the switch dispatch.
+ ******************************************************************************/
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <lpp/core/config.h>
+#include <lpp/core/vm.h>
+#include <lpp/core/types/function.h>
+#include <lpp/scheme/language.h>
+
+using Vm = Lisp::Vm;
+using Object = Lisp::Object;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+using Language = Lisp::Scheme::Language;
+
+static Object callTree(Vm & vm, std::size_t depth, std::size_t & calls)
+{
+  if(depth == 0)
+  {
+    return vm.make<UIntegerType>(1);
+  }
+  calls++;
+  Object a = callTree(vm, depth - 1, calls);
+  Object b = callTree(vm, depth - 1, calls);
+  return vm.list(vm.make<Symbol>("second"), a, b);
+}
+
+int main(int argc, const char ** argv)
+{
+  std::size_t depth = argc > 1 ? std::atoi(argv[1]) : 12;
+  std::size_t repeat = argc > 2 ? std::atoi(argv[2]) : 200;
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (define second (lambda (a b) b))
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("second"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("a"),
+                                                vm.make<Symbol>("b")),
+                                        vm.make<Symbol>("b")))));
+  std::size_t calls = 0;
+  Object func = lang->compile(callTree(vm, depth, calls));
+  auto start = std::chrono::steady_clock::now();
+  for(std::size_t i = 0; i < repeat; i++)
+  {
+    vm.eval(func);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+#ifdef DO_THREADED_DISPATCH
+  std::cout << "dispatch: threaded" << std::endl;
+#else
+  std::cout << "dispatch: switch" << std::endl;
+#endif
+  std::cout << "calls:    " << (calls * repeat) << std::endl;
+  std::cout << "time:     " << (ns / 1e6) << " ms" << std::endl;
+  std::cout << "ns/call:  " << (ns / (calls * repeat)) << std::endl;
+  if(Lisp::Instrumentation::enabled)
+  {
+    vm.getInstrumentation().dump(std::cout);
+  }
+  return 0;
+}
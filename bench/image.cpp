@@ -0,0 +1,118 @@
+/******************************************************************************
+ * Startup benchmark for bytecode images.
+ *
+ * Compiles n definitions
+ * (define fi (lambda (a b) ((lambda (c) (cons c (f<i-1> b a))) a)))
+ * with Language::compile, writes them to an image and reports the time
+ * of compiling the sources and of loading the image into a new vm.
+ ******************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <lpp/core/vm.h>
+#include <lpp/core/image.h>
+#include <lpp/core/env.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/function.h>
+#include <lpp/scheme/language.h>
+
+using Vm = Lisp::Vm;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Symbol = Lisp::Symbol;
+using Cons = Lisp::Cons;
+using Language = Lisp::Scheme::Language;
+
+static Object definition(Vm & vm, std::size_t i)
+{
+  std::string name("f" + std::to_string(i));
+  std::string prev("f" + std::to_string(i ? i - 1 : 0));
+  return vm.list(vm.make<Symbol>("define"),
+                 vm.make<Symbol>(name),
+                 vm.list(vm.make<Symbol>("lambda"),
+                         vm.list(vm.make<Symbol>("a"), vm.make<Symbol>("b")),
+                         vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                         vm.list(vm.make<Symbol>("c")),
+                                         vm.list(vm.make<Symbol>("cons"),
+                                                 vm.make<Symbol>("c"),
+                                                 vm.list(vm.make<Symbol>(prev),
+                                                         vm.make<Symbol>("b"),
+                                                         vm.make<Symbol>("a")))),
+                                 vm.make<Symbol>("a"))));
+}
+
+static long fileSize(const std::string & path)
+{
+  FILE * file = std::fopen(path.c_str(), "rb");
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fclose(file);
+  return size;
+}
+
+int main(int argc, const char ** argv)
+{
+  std::size_t n = argc > 1 ? std::atoi(argv[1]) : 10000;
+  std::string path("/tmp/bench_image_" + std::to_string(getpid()));
+  std::vector<Object> sources;
+  std::vector<Cell> functions;
+  double compileMs;
+  {
+    Vm vm;
+    Object langObj = vm.make<Language>();
+    Language * lang = langObj.as<Language>();
+    for(std::size_t i = 0; i < n; i++)
+    {
+      sources.push_back(definition(vm, i));
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Object> compiled;
+    for(const Object & src : sources)
+    {
+      compiled.push_back(lang->compile(src));
+    }
+    auto stop = std::chrono::steady_clock::now();
+    compileMs = std::chrono::duration<double, std::milli>(stop - start).count();
+    functions.assign(compiled.begin(), compiled.end());
+    Lisp::saveImage(path, functions);
+    functions.clear();
+    sources.clear();
+  }
+  Vm vm;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Object> loaded(Lisp::loadImage(path, *vm.getAllocator()));
+  for(const Object & func : loaded)
+  {
+    vm.eval(func);
+  }
+  auto stop = std::chrono::steady_clock::now();
+  double loadMs = std::chrono::duration<double, std::milli>(stop - start).count();
+  long size = fileSize(path);
+
+  // warm restart: the definitions and a list of 10 * n numbers
+  Object data(Lisp::nil);
+  for(std::size_t i = 0; i < 10 * n; i++)
+  {
+    data = vm.make<Cons>(Object(i), data);
+  }
+  vm.define("data", data);
+  Lisp::saveHeapImage(path, *vm.getEnv());
+  Vm warm;
+  start = std::chrono::steady_clock::now();
+  Lisp::loadHeapImage(path, *warm.getAllocator(), *warm.getEnv());
+  stop = std::chrono::steady_clock::now();
+  double restoreMs = std::chrono::duration<double, std::milli>(stop - start).count();
+  long heapSize = fileSize(path);
+  std::remove(path.c_str());
+  std::cout << "definitions: " << n << std::endl;
+  std::cout << "image size:  " << size << " bytes" << std::endl;
+  std::cout << "compile:     " << compileMs << " ms" << std::endl;
+  std::cout << "load+define: " << loadMs << " ms" << std::endl;
+  std::cout << "heap image:  " << heapSize << " bytes" << std::endl;
+  std::cout << "restore:     " << restoreMs << " ms" << std::endl;
+  return 0;
+}
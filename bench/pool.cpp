@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Throughput benchmark for VmPool.
+ *
+ * A function (lambda (x y) (+ (- x y) (+ x y) ...)) is compiled once
+ * and shared by all workers. Each request evaluates it a number of
+ * times on a worker. Reports requests per second for 1, 2, 4, ...
+ * workers up to the given maximum and the speedup over one worker.
+ ******************************************************************************/
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <lpp/core/vm.h>
+#include <lpp/core/vm_pool.h>
+#include <lpp/core/types/function.h>
+#include <lpp/scheme/language.h>
+
+using Vm = Lisp::Vm;
+using VmPool = Lisp::VmPool;
+using Object = Lisp::Object;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+using Language = Lisp::Scheme::Language;
+
+static Object lambda(Vm & vm, std::size_t terms)
+{
+  Object lst = Lisp::nil;
+  for(std::size_t i = 0; i < terms; i++)
+  {
+    Object term = vm.list(vm.make<Symbol>(i % 2 ? "+" : "-"),
+                          vm.make<Symbol>("x"),
+                          vm.make<Symbol>("y"));
+    lst = vm.make<Lisp::Cons>(term, lst);
+  }
+  return vm.list(vm.make<Symbol>("lambda"),
+                 vm.list(vm.make<Symbol>("x"), vm.make<Symbol>("y")),
+                 vm.make<Lisp::Cons>(vm.make<Symbol>("+"), lst));
+}
+
+int main(int argc, const char ** argv)
+{
+  std::size_t maxThreads = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+  std::size_t requests = argc > 2 ? std::atoi(argv[2]) : 2000;
+  std::size_t evals = argc > 3 ? std::atoi(argv[3]) : 100;
+  std::size_t terms = 32;
+  Vm code;
+  {
+    Object langObj = code.make<Language>();
+    Language * lang = langObj.as<Language>();
+    code.eval(lang->compile(code.list(code.make<Symbol>("define"),
+                                      code.make<Symbol>("work"),
+                                      lambda(code, terms))));
+  }
+  double base = 0;
+  for(std::size_t n = 1; n <= maxThreads; n *= 2)
+  {
+    VmPool pool(code, n);
+    std::vector<std::future<UIntegerType>> results;
+    results.reserve(requests);
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < requests; i++)
+    {
+      results.push_back(pool.submit([evals](Vm & vm) {
+            Object work = vm.find("work");
+            UIntegerType sum = 0;
+            for(std::size_t j = 0; j < evals; j++)
+            {
+              sum += vm.eval(work, Object(Lisp::Cell(UIntegerType(j + 2))),
+                             Object(Lisp::Cell(UIntegerType(1)))).as<UIntegerType>();
+            }
+            return sum;
+          }));
+    }
+    UIntegerType check = 0;
+    for(auto & result : results)
+    {
+      check += result.get();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double s = std::chrono::duration<double>(stop - start).count();
+    double throughput = requests / s;
+    if(n == 1)
+    {
+      base = throughput;
+    }
+    std::cout << "threads: " << n
+              << "  requests/s: " << throughput
+              << "  speedup: " << (throughput / base)
+              << "  (check " << check << ")" << std::endl;
+  }
+  return 0;
+}
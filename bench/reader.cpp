@@ -0,0 +1,80 @@
+/******************************************************************************
+ * Throughput benchmark of the S-expression reader.
+ *
+ * Writes a source file of n definitions
+ * (define fi (lambda (a b) ((lambda (c) (cons c (f<i-1> b a))) a)))
+ * each followed by a quoted data list of numbers and strings, and
+ * reports the throughput in MB/s of reading it from the mapped file
+ * (readFile) and from a file stream (Reader on std::ifstream).
+ ******************************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <lpp/core/vm.h>
+#include <lpp/core/reader.h>
+
+using Vm = Lisp::Vm;
+using Object = Lisp::Object;
+using Reader = Lisp::Reader;
+
+static std::size_t writeSource(const std::string & path, std::size_t n)
+{
+  std::ofstream ost(path);
+  for(std::size_t i = 0; i < n; i++)
+  {
+    ost << "; definition " << i << "\n"
+        << "(define f" << i << "\n"
+        << "  (lambda (a b) ((lambda (c) (cons c (f" << (i ? i - 1 : 0) << " b a))) a)))\n"
+        << "(define data" << i << " '(";
+    for(std::size_t j = 0; j < 10; j++)
+    {
+      ost << (i * 10 + j) << " \"item " << j << "\" ";
+    }
+    ost << "))\n";
+  }
+  return ost.tellp();
+}
+
+template<typename F>
+static double throughput(std::size_t size, std::size_t & count, F read)
+{
+  auto start = std::chrono::steady_clock::now();
+  count = read().size();
+  auto stop = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(stop - start).count();
+  return size / seconds / (1024.0 * 1024.0);
+}
+
+int main(int argc, const char ** argv)
+{
+  std::size_t n = argc > 1 ? std::atoi(argv[1]) : 50000;
+  std::string path("/tmp/bench_reader_" + std::to_string(getpid()));
+  std::size_t size = writeSource(path, n);
+  std::size_t count = 0;
+  double mapped;
+  double stream;
+  {
+    Vm vm;
+    mapped = throughput(size, count, [&vm, &path]() {
+        return Lisp::readFile(path, *vm.getAllocator());
+    });
+  }
+  {
+    Vm vm;
+    stream = throughput(size, count, [&vm, &path]() {
+        std::ifstream ist(path, std::ios::binary);
+        return Reader(*vm.getAllocator(), ist).readAll();
+    });
+  }
+  std::remove(path.c_str());
+  std::cout << "source size: " << size << " bytes" << std::endl;
+  std::cout << "expressions: " << count << std::endl;
+  std::cout << "mapped:      " << mapped << " MB/s" << std::endl;
+  std::cout << "stream:      " << stream << " MB/s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include <lpp/core/builtins.h>
+#include <lpp/core/vm.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+
+using Cell = Lisp::Cell;
+using Object = Lisp::Object;
+using Cons = Lisp::Cons;
+using Vm = Lisp::Vm;
+using Allocator = Lisp::Allocator;
+using BuiltinFunction = Lisp::BuiltinFunction;
+using InstructionType = Lisp::InstructionType;
+
+const std::size_t BuiltinFunction::variadic;
+
+namespace
+{
+  struct PrimitiveEntry
+  {
+    const char * name;
+    InstructionType opcode;
+    std::size_t minArgs;
+    std::size_t maxArgs;
+  };
+
+  static const PrimitiveEntry primitives[] = {
+    {"car",  Lisp::CAR,  1, 1},
+    {"cdr",  Lisp::CDR,  1, 1},
+    {"cons", Lisp::CONS, 2, 2},
+    {"eq?",  Lisp::EQ,   2, 2},
+    {"+",    Lisp::ADD,  0, BuiltinFunction::variadic},
+    {"-",    Lisp::SUB,  1, BuiltinFunction::variadic},
+    {"<",    Lisp::LT,   1, BuiltinFunction::variadic},
+    {"call/cc", Lisp::CALLCC, 1, 1},
+    {"call-with-current-continuation", Lisp::CALLCC, 1, 1}
+  };
+}
+
+InstructionType Lisp::Builtin::primitive(const std::string & name,
+                                         std::size_t nargs)
+{
+  for(const PrimitiveEntry & entry : primitives)
+  {
+    if(name == entry.name)
+    {
+      if(nargs >= entry.minArgs && nargs <= entry.maxArgs)
+      {
+        return entry.opcode;
+      }
+      else
+      {
+        return 0;
+      }
+    }
+  }
+  return 0;
+}
+
+void Lisp::Builtin::define(Vm & vm)
+{
+  vm.define("car", vm.make<BuiltinFunction>(
+                "car",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object(car(args[0]));
+                },
+                1));
+  vm.define("cdr", vm.make<BuiltinFunction>(
+                "cdr",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object(cdr(args[0]));
+                },
+                1));
+  vm.define("cons", vm.make<BuiltinFunction>(
+                "cons",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object(alloc.makeRoot<Cons>(args[0], args[1]));
+                },
+                2));
+  vm.define("eq?", vm.make<BuiltinFunction>(
+                "eq?",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object::boolean(eq(args[0], args[1]));
+                },
+                2));
+  vm.define("+", vm.make<BuiltinFunction>(
+                "+",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object(Cell(add(args, nargs)));
+                },
+                0, BuiltinFunction::variadic));
+  vm.define("-", vm.make<BuiltinFunction>(
+                "-",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object(Cell(sub(args, nargs)));
+                },
+                1, BuiltinFunction::variadic));
+  vm.define("<", vm.make<BuiltinFunction>(
+                "<",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object::boolean(lessThan(args, nargs));
+                },
+                1, BuiltinFunction::variadic));
+  Object yield = vm.make<BuiltinFunction>(
+      "yield",
+      [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+        return Object(Lisp::nil);
+      },
+      0);
+  yield.as<BuiltinFunction>()->setSuspending(true);
+  vm.define("yield", yield);
+  Object callcc = vm.make<BuiltinFunction>(
+      "call/cc",
+      [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+        return Object(Lisp::nil);
+      },
+      1);
+  callcc.as<BuiltinFunction>()->setOpcode(Lisp::CALLCC);
+  vm.define("call/cc", callcc);
+  vm.define("call-with-current-continuation", callcc);
+}
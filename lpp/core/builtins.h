@@ -0,0 +1,174 @@
+#pragma once
+#include <assert.h>
+#include <string>
+#include <lpp/core/cell.h>
+#include <lpp/core/opcode.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/types/cons.h>
+
+namespace Lisp
+{
+  class Vm;
+
+  /**
+   * Builtin functions car, cdr, cons, eq?, +, - and <.
+   * The functions are shared by the BuiltinFunction objects in the
+   * environment and by the primitive opcodes the compiler emits for
+   * direct calls.
+   * (yield) returns nil and suspends the continuation (see Scheduler).
+   * (call/cc f) calls f with the current continuation, it is executed
+   * by the CALLCC instruction (see CapturedContinuation).
+   * Integers are unsigned, + and - wrap around.
+   */
+  namespace Builtin
+  {
+    /**
+     * @throw NotAList
+     */
+    inline const Cell & car(const Cell & cell);
+
+    /**
+     * @throw NotAList
+     */
+    inline const Cell & cdr(const Cell & cell);
+
+    inline BooleanType eq(const Cell & a, const Cell & b);
+
+    /**
+     * @throw NotAnInteger
+     */
+    inline UIntegerType integer(const Cell & cell);
+
+    inline UIntegerType add(const Cell * args, std::size_t nargs);
+    inline UIntegerType sub(const Cell * args, std::size_t nargs);
+    inline BooleanType lessThan(const Cell * args, std::size_t nargs);
+
+    /**
+     * Opcode of the primitive operation that implements a call to
+     * the builtin name with nargs arguments, or 0 if there is none.
+     */
+    InstructionType primitive(const std::string & name, std::size_t nargs);
+
+    /**
+     * Bind all builtin functions in the environment of vm,
+     * except the I/O builtins (see defineIo).
+     */
+    void define(Vm & vm);
+
+    /**
+     * Bind the I/O builtins on file descriptors (see io.cpp):
+     * (read-fd fd n) returns a string of at most n bytes (at most
+     * maxReadSize per call), nil at the end of file, (write-fd fd str)
+     * writes all of str and returns its length, (close-fd fd) closes fd.
+     * Called by a green thread of a Scheduler, read-fd and write-fd
+     * switch fd to non-blocking mode and park the green thread while
+     * the descriptor is not ready; otherwise they block the thread.
+     * O_NONBLOCK is not restored, other green threads may still use fd.
+     * The flag belongs to the open file description, which is shared
+     * with inherited and duplicated descriptors (e.g. stdin of the
+     * parent process): pass descriptors with their own description
+     * (e.g. /dev/stdin reopened) where this matters.
+     * The builtins operate on any descriptor of the host process,
+     * they are not bound by define(): the host calls defineIo for
+     * the Vms that may use them.
+     * @throw IoError (EBADF for descriptors out of the range of int)
+     */
+    void defineIo(Vm & vm);
+
+    /**
+     * Maximum number of bytes of a single read-fd.
+     */
+    static const std::size_t maxReadSize = 65536u;
+  }
+}
+
+inline const Lisp::Cell & Lisp::Builtin::car(const Cell & cell)
+{
+  if(cell.isA<BasicCons>())
+  {
+    return cell.as<BasicCons>()->getCarCell();
+  }
+  else if(cell.isA<Nil>())
+  {
+    return cell;
+  }
+  else
+  {
+    throw NotAList(cell);
+  }
+}
+
+inline const Lisp::Cell & Lisp::Builtin::cdr(const Cell & cell)
+{
+  if(cell.isA<BasicCons>())
+  {
+    return cell.as<BasicCons>()->getCdrCell();
+  }
+  else if(cell.isA<Nil>())
+  {
+    return cell;
+  }
+  else
+  {
+    throw NotAList(cell);
+  }
+}
+
+inline Lisp::BooleanType Lisp::Builtin::eq(const Cell & a, const Cell & b)
+{
+  return a == b;
+}
+
+inline Lisp::UIntegerType Lisp::Builtin::integer(const Cell & cell)
+{
+  if(cell.isA<UIntegerType>())
+  {
+    return cell.as<UIntegerType>();
+  }
+  else
+  {
+    throw NotAnInteger(cell);
+  }
+}
+
+inline Lisp::UIntegerType Lisp::Builtin::add(const Cell * args,
+                                             std::size_t nargs)
+{
+  UIntegerType ret = 0;
+  for(std::size_t i = 0; i < nargs; i++)
+  {
+    ret += integer(args[i]);
+  }
+  return ret;
+}
+
+inline Lisp::UIntegerType Lisp::Builtin::sub(const Cell * args,
+                                             std::size_t nargs)
+{
+  assert(nargs > 0);
+  if(nargs == 1)
+  {
+    return UIntegerType(0) - integer(args[0]);
+  }
+  UIntegerType ret = integer(args[0]);
+  for(std::size_t i = 1; i < nargs; i++)
+  {
+    ret -= integer(args[i]);
+  }
+  return ret;
+}
+
+inline Lisp::BooleanType Lisp::Builtin::lessThan(const Cell * args,
+                                                 std::size_t nargs)
+{
+  assert(nargs > 0);
+  UIntegerType prev = integer(args[0]);
+  BooleanType ret = true;
+  for(std::size_t i = 1; i < nargs; i++)
+  {
+    UIntegerType next = integer(args[i]);
+    ret = ret && prev < next;
+    prev = next;
+  }
+  return ret;
+}
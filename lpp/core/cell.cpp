@@ -7,6 +7,8 @@
 #include <lpp/core/types/symbol.h> //@todo remove reference when functionality is re-implementated polymorphically
 #include <lpp/core/types/reference.h> //@todo remove reference when functionality is re-implementated polymorphically
 #include <lpp/core/types/function.h> //@todo remove reference when functionality is re-implementated polymorphically
+#include <lpp/core/types/closure.h> //@todo remove reference when functionality is re-implementated polymorphically
+#include <lpp/core/types/captured_continuation.h> //@todo remove reference when functionality is re-implementated polymorphically
 
 using Cell = Lisp::Cell;
 using BasicCons = Lisp::BasicCons;
@@ -66,12 +68,28 @@ bool Lisp::Cell::isRoot() const
   if(isA<BasicCons>())
   {
     //@todo fast as (isA is executed twice)
-    as<BasicCons>()->isRoot();
+    return as<BasicCons>()->isRoot();
   }
   else if(isA<Container>())
   {
     //@todo fast as
-    as<Container>()->isRoot();
+    return as<Container>()->isRoot();
+  }
+  else
+  {
+    return false;
+  }
+}
+
+bool Lisp::Cell::isFrozen() const
+{
+  if(isA<BasicCons>())
+  {
+    return as<BasicCons>()->isFrozen();
+  }
+  else if(isA<Container>())
+  {
+    return as<Container>()->isFrozen();
   }
   else
   {
@@ -180,6 +198,15 @@ std::ostream & operator<<(std::ostream & ost, const Lisp::Cell & cell)
   {
     ost << "[Function " << cell.as<Lisp::Function>() << "]";
   }
+  else if(cell.isA<Lisp::Closure>())
+  {
+    ost << "[Closure " << cell.as<Lisp::Closure>() << " "
+        << cell.as<Lisp::Closure>()->getFunction() << "]";
+  }
+  else if(cell.isA<Lisp::CapturedContinuation>())
+  {
+    ost << "[CapturedContinuation " << cell.as<Lisp::CapturedContinuation>() << "]";
+  }
   else if(cell.isA<Lisp::Container>())
   {
     ost << "[Container]";
@@ -210,13 +237,24 @@ bool Cell::operator==(const Lisp::Cell & b) const
   {
     return as<const ::Lisp::Container>() == b.as<const ::Lisp::Container>();
   }
-  else if(isA<::Lisp::Nil>() && b.isA<::Lisp::Nil>())
+  else if(isA<::Lisp::ValueType>() && typeId == b.typeId)
   {
-    return true;
+    if(isA<::Lisp::UIntegerType>())
+    {
+      return data.intValue == b.data.intValue;
+    }
+    else if(isA<::Lisp::BooleanType>())
+    {
+      return data.boolValue == b.data.boolValue;
+    }
+    else
+    {
+      // Nil, Undefined
+      return true;
+    }
   }
   else
   {
-    // @todo more cases
     return false;
   }
 }
@@ -238,13 +276,18 @@ std::size_t Cell::hash() const
     static std::hash<const ::Lisp::Container*> hasher;
     return hasher(as<const ::Lisp::Container>());
   }
-  else if(isA<::Lisp::Nil>())
+  else if(isA<::Lisp::UIntegerType>())
   {
-    return 0u;
+    static std::hash<::Lisp::UIntegerType> hasher;
+    return hasher(data.intValue);
+  }
+  else if(isA<::Lisp::BooleanType>())
+  {
+    return data.boolValue ? 1u : 0u;
   }
   else
   {
-    /* @todo */
+    // Nil, Undefined
     return 0u;
   }
 }
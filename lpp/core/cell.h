@@ -93,17 +93,22 @@ namespace Lisp
     template<typename T>
     inline typename Lisp::TypeTraits<T>::Type as() const;
 
+    /**
+     * Identity comparison (eq?), atoms are compared by value.
+     * See Lisp::equal for structural equality.
+     */
     bool operator==(const Lisp::Cell & b) const;
 
     /**
-     * Hash value of the cell content.
-     * @todo complete for more types
+     * Hash value of the cell content that is consistent with operator==.
+     * See Lisp::equalHash for a hash of the structure.
      */
     size_t hash() const;
 
     /**
      * Operations for Collectible */
     bool isRoot() const;
+    bool isFrozen() const;
     Color getColor() const;
     std::size_t getRefCount() const;
     bool checkIndex() const;
@@ -248,7 +253,7 @@ inline Lisp::Cell& Lisp::Cell::operator=(const Cell & rhs)
   data = rhs.data;
   if(isA<ManagedType>())
   {
-    data.pManaged->refCount++;
+    data.pManaged->incRefCount();
   }
   return *this;
 }
@@ -262,8 +267,8 @@ inline void Lisp::Cell::unset()
 {
   if(TypeTraits<ManagedType>::isA(typeId))
   {
-    assert(data.pManaged->refCount);
-    if(! --data.pManaged->refCount)
+    assert(data.pManaged->getRefCount());
+    if(data.pManaged->decRefCount())
     {
       delete data.pManaged;
       data.pManaged = nullptr;
@@ -291,7 +296,7 @@ inline void Lisp::Cell::initCell(const Cell & rhs)
   data = rhs.data;
   if(rhs.isA<ManagedType>())
   {
-    static_cast<ManagedType*>(data.pManaged)->refCount++;
+    static_cast<ManagedType*>(data.pManaged)->incRefCount();
   }
 }
 
@@ -320,7 +325,7 @@ inline void Lisp::Cell::init(Lisp::ManagedType * obj, Lisp::TypeId _typeId)
 {
   assert(Lisp::TypeTraits<ManagedType>::isA(_typeId));
   typeId = _typeId;
-  obj->refCount++;
+  obj->incRefCount();
   data.pManaged = obj;
 }
 
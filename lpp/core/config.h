@@ -1,6 +1,21 @@
 #include <iostream>
 
+#ifndef NDEBUG
 #define DO_ASM_LOG
+#endif
+
+// Continuation::eval uses direct-threaded dispatch (labels as values)
+// if the compiler supports it. Define NO_THREADED_DISPATCH to use the
+// portable switch dispatch.
+#if defined(__GNUC__) && !defined(NO_THREADED_DISPATCH)
+#define DO_THREADED_DISPATCH
+#endif
+
+// Define INSTRUMENT to count the executed instructions and calls
+// (see instrumentation.h).
+#ifdef INSTRUMENT
+#define DO_INSTRUMENT
+#endif
 
 #ifdef NDEBUG
 #define DEBUG(EXPR)
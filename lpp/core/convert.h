@@ -0,0 +1,124 @@
+#pragma once
+#include <string>
+#include <type_traits>
+#include <lpp/core/object.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/memory/allocator.h>
+#include <lpp/core/types/string.h>
+
+namespace Lisp
+{
+  /**
+   * Conversion of C++ values to cells and of cells to C++ values
+   * (see Vm::call).
+   *   Cell, Object   unchanged
+   *   bool           boolean, every value except #f is true
+   *   integers       UIntegerType
+   *   std::string    String (const char * only to cells)
+   *   void           result is ignored
+   */
+  template<typename T, typename ENABLE = void>
+  struct Convert;
+
+  template<>
+  struct Convert<Cell>
+  {
+    static inline const Cell & toCell(Allocator & alloc, const Cell & value)
+    {
+      return value;
+    }
+
+    static inline Cell fromCell(const Cell & cell)
+    {
+      return cell;
+    }
+  };
+
+  template<>
+  struct Convert<Object>
+  {
+    static inline const Cell & toCell(Allocator & alloc, const Object & value)
+    {
+      return value;
+    }
+
+    static inline Object fromCell(const Cell & cell)
+    {
+      return Object(cell);
+    }
+  };
+
+  template<>
+  struct Convert<bool>
+  {
+    static inline Cell toCell(Allocator & alloc, bool value)
+    {
+      return Object::boolean(value);
+    }
+
+    static inline bool fromCell(const Cell & cell)
+    {
+      return !cell.isA<BooleanType>() || cell.as<BooleanType>();
+    }
+  };
+
+  template<typename T>
+  struct Convert<T, typename std::enable_if<std::is_integral<T>::value &&
+                                            !std::is_same<T, bool>::value>::type>
+  {
+    static inline Cell toCell(Allocator & alloc, T value)
+    {
+      return Cell(UIntegerType(value));
+    }
+
+    /**
+     * @throw NotAnInteger
+     */
+    static inline T fromCell(const Cell & cell)
+    {
+      if(!cell.isA<UIntegerType>())
+      {
+        throw NotAnInteger(cell);
+      }
+      return T(cell.as<UIntegerType>());
+    }
+  };
+
+  template<>
+  struct Convert<std::string>
+  {
+    static inline Object toCell(Allocator & alloc, const std::string & value)
+    {
+      return Object(alloc.makeRoot<String>(value));
+    }
+
+    /**
+     * @throw NotAString
+     */
+    static inline std::string fromCell(const Cell & cell)
+    {
+      if(!cell.isA<String>())
+      {
+        throw NotAString(cell);
+      }
+      return cell.as<String>()->getCString();
+    }
+  };
+
+  template<>
+  struct Convert<const char *>
+  {
+    static inline Object toCell(Allocator & alloc, const char * value)
+    {
+      return Object(alloc.makeRoot<String>(value));
+    }
+  };
+
+  template<>
+  struct Convert<void>
+  {
+    static inline void fromCell(const Cell & cell)
+    {
+    }
+  };
+}
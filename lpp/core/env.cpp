@@ -0,0 +1,3 @@
+#include <lpp/core/env.h>
+
+std::atomic<std::size_t> Lisp::Env::versionCounter(0);
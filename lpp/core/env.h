@@ -30,27 +30,39 @@ either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #pragma once
 #include <assert.h>
+#include <atomic>
 #include <functional>
 #include <memory>
-#include <unordered_map>
+#include <vector>
 #include <lpp/core/cell.h>
 #include <lpp/core/object.h>
 #include <lpp/core/types/symbol.h>
 
 namespace Lisp
 {
+  /**
+   * Global bindings.
+   * Bindings are stored in a flat vector indexed by Symbol::getId(),
+   * a lookup is an index operation without hashing.
+   */
   class Env
   {
   public:
+    Env();
+
+    /**
+     * Copy of all bindings with a new version.
+     */
+    Env(const Env & rhs);
 
     /**
      * Defines the variable with symbol sym.
      */
     inline void define(const Cell & sym, const Cell & rhs);
 
-    void set(const Cell & sym, const Object & obj);
-    void set(const Cell & sym, Object && obj);
-    bool unset(Symbol * symb);
+    inline void set(const Cell & sym, const Object & obj);
+    inline void set(const Cell & sym, Object && obj);
+    inline bool unset(Symbol * symb);
 
     /**
      * Find the reference to the object that is assigned to the symbol.
@@ -61,66 +73,170 @@ namespace Lisp
      */
     inline const Object & find(const Cell & symb) const;
 
+    /**
+     * Call func for each bound symbol and its value.
+     */
+    inline void forEach(std::function<void(const Cell & symbol, const Object & value)> func) const;
+
+    /**
+     * Version of the binding table.
+     * A new version is assigned whenever a binding is added or removed.
+     * Versions are unique across all Env instances.
+     * Bindings are stable between versions, modified values are seen
+     * through references returned by find().
+     */
+    inline std::size_t getVersion() const;
+
   private:
-    struct Hash
-    {
-      inline std::size_t operator()(const Cell & object) const;
-    };
+    inline void newVersion();
+    template<typename T>
+    inline void assign(const Cell & sym, T && obj);
 
-    struct Equal
+    struct Binding
     {
-      inline bool operator()(const Cell & lhs,
-                             const Cell & rhs) const;
+      inline Binding();
+      // keeps the symbol (and its id) alive while bound
+      Cell symbol;
+      Object value;
     };
-    std::unordered_map<Cell, Object, Hash, Equal> bindings;
+    std::vector<Binding> bindings;
+    std::size_t version;
+    static std::atomic<std::size_t> versionCounter;
+  };
+
+  /**
+   * Cache of the global variable lookup of a single instruction.
+   * The cached binding is used as long as the env and its version
+   * do not change.
+   */
+  class InlineCache
+  {
+  public:
+    inline InlineCache();
+    inline const Object & find(const Env & env, const Cell & symb);
+  private:
+    const Env * env;
+    std::size_t version;
+    const Object * binding;
   };
 
 } //namespace Lisp
 
-inline std::size_t Lisp::Env::Hash::operator()(const Cell & object) const
+inline Lisp::Env::Binding::Binding() : value(Lisp::undefined)
 {
-  static std::hash<Symbol*> symbolHash;
-  assert(object.isA<Symbol>());
-  return symbolHash(object.as<Symbol>());
 }
 
-inline bool Lisp::Env::Equal::operator()(const Cell & lhs, const Cell & rhs) const
+inline Lisp::Env::Env() : version(++versionCounter)
 {
-  static std::equal_to<Symbol*> symbolEq;
-  assert(lhs.isA<Symbol>());
-  assert(rhs.isA<Symbol>());
-  return symbolEq(lhs.as<Symbol>(), rhs.as<Symbol>());
 }
 
-inline void Lisp::Env::define(const Cell & symb, const Cell & rhs)
+inline Lisp::Env::Env(const Env & rhs)
+  : bindings(rhs.bindings), version(++versionCounter)
+{
+}
+
+inline void Lisp::Env::newVersion()
+{
+  version = ++versionCounter;
+}
+
+template<typename T>
+inline void Lisp::Env::assign(const Cell & symb, T && obj)
 {
   assert(symb.isA<Symbol>());
-  bindings[symb] = rhs;
+  std::size_t id = symb.as<Symbol>()->getId();
+  if(id >= bindings.size())
+  {
+    // moves all bindings
+    bindings.resize(id + 1);
+  }
+  Binding & binding(bindings[id]);
+  if(binding.symbol.isA<Nil>())
+  {
+    binding.symbol = symb;
+    newVersion();
+  }
+  assert(binding.symbol.as<Symbol>() == symb.as<Symbol>());
+  binding.value = std::forward<T>(obj);
+}
+
+inline void Lisp::Env::define(const Cell & symb, const Cell & rhs)
+{
+  assign(symb, rhs);
 }
 
 inline void Lisp::Env::set(const Cell & symb, const Object & obj)
 {
-  bindings[symb] = obj;
+  assign(symb, obj);
 }
 
 inline void Lisp::Env::set(const Cell & symb, Object && obj)
 {
-  bindings[symb] = obj;
+  assign(symb, std::move(obj));
 }
 
+inline bool Lisp::Env::unset(Symbol * symb)
+{
+  std::size_t id = symb->getId();
+  if(id < bindings.size() && !bindings[id].symbol.isA<Nil>())
+  {
+    bindings[id].symbol = Lisp::nil;
+    bindings[id].value = Lisp::undefined;
+    newVersion();
+    return true;
+  }
+  else
+  {
+    return false;
+  }
+}
 
 inline const Lisp::Object & Lisp::Env::find(const Cell & obj) const
 {
   // @toto Exception
   assert(obj.isA<Symbol>());
-  auto itr = bindings.find(obj);
-  if(itr == bindings.end())
+  std::size_t id = obj.as<Symbol>()->getId();
+  if(id < bindings.size())
+  {
+    // unbound slots are Lisp::undefined
+    return bindings[id].value;
+  }
+  else
   {
     // @todo exception
     return Lisp::undefined;
   }
-  else
+}
+
+inline void Lisp::Env::forEach(std::function<void(const Cell & symbol, const Object & value)> func) const
+{
+  for(const Binding & binding : bindings)
+  {
+    if(!binding.symbol.isA<Nil>())
+    {
+      func(binding.symbol, binding.value);
+    }
+  }
+}
+
+inline std::size_t Lisp::Env::getVersion() const
+{
+  return version;
+}
+
+inline Lisp::InlineCache::InlineCache()
+  : env(nullptr), version(0), binding(nullptr)
+{
+}
+
+inline const Lisp::Object & Lisp::InlineCache::find(const Env & _env,
+                                                     const Cell & symb)
+{
+  if(env != &_env || version != _env.getVersion())
   {
-    return itr->second;
+    binding = &_env.find(symb);
+    env = &_env;
+    version = _env.getVersion();
   }
+  return *binding;
 }
@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include <lpp/core/equal.h>
+#include <lpp/core/cell.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/array.h>
+#include <lpp/core/types/string.h>
+#include <lpp/core/memory/allocator.h>
+
+using Cell = Lisp::Cell;
+using BasicCons = Lisp::BasicCons;
+using Array = Lisp::Array;
+using String = Lisp::String;
+using ManagedType = Lisp::ManagedType;
+using Collectible = Lisp::Collectible;
+using UIntegerType = Lisp::UIntegerType;
+using BooleanType = Lisp::BooleanType;
+using Allocator = Lisp::Allocator;
+
+// number of compared container pairs before cycle detection is enabled,
+// depth and number of hashed containers before equalHash detects cycles
+// and memoizes shared nodes
+static const std::size_t cycleCheckThreshold = 1024u;
+
+namespace
+{
+  struct PairHash
+  {
+    inline std::size_t operator()(const std::pair<const void*, const void*> & p) const
+    {
+      static std::hash<const void*> hasher;
+      return hasher(p.first) * 31u + hasher(p.second);
+    }
+  };
+
+  inline std::size_t combine(std::size_t h, std::size_t v)
+  {
+    return h ^ (v + 0x9e3779b97f4a7c15u + (h << 6) + (h >> 2));
+  }
+
+  inline const void * identity(const Cell & cell)
+  {
+    if(cell.isA<BasicCons>())
+    {
+      return cell.as<BasicCons>();
+    }
+    else
+    {
+      return cell.as<Lisp::Container>();
+    }
+  }
+}
+
+bool Lisp::equal(const Cell & a, const Cell & b)
+{
+  std::vector<std::pair<const Cell*, const Cell*>> todo;
+  std::unordered_set<std::pair<const void*, const void*>, PairHash> visited;
+  std::size_t numPairs = 0;
+  todo.emplace_back(&a, &b);
+  while(!todo.empty())
+  {
+    const Cell & x = *todo.back().first;
+    const Cell & y = *todo.back().second;
+    todo.pop_back();
+    if(x.getTypeId() != y.getTypeId())
+    {
+      return false;
+    }
+    if(x == y)
+    {
+      continue;
+    }
+    if(x.isA<String>())
+    {
+      if(!x.as<String>()->equal(*y.as<String>()))
+      {
+        return false;
+      }
+    }
+    else if(x.isA<BasicCons>() || x.isA<Array>())
+    {
+      if(++numPairs > cycleCheckThreshold &&
+         !visited.insert(std::make_pair(identity(x), identity(y))).second)
+      {
+        // pair is already being compared: assume equality
+        continue;
+      }
+      if(x.isA<BasicCons>())
+      {
+        todo.emplace_back(&x.as<BasicCons>()->getCdrCell(),
+                          &y.as<BasicCons>()->getCdrCell());
+        todo.emplace_back(&x.as<BasicCons>()->getCarCell(),
+                          &y.as<BasicCons>()->getCarCell());
+      }
+      else
+      {
+        const Array * ax = x.as<Array>();
+        const Array * ay = y.as<Array>();
+        if(ax->size() != ay->size())
+        {
+          return false;
+        }
+        for(std::size_t i = ax->size(); i > 0; i--)
+        {
+          todo.emplace_back(&ax->atCell(i - 1), &ay->atCell(i - 1));
+        }
+      }
+    }
+    else
+    {
+      // atoms that are not identical and objects with identity semantics
+      return false;
+    }
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// equalHash
+//
+////////////////////////////////////////////////////////////////////////////////
+namespace
+{
+  using Visitor = std::function<void(const Cell &, std::size_t, bool)>;
+
+  /**
+   * Post order traversal of an acyclic structure. The traversal is
+   * aborted when a cycle is detected, which is possible only when the
+   * depth exceeds cycleCheckThreshold.
+   */
+  class StructuralHash
+  {
+  public:
+    StructuralHash(const Visitor & _visit) : visit(_visit), numNodes(0), checkPath(false)
+    {
+    }
+
+    // @return false if a cycle is reachable from cell
+    bool operator()(const Cell & cell, std::size_t & h);
+
+  private:
+    enum class Step { Value, Pushed, Cycle };
+
+    struct Frame
+    {
+      const Cell * cell;
+      std::size_t next;
+      std::size_t h;
+    };
+
+    Step enter(const Cell & cell, std::size_t & h);
+    const Cell * nextChild(Frame & frame) const;
+    void leave(std::size_t & h);
+    void abort();
+
+    const Visitor & visit;
+    std::vector<Frame> stack;
+    std::unordered_set<const void*> path;
+    std::unordered_map<const void*, std::size_t> memo;
+    std::size_t numNodes;
+    bool checkPath;
+  };
+
+  inline bool getFrozenHash(const Cell & cell, std::size_t & h, bool & cyclic)
+  {
+    if(cell.isA<BasicCons>())
+    {
+      const BasicCons * cons = cell.as<BasicCons>();
+      return cons->isFrozen() &&
+        cons->getAllocator()->getFrozenHash(cons, h, cyclic);
+    }
+    else
+    {
+      const Array * arr = cell.as<Array>();
+      return arr->isFrozen() &&
+        arr->getAllocator()->getFrozenHash(arr, h, cyclic);
+    }
+  }
+}
+
+bool StructuralHash::operator()(const Cell & cell, std::size_t & h)
+{
+  Step step = enter(cell, h);
+  if(step == Step::Cycle)
+  {
+    return false;
+  }
+  while(!stack.empty())
+  {
+    const Cell * child = nextChild(stack.back());
+    if(child)
+    {
+      std::size_t v;
+      step = enter(*child, v);
+      if(step == Step::Cycle)
+      {
+        abort();
+        return false;
+      }
+      else if(step == Step::Value)
+      {
+        stack.back().h = combine(stack.back().h, v);
+      }
+    }
+    else
+    {
+      leave(h);
+    }
+  }
+  return true;
+}
+
+StructuralHash::Step StructuralHash::enter(const Cell & cell, std::size_t & h)
+{
+  h = combine(0u, cell.getTypeId());
+  if(cell.isA<String>())
+  {
+    h = combine(h, cell.as<String>()->hash());
+    return Step::Value;
+  }
+  else if(!cell.isA<BasicCons>() && !cell.isA<Array>())
+  {
+    h = combine(h, cell.hash());
+    return Step::Value;
+  }
+  bool cyclic;
+  if(getFrozenHash(cell, h, cyclic))
+  {
+    return cyclic ? Step::Cycle : Step::Value;
+  }
+  const void * id = identity(cell);
+  if(!memo.empty())
+  {
+    auto itr = memo.find(id);
+    if(itr != memo.end())
+    {
+      h = itr->second;
+      return Step::Value;
+    }
+  }
+  if(checkPath && !path.insert(id).second)
+  {
+    return Step::Cycle;
+  }
+  if(cell.isA<Array>())
+  {
+    h = combine(h, cell.as<Array>()->size());
+  }
+  stack.push_back(Frame{&cell, 0u, h});
+  if(!checkPath && stack.size() > cycleCheckThreshold)
+  {
+    // only a cycle leads to unbounded depth
+    checkPath = true;
+    for(const Frame & frame : stack)
+    {
+      if(!path.insert(identity(*frame.cell)).second)
+      {
+        return Step::Cycle;
+      }
+    }
+  }
+  return Step::Pushed;
+}
+
+const Cell * StructuralHash::nextChild(Frame & frame) const
+{
+  if(frame.cell->isA<BasicCons>())
+  {
+    const BasicCons * cons = frame.cell->as<BasicCons>();
+    switch(frame.next++)
+    {
+    case 0u: return &cons->getCarCell();
+    case 1u: return &cons->getCdrCell();
+    default: return nullptr;
+    }
+  }
+  else
+  {
+    const Array * arr = frame.cell->as<Array>();
+    return frame.next < arr->size() ? &arr->atCell(frame.next++) : nullptr;
+  }
+}
+
+void StructuralHash::leave(std::size_t & h)
+{
+  const Frame & frame = stack.back();
+  const void * id = identity(*frame.cell);
+  h = frame.h;
+  if(visit)
+  {
+    visit(*frame.cell, h, false);
+  }
+  if(checkPath)
+  {
+    path.erase(id);
+  }
+  if(++numNodes > cycleCheckThreshold)
+  {
+    // a shared node is hashed only once
+    memo.emplace(id, h);
+  }
+  stack.pop_back();
+  if(!stack.empty())
+  {
+    stack.back().h = combine(stack.back().h, h);
+  }
+}
+
+void StructuralHash::abort()
+{
+  // a cycle is reachable from all nodes on the path
+  if(visit)
+  {
+    for(const Frame & frame : stack)
+    {
+      visit(*frame.cell, Lisp::boundedHash(*frame.cell), true);
+    }
+  }
+  stack.clear();
+}
+
+std::size_t Lisp::equalHash(const Cell & cell)
+{
+  return equalHash(cell, Visitor());
+}
+
+std::size_t Lisp::equalHash(const Cell & cell, Visitor visit)
+{
+  std::size_t h;
+  if(StructuralHash(visit)(cell, h))
+  {
+    return h;
+  }
+  bool cyclic;
+  if((cell.isA<BasicCons>() || cell.isA<Array>()) &&
+     getFrozenHash(cell, h, cyclic))
+  {
+    return h;
+  }
+  return boundedHash(cell);
+}
+
+std::size_t Lisp::boundedHash(const Cell & cell)
+
+{
+  std::vector<const Cell*> todo;
+  std::size_t budget = equalHashBudget;
+  std::size_t h = 0u;
+  todo.push_back(&cell);
+  while(!todo.empty() && budget)
+  {
+    const Cell & c = *todo.back();
+    todo.pop_back();
+    budget--;
+    h = combine(h, c.getTypeId());
+    if(c.isA<String>())
+    {
+      h = combine(h, c.as<String>()->hash());
+    }
+    else if(c.isA<BasicCons>())
+    {
+      todo.push_back(&c.as<BasicCons>()->getCdrCell());
+      todo.push_back(&c.as<BasicCons>()->getCarCell());
+    }
+    else if(c.isA<Array>())
+    {
+      const Array * arr = c.as<Array>();
+      h = combine(h, arr->size());
+      std::size_t n = std::min(arr->size(), budget);
+      for(std::size_t i = n; i > 0; i--)
+      {
+        todo.push_back(&arr->atCell(i - 1));
+      }
+    }
+    else
+    {
+      h = combine(h, c.hash());
+    }
+  }
+  return h;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace Lisp
+{
+  class Cell;
+
+  /**
+   * Structural equality (equal?).
+   * Conses and arrays are compared element-wise, strings by content.
+   * Atoms are compared by value, all other objects by identity.
+   * The traversal is iterative and terminates on cyclic structures.
+   */
+  bool equal(const Cell & a, const Cell & b);
+
+  /**
+   * Hash value that is consistent with Lisp::equal:
+   * equal(a, b) implies equalHash(a) == equalHash(b).
+   * The hash covers the whole structure, so it takes linear time in
+   * the size of a mutable key. Frozen conses and arrays cache their
+   * hash (see Allocator::freeze), which makes hashing them O(1).
+   * Cyclic structures are hashed by boundedHash.
+   */
+  std::size_t equalHash(const Cell & cell);
+
+  /**
+   * Hash of the first equalHashBudget nodes of the (infinite) tree
+   * that is unfolded from cell. Consistent with Lisp::equal also for
+   * cyclic structures, but long keys with a common prefix collide.
+   */
+  std::size_t boundedHash(const Cell & cell);
+
+  static const std::size_t equalHashBudget = 64u;
+
+  /**
+   * Compute equalHash(cell) and call visit(node, hash, cyclic) for the
+   * conses and arrays whose hash is determined by the traversal: in post
+   * order for acyclic nodes, with the boundedHash of the nodes from which
+   * a cycle is reachable. Used by Allocator::freeze to cache the hashes.
+   */
+  std::size_t equalHash(const Cell & cell,
+                        std::function<void(const Cell & node,
+                                           std::size_t hash,
+                                           bool cyclic)> visit);
+
+  /**
+   * Functors for hash tables that are keyed on structured data, e.g.
+   * std::unordered_map<Object, Object, Lisp::EqualHash, Lisp::EqualTo>
+   */
+  struct EqualHash
+  {
+    inline std::size_t operator()(const Cell & cell) const
+    {
+      return equalHash(cell);
+    }
+  };
+
+  struct EqualTo
+  {
+    inline bool operator()(const Cell & a, const Cell & b) const
+    {
+      return equal(a, b);
+    }
+  };
+}
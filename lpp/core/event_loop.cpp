@@ -0,0 +1,158 @@
+#include <cerrno>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <lpp/core/event_loop.h>
+#include <lpp/core/exception.h>
+
+using EventLoop = Lisp::EventLoop;
+using IoError = Lisp::IoError;
+
+namespace
+{
+  const int maxEvents = 64;
+}
+
+EventLoop::EventLoop() : pending(0)
+{
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  if(epfd < 0)
+  {
+    throw IoError("epoll_create1", errno);
+  }
+}
+
+EventLoop::~EventLoop()
+{
+  close(epfd);
+}
+
+void EventLoop::wait(int fd, Event event, Callback callback)
+{
+  Waiters & w(waiters[fd]);
+  std::deque<Callback> & queue(event == Readable ? w.readers : w.writers);
+  queue.push_back(std::move(callback));
+  try
+  {
+    update(fd, w);
+  }
+  catch(...)
+  {
+    queue.pop_back();
+    if(w.events == 0)
+    {
+      waiters.erase(fd);
+    }
+    throw;
+  }
+  ++pending;
+}
+
+void EventLoop::forget(int fd)
+{
+  auto itr = waiters.find(fd);
+  if(itr != waiters.end())
+  {
+    for(Callback & callback : itr->second.readers)
+    {
+      ready.push_back(std::move(callback));
+    }
+    for(Callback & callback : itr->second.writers)
+    {
+      ready.push_back(std::move(callback));
+    }
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    waiters.erase(itr);
+  }
+}
+
+std::size_t EventLoop::poll(int timeout)
+{
+  if(pending == 0)
+  {
+    return 0;
+  }
+  if(pending > ready.size())
+  {
+    epoll_event events[maxEvents];
+    int n = epoll_wait(epfd, events, maxEvents, ready.empty() ? timeout : 0);
+    if(n < 0 && errno != EINTR)
+    {
+      throw IoError("epoll_wait", errno);
+    }
+    for(int i = 0; i < n; i++)
+    {
+      int fd = events[i].data.fd;
+      auto itr = waiters.find(fd);
+      if(itr == waiters.end())
+      {
+        continue;
+      }
+      Waiters & w(itr->second);
+      std::uint32_t flags = events[i].events;
+      if((flags & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !w.readers.empty())
+      {
+        ready.push_back(std::move(w.readers.front()));
+        w.readers.pop_front();
+      }
+      if((flags & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && !w.writers.empty())
+      {
+        ready.push_back(std::move(w.writers.front()));
+        w.writers.pop_front();
+      }
+      update(fd, w);
+    }
+  }
+  // callbacks that throw leave the remaining ones for the next poll
+  std::size_t called = 0;
+  while(!ready.empty())
+  {
+    Callback callback(std::move(ready.front()));
+    ready.pop_front();
+    --pending;
+    ++called;
+    callback();
+  }
+  return called;
+}
+
+void EventLoop::update(int fd, Waiters & w)
+{
+  std::uint32_t events = ((w.readers.empty() ? 0u : std::uint32_t(EPOLLIN)) |
+                          (w.writers.empty() ? 0u : std::uint32_t(EPOLLOUT)));
+  if(events == w.events)
+  {
+    return;
+  }
+  if(events == 0)
+  {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    waiters.erase(fd);
+    return;
+  }
+  epoll_event ev;
+  ev.events = events;
+  ev.data.u64 = 0;
+  ev.data.fd = fd;
+  int op = w.events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if(epoll_ctl(epfd, op, fd, &ev) != 0)
+  {
+    // the descriptor may have been closed and reused since
+    if(op == EPOLL_CTL_MOD && errno == ENOENT)
+    {
+      op = EPOLL_CTL_ADD;
+    }
+    else if(op == EPOLL_CTL_ADD && errno == EEXIST)
+    {
+      op = EPOLL_CTL_MOD;
+    }
+    else
+    {
+      throw IoError("epoll_ctl", errno);
+    }
+    if(epoll_ctl(epfd, op, fd, &ev) != 0)
+    {
+      throw IoError("epoll_ctl", errno);
+    }
+  }
+  w.events = events;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace Lisp
+{
+  /**
+   * Readiness notifications for file descriptors (epoll).
+   *
+   * A callback waits for a descriptor to become readable or writable
+   * and is called once by poll() when it is. Several callbacks can wait
+   * for the same descriptor, they are called in the order of wait(),
+   * one per event and call of poll(). Callbacks may wait again.
+   * Hang-ups and errors wake up readers and writers.
+   */
+  class EventLoop
+  {
+  public:
+    enum Event { Readable, Writable };
+    using Callback = std::function<void()>;
+
+    /**
+     * @throw IoError
+     */
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop & rhs) = delete;
+    EventLoop & operator=(const EventLoop & rhs) = delete;
+
+    /**
+     * Call callback when fd is ready for event.
+     * @throw IoError
+     */
+    void wait(int fd, Event event, Callback callback);
+
+    /**
+     * Remove fd before it is closed: the callbacks that wait for fd
+     * are called.
+     */
+    void forget(int fd);
+
+    /**
+     * Number of waiting callbacks.
+     */
+    inline std::size_t size() const;
+
+    /**
+     * Wait up to timeout milliseconds (-1: until a descriptor is ready)
+     * and call the callbacks of the ready descriptors.
+     * @return number of callbacks called
+     * @throw IoError
+     */
+    std::size_t poll(int timeout = -1);
+
+  private:
+    struct Waiters
+    {
+      std::deque<Callback> readers;
+      std::deque<Callback> writers;
+      // events registered with epoll, 0: not registered
+      std::uint32_t events = 0;
+    };
+
+    /**
+     * Register the events of the waiting callbacks of fd with epoll,
+     * fd is removed if there are none.
+     */
+    void update(int fd, Waiters & w);
+
+    int epfd;
+    std::size_t pending;
+    std::unordered_map<int, Waiters> waiters;
+    // callbacks of ready descriptors that have not been called yet
+    std::deque<Callback> ready;
+  };
+}
+
+inline std::size_t Lisp::EventLoop::size() const
+{
+  return pending;
+}
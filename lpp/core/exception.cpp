@@ -1,14 +1,23 @@
 #include <assert.h>
+#include <cstring>
 #include <sstream>
 #include <lpp/core/exception.h>
 #include <lpp/core/types/function.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+#include <lpp/core/types/captured_continuation.h>
 
 using Exception = Lisp::Exception;
 using ExceptionWithObject = Lisp::ExceptionWithObject;
 using NonMatchingArguments = Lisp::NonMatchingArguments;
+using InvalidBytecode = Lisp::InvalidBytecode;
+using InvalidImage = Lisp::InvalidImage;
+using ParseError = Lisp::ParseError;
+using IoError = Lisp::IoError;
 using NotAList = Lisp::NotAList;
 using Object = Lisp::Object;
 using Function = Lisp::Function;
+using BuiltinFunction = Lisp::BuiltinFunction;
+using CapturedContinuation = Lisp::CapturedContinuation;
 
 const char * Exception::what() const noexcept
 {
@@ -34,13 +43,132 @@ NonMatchingArguments::NonMatchingArguments(std::size_t _nargs, Function * f)
   : nargs(_nargs), ExceptionWithObject(Cell(f))
 {
   std::stringstream ss;
-  ss << "The function [...] has been called with " << nargs
-     << ((nargs == 1) ? " argument. " : " arguments. ")
-     << "It requires " << f->numArguments()
-     << ((f->numArguments() == 1) ? " argument. " : " arguments. ");
+  ss << "The function " << (f->getName().empty() ? "[...]" : f->getName())
+     << " has been called with " << nargs
+     << ((nargs == 1) ? " argument. " : " arguments. ");
+  if(f->getMaxArguments() == Function::variadic)
+  {
+    ss << "It requires at least " << f->getMinArguments();
+  }
+  else if(f->getMinArguments() == f->getMaxArguments())
+  {
+    ss << "It requires " << f->getMinArguments();
+  }
+  else
+  {
+    ss << "It requires " << f->getMinArguments() << " to "
+       << f->getMaxArguments();
+  }
+  ss << ((f->getMaxArguments() == 1) ? " argument. " : " arguments. ");
   msg = ss.str();
 }
 
+NonMatchingArguments::NonMatchingArguments(std::size_t _nargs,
+                                           const BuiltinFunction * f)
+  : nargs(_nargs), ExceptionWithObject(Cell(const_cast<BuiltinFunction*>(f)))
+{
+  std::stringstream ss;
+  ss << "The function " << f->getName() << " has been called with " << nargs
+     << ((nargs == 1) ? " argument. " : " arguments. ");
+  if(f->getMaxArguments() == BuiltinFunction::variadic)
+  {
+    ss << "It requires at least " << f->getMinArguments();
+  }
+  else if(f->getMinArguments() == f->getMaxArguments())
+  {
+    ss << "It requires " << f->getMinArguments();
+  }
+  else
+  {
+    ss << "It requires " << f->getMinArguments() << " to "
+       << f->getMaxArguments();
+  }
+  ss << ((f->getMaxArguments() == 1) ? " argument. " : " arguments. ");
+  msg = ss.str();
+}
+
+NonMatchingArguments::NonMatchingArguments(std::size_t _nargs,
+                                           const CapturedContinuation * k)
+  : nargs(_nargs),
+    ExceptionWithObject(Cell(const_cast<CapturedContinuation*>(k)))
+{
+  std::stringstream ss;
+  ss << "The continuation [...] has been called with " << nargs
+     << " arguments. It requires 0 or 1 argument.";
+  msg = ss.str();
+}
+
+InvalidBytecode::InvalidBytecode(Function * f, std::size_t _offset,
+                                 const std::string & reason)
+  : ExceptionWithObject(Cell(f)), offset(_offset)
+{
+  std::stringstream ss;
+  ss << "Invalid bytecode at position " << offset << ": " << reason;
+  msg = ss.str();
+}
+
+std::size_t InvalidBytecode::getOffset() const
+{
+  return offset;
+}
+
+const char * InvalidBytecode::what() const noexcept
+{
+  return msg.c_str();
+}
+
+IoError::IoError(const std::string & operation, int _errorNumber)
+  : errorNumber(_errorNumber)
+{
+  msg = operation + ": " + std::strerror(errorNumber);
+}
+
+int IoError::getErrorNumber() const
+{
+  return errorNumber;
+}
+
+const char * IoError::what() const noexcept
+{
+  return msg.c_str();
+}
+
+InvalidImage::InvalidImage(std::size_t _offset, const std::string & reason)
+  : offset(_offset)
+{
+  std::stringstream ss;
+  ss << "Invalid image at position " << offset << ": " << reason;
+  msg = ss.str();
+}
+
+std::size_t InvalidImage::getOffset() const
+{
+  return offset;
+}
+
+const char * InvalidImage::what() const noexcept
+{
+  return msg.c_str();
+}
+
+ParseError::ParseError(std::size_t _offset, const std::string & reason)
+  : offset(_offset)
+{
+  std::stringstream ss;
+  ss << "Parse error at position " << offset << ": " << reason;
+  msg = ss.str();
+}
+
+std::size_t ParseError::getOffset() const
+{
+  return offset;
+}
+
+const char * ParseError::what() const noexcept
+{
+  return msg.c_str();
+}
+
 const Function * NonMatchingArguments::getFunction() const
 {
   assert(getObject().isA<Function>());
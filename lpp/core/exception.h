@@ -6,6 +6,8 @@
 namespace Lisp
 {
   class Function;
+  class BuiltinFunction;
+  class CapturedContinuation;
 
   class Exception : public std::exception
   {
@@ -34,6 +36,181 @@ namespace Lisp
     }
   };
 
+  /**
+   * Attempt to modify an object that has been frozen
+   * with Allocator::freeze().
+   */
+  class FrozenObject : public ExceptionWithObject
+  {
+  public:
+    FrozenObject(const Cell & _cell) : ExceptionWithObject(_cell) {};
+
+    virtual const char * what() const noexcept override
+    {
+      return "FrozenObject";
+    }
+  };
+
+  class NotAnInteger : public ExceptionWithObject
+  {
+  public:
+    NotAnInteger(const Cell & _cell) : ExceptionWithObject(_cell) {};
+
+    virtual const char * what() const noexcept override
+    {
+      return "NotAnInteger";
+    }
+  };
+
+  class NotAString : public ExceptionWithObject
+  {
+  public:
+    NotAString(const Cell & _cell) : ExceptionWithObject(_cell) {};
+
+    virtual const char * what() const noexcept override
+    {
+      return "NotAString";
+    }
+  };
+
+  /**
+   * A value that is called is neither a function, a closure,
+   * a builtin function nor a captured continuation.
+   */
+  class NotAFunction : public ExceptionWithObject
+  {
+  public:
+    NotAFunction(const Cell & _cell) : ExceptionWithObject(_cell) {};
+
+    virtual const char * what() const noexcept override
+    {
+      return "NotAFunction";
+    }
+  };
+
+  /**
+   * Failed system call of an I/O builtin or of the event loop.
+   */
+  class IoError : public Exception
+  {
+  public:
+    IoError(const std::string & operation, int _errorNumber);
+
+    /**
+     * errno of the system call
+     */
+    int getErrorNumber() const;
+    virtual const char * what() const noexcept override;
+  private:
+    int errorNumber;
+    std::string msg;
+  };
+
+  /**
+   * Code rejected by the verifier (see verifier.h).
+   */
+  class InvalidBytecode : public ExceptionWithObject
+  {
+  public:
+    InvalidBytecode(Function * f, std::size_t _offset, const std::string & reason);
+
+    /**
+     * Byte position of the offending instruction
+     */
+    std::size_t getOffset() const;
+    virtual const char * what() const noexcept override;
+  private:
+    std::size_t offset;
+    std::string msg;
+  };
+
+  /**
+   * Malformed bytecode image (see image.h).
+   */
+  class InvalidImage : public Exception
+  {
+  public:
+    InvalidImage(std::size_t _offset, const std::string & reason);
+
+    /**
+     * Byte position in the image
+     */
+    std::size_t getOffset() const;
+    virtual const char * what() const noexcept override;
+  private:
+    std::size_t offset;
+    std::string msg;
+  };
+
+  /**
+   * Malformed S-expression (see reader.h).
+   */
+  class ParseError : public Exception
+  {
+  public:
+    ParseError(std::size_t _offset, const std::string & reason);
+
+    /**
+     * Byte position in the input
+     */
+    std::size_t getOffset() const;
+    virtual const char * what() const noexcept override;
+  private:
+    std::size_t offset;
+    std::string msg;
+  };
+
+  /**
+   * Value that cannot be stored in a bytecode image (see image.h).
+   */
+  class NotSerializable : public ExceptionWithObject
+  {
+  public:
+    NotSerializable(const Cell & _cell) : ExceptionWithObject(_cell) {};
+
+    virtual const char * what() const noexcept override
+    {
+      return "NotSerializable";
+    }
+  };
+
+  /**
+   * The value stack of a continuation exceeds its maximum size.
+   */
+  class StackOverflow : public Exception
+  {
+  public:
+    StackOverflow(std::size_t _maxSize) : maxSize(_maxSize) {};
+
+    std::size_t getMaxSize() const
+    {
+      return maxSize;
+    }
+
+    virtual const char * what() const noexcept override
+    {
+      return "StackOverflow";
+    }
+  private:
+    std::size_t maxSize;
+  };
+
+  /**
+   * The budget or the deadline of an evaluation is exhausted.
+   * The object is the suspended continuation: it can be resumed
+   * after a new budget has been set (see Continuation::setBudget).
+   */
+  class Timeout : public ExceptionWithObject
+  {
+  public:
+    Timeout(const Cell & _cell) : ExceptionWithObject(_cell) {};
+
+    virtual const char * what() const noexcept override
+    {
+      return "Timeout";
+    }
+  };
+
   class IllFormed : public ExceptionWithObject
   {
   public:
@@ -69,10 +246,27 @@ namespace Lisp
     Object symbol;
   };
 
+  /**
+   * A function with captured variables is called without a Closure
+   * that holds their values.
+   */
+  class MissingClosure : public ExceptionWithObject
+  {
+  public:
+    MissingClosure(const Cell & _cell) : ExceptionWithObject(_cell) {};
+
+    virtual const char * what() const noexcept override
+    {
+      return "MissingClosure";
+    }
+  };
+
   class NonMatchingArguments : public ExceptionWithObject
   {
   public:
     NonMatchingArguments(std::size_t nargs, Function * f);
+    NonMatchingArguments(std::size_t nargs, const BuiltinFunction * f);
+    NonMatchingArguments(std::size_t nargs, const CapturedContinuation * k);
     const Function * getFunction() const;
     std::size_t getNumArgumentsGiven() const;
     virtual const char * what() const noexcept override;
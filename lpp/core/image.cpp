@@ -0,0 +1,757 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <lpp/core/image.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/env.h>
+#include <lpp/core/memory/allocator.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/reference.h>
+#include <lpp/core/types/array.h>
+#include <lpp/core/types/closure.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/string.h>
+
+using Cell = Lisp::Cell;
+using Object = Lisp::Object;
+using Allocator = Lisp::Allocator;
+using Function = Lisp::Function;
+using Cons = Lisp::Cons;
+using Reference = Lisp::Reference;
+using Array = Lisp::Array;
+using Closure = Lisp::Closure;
+using BuiltinFunction = Lisp::BuiltinFunction;
+using Env = Lisp::Env;
+using Symbol = Lisp::Symbol;
+using String = Lisp::String;
+using Nil = Lisp::Nil;
+using Undefined = Lisp::Undefined;
+using UIntegerType = Lisp::UIntegerType;
+using BooleanType = Lisp::BooleanType;
+using InvalidImage = Lisp::InvalidImage;
+using NotSerializable = Lisp::NotSerializable;
+
+namespace
+{
+  const char codeMagic[8] = {'L', 'P', 'P', 'I', 'M', 'A', 'G', 'E'};
+  const char heapMagic[8] = {'L', 'P', 'P', 'H', 'E', 'A', 'P', 'I'};
+  const std::uint32_t version = 2;
+
+  // cell encoding: tag followed by the payload
+  enum Tag : std::uint8_t
+  {
+    TAG_NIL = 0,
+    TAG_UNDEFINED,
+    TAG_UINTEGER,   // uint64
+    TAG_BOOLEAN,    // uint8
+    TAG_SYMBOL,     // uint32 symbol index
+    TAG_STRING,     // uint32 length, bytes
+    TAG_OBJECT,     // uint32 object index
+    TAG_BUILTIN     // uint32 length, name (heap images)
+  };
+
+  // object kinds
+  enum Kind : std::uint8_t
+  {
+    KIND_FUNCTION = 0,
+    KIND_CONS,
+    KIND_REFERENCE,
+    KIND_ARRAY,
+    KIND_CLOSURE
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Writer
+  /////////////////////////////////////////////////////////////////////////////
+  class Writer
+  {
+  public:
+    /**
+     * Writes a heap image with the bindings of env if env is not null,
+     * otherwise a code image.
+     */
+    Writer(std::ostream & _ost, const Env * _env = nullptr)
+      : ost(_ost), env(_env)
+    {
+    }
+
+    void write(const std::vector<Cell> & roots)
+    {
+      for(const Cell & root : roots)
+      {
+        if(!env && !root.isA<Function>())
+        {
+          throw NotSerializable(root);
+        }
+        collect(root);
+      }
+      std::vector<std::pair<Cell, Cell>> bindings;
+      if(env)
+      {
+        env->forEach([this, &bindings](const Cell & symbol, const Object & value) {
+            collect(symbol);
+            collect(value);
+            bindings.push_back(std::make_pair(symbol, Cell(value)));
+        });
+      }
+      // objects discovered by collect are appended to the list
+      for(std::size_t i = 0; i < objects.size(); i++)
+      {
+        forEachChild(objects[i], [this](const Cell & c) { collect(c); });
+      }
+
+      ost.write(env ? heapMagic : codeMagic, sizeof(codeMagic));
+      put32(version);
+      put32(symbols.size());
+      put32(objects.size());
+      put32(roots.size());
+      if(env)
+      {
+        put32(bindings.size());
+      }
+      for(const Symbol * symbol : symbols)
+      {
+        putString(symbol->getName());
+      }
+      for(const Cell & obj : objects)
+      {
+        put8(kind(obj));
+        if(obj.isA<Closure>())
+        {
+          // the size of a closure is fixed when it is allocated
+          put32(obj.as<Closure>()->numCaptured());
+        }
+      }
+      for(const Cell & obj : objects)
+      {
+        putObject(obj);
+      }
+      for(const Cell & root : roots)
+      {
+        putCell(root);
+      }
+      for(const auto & binding : bindings)
+      {
+        put32(symbolIndex[binding.first.as<Symbol>()]);
+        putCell(binding.second);
+      }
+    }
+
+  private:
+    static Kind kind(const Cell & cell)
+    {
+      if(cell.isA<Function>())
+      {
+        return KIND_FUNCTION;
+      }
+      else if(cell.isA<Reference>())
+      {
+        return KIND_REFERENCE;
+      }
+      else if(cell.isA<Cons>())
+      {
+        return KIND_CONS;
+      }
+      else if(cell.isA<Closure>())
+      {
+        return KIND_CLOSURE;
+      }
+      else
+      {
+        return KIND_ARRAY;
+      }
+    }
+
+    static const void * address(const Cell & cell)
+    {
+      if(cell.isA<Function>())
+      {
+        return cell.as<Function>();
+      }
+      else if(cell.isA<Reference>())
+      {
+        return cell.as<Reference>();
+      }
+      else if(cell.isA<Cons>())
+      {
+        return cell.as<Cons>();
+      }
+      else if(cell.isA<Closure>())
+      {
+        return cell.as<Closure>();
+      }
+      else
+      {
+        return cell.as<Array>();
+      }
+    }
+
+    static void forEachChild(const Cell & cell,
+                             std::function<void(const Cell&)> func)
+    {
+      if(cell.isA<Function>())
+      {
+        const Function * f = cell.as<Function>();
+        for(std::size_t i = 0; i < f->dataSize(); i++)
+        {
+          func(f->atCell(i));
+        }
+      }
+      else if(cell.isA<Array>())
+      {
+        const Array * array = cell.as<Array>();
+        for(std::size_t i = 0; i < array->size(); i++)
+        {
+          func(array->atCell(i));
+        }
+      }
+      else if(cell.isA<Closure>())
+      {
+        cell.as<Closure>()->forEachChild(func);
+      }
+      else
+      {
+        func(cell.as<Lisp::BasicCons>()->getCarCell());
+        func(cell.as<Lisp::BasicCons>()->getCdrCell());
+      }
+    }
+
+    void collect(const Cell & cell)
+    {
+      if(cell.isA<Symbol>())
+      {
+        if(symbolIndex.find(cell.as<Symbol>()) == symbolIndex.end())
+        {
+          symbolIndex[cell.as<Symbol>()] = symbols.size();
+          symbols.push_back(cell.as<Symbol>());
+        }
+      }
+      else if(cell.isA<Function>() || cell.isA<Cons>() ||
+              cell.isA<Reference>() || cell.isA<Array>() ||
+              (env && cell.isA<Closure>()))
+      {
+        if(objectIndex.find(address(cell)) == objectIndex.end())
+        {
+          objectIndex[address(cell)] = objects.size();
+          objects.push_back(cell);
+        }
+      }
+      else if(!cell.isA<Nil>() && !cell.isA<Undefined>() &&
+              !cell.isA<UIntegerType>() && !cell.isA<BooleanType>() &&
+              !cell.isA<String>() &&
+              !(env && cell.isA<BuiltinFunction>()))
+      {
+        throw NotSerializable(cell);
+      }
+    }
+
+    void putObject(const Cell & cell)
+    {
+      if(cell.isA<Function>())
+      {
+        const Function * f = cell.as<Function>();
+        put32(f->numArguments());
+        put32(f->numOptionalArguments());
+        put8(f->hasRestArgument());
+        put32(f->numCaptured());
+        putString(f->getName());
+        put32(f->numInstructions());
+        for(auto itr = f->cbegin(); itr != f->cend(); ++itr)
+        {
+          put8(*itr);
+        }
+        put32(f->dataSize());
+      }
+      else if(cell.isA<Array>())
+      {
+        put32(cell.as<Array>()->size());
+      }
+      forEachChild(cell, [this](const Cell & c) { putCell(c); });
+    }
+
+    void putCell(const Cell & cell)
+    {
+      if(cell.isA<Nil>())
+      {
+        put8(TAG_NIL);
+      }
+      else if(cell.isA<Undefined>())
+      {
+        put8(TAG_UNDEFINED);
+      }
+      else if(cell.isA<UIntegerType>())
+      {
+        put8(TAG_UINTEGER);
+        put64(cell.as<UIntegerType>());
+      }
+      else if(cell.isA<BooleanType>())
+      {
+        put8(TAG_BOOLEAN);
+        put8(cell.as<BooleanType>());
+      }
+      else if(cell.isA<Symbol>())
+      {
+        put8(TAG_SYMBOL);
+        put32(symbolIndex[cell.as<Symbol>()]);
+      }
+      else if(cell.isA<String>())
+      {
+        put8(TAG_STRING);
+        putString(cell.as<String>()->getCString());
+      }
+      else if(cell.isA<BuiltinFunction>())
+      {
+        // builtins are bound by name in the environment of the reader
+        put8(TAG_BUILTIN);
+        putString(cell.as<BuiltinFunction>()->getName());
+      }
+      else
+      {
+        put8(TAG_OBJECT);
+        put32(objectIndex[address(cell)]);
+      }
+    }
+
+    void put8(std::uint8_t value)
+    {
+      ost.put(char(value));
+    }
+
+    void put32(std::uint32_t value)
+    {
+      ost.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put64(std::uint64_t value)
+    {
+      ost.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void putString(const std::string & str)
+    {
+      put32(str.size());
+      ost.write(str.data(), str.size());
+    }
+
+    std::ostream & ost;
+    const Env * env;
+    std::unordered_map<const Symbol*, std::uint32_t> symbolIndex;
+    std::vector<const Symbol*> symbols;
+    std::unordered_map<const void*, std::uint32_t> objectIndex;
+    std::vector<Cell> objects;
+  };
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Reader
+  /////////////////////////////////////////////////////////////////////////////
+  class Reader
+  {
+  public:
+    /**
+     * Reads a heap image and restores its bindings into env
+     * if env is not null, otherwise a code image.
+     */
+    Reader(const char * _begin, std::size_t size, Allocator & _alloc,
+           Env * _env = nullptr)
+      : begin(_begin), itr(_begin), end(_begin + size), alloc(_alloc),
+        env(_env)
+    {
+    }
+
+    std::vector<Object> read()
+    {
+      // The objects are incomplete until the end of the image and not
+      // rooted: they are reachable from the roots and bindings at the end.
+      Allocator::Guard guard(alloc);
+      const char * magic = env ? heapMagic : codeMagic;
+      if(std::size_t(end - itr) < sizeof(codeMagic) ||
+         std::memcmp(itr, magic, sizeof(codeMagic)) != 0)
+      {
+        fail("not an image");
+      }
+      itr += sizeof(codeMagic);
+      if(get32() != version)
+      {
+        fail("unsupported version");
+      }
+      std::size_t numSymbols = get32();
+      std::size_t numObjects = get32();
+      std::size_t numRoots = get32();
+      std::size_t numBindings = env ? get32() : 0;
+      // each symbol and object takes at least one byte
+      if(numSymbols > std::size_t(end - itr) ||
+         numObjects > std::size_t(end - itr))
+      {
+        fail("truncated image");
+      }
+      symbols.reserve(numSymbols);
+      for(std::size_t i = 0; i < numSymbols; i++)
+      {
+        symbols.push_back(Object(alloc.makeRoot<Symbol>(getString())));
+      }
+      std::vector<std::pair<std::uint8_t, std::size_t>> kinds;
+      kinds.reserve(numObjects);
+      std::size_t numConses = 0;
+      for(std::size_t i = 0; i < numObjects; i++)
+      {
+        std::uint8_t kind = get8();
+        kinds.push_back(std::make_pair(kind, kind == KIND_CLOSURE ? get32() : 0));
+        numConses += (kind == KIND_CONS || kind == KIND_REFERENCE);
+      }
+      alloc.reserve(numConses);
+      objects.reserve(numObjects);
+      for(const auto & kind : kinds)
+      {
+        objects.push_back(makeObject(kind.first, kind.second));
+      }
+      for(std::size_t i = 0; i < numObjects; i++)
+      {
+        readObject(objects[i]);
+      }
+      // PUSHC reads the captured values without bounds checks
+      for(const Cell & obj : objects)
+      {
+        if(obj.isA<Closure>() &&
+           obj.as<Closure>()->numCaptured() !=
+           obj.as<Closure>()->getFunction()->numCaptured())
+        {
+          fail("closure does not match its function");
+        }
+      }
+      // each root takes at least one byte
+      if(numRoots > std::size_t(end - itr))
+      {
+        fail("truncated image");
+      }
+      std::vector<Object> roots;
+      roots.reserve(numRoots);
+      for(std::size_t i = 0; i < numRoots; i++)
+      {
+        Object obj(getCell());
+        if(!env && !obj.isA<Function>())
+        {
+          fail("root is not a function");
+        }
+        roots.push_back(obj);
+      }
+      // each binding takes at least five bytes (symbol index and tag)
+      if(numBindings > std::size_t(end - itr) / 5)
+      {
+        fail("truncated image");
+      }
+      std::vector<std::pair<Cell, Object>> bindings;
+      bindings.reserve(numBindings);
+      for(std::size_t i = 0; i < numBindings; i++)
+      {
+        Cell symbol(this->symbol(get32()));
+        bindings.push_back(std::make_pair(symbol, Object(getCell())));
+      }
+      if(itr != end)
+      {
+        fail("trailing bytes");
+      }
+      for(auto & binding : bindings)
+      {
+        env->set(binding.first, std::move(binding.second));
+      }
+      return roots;
+    }
+
+  private:
+    [[noreturn]] void fail(const char * reason)
+    {
+      throw InvalidImage(itr - begin, reason);
+    }
+
+    Cell makeObject(std::uint8_t kind, std::size_t size)
+    {
+      switch(kind)
+      {
+      case KIND_FUNCTION:
+        return Cell(alloc.make<Function>());
+      case KIND_CONS:
+        return Cell(alloc.make<Cons>(Lisp::nil, Lisp::nil),
+                    Lisp::TypeTraits<Cons>::getTypeId());
+      case KIND_REFERENCE:
+        return Cell(alloc.make<Reference>(Lisp::nil, Lisp::nil),
+                    Lisp::TypeTraits<Reference>::getTypeId());
+      case KIND_ARRAY:
+        return Cell(alloc.make<Array>());
+      case KIND_CLOSURE:
+        if(!env)
+        {
+          fail("closure in code image");
+        }
+        // each captured value takes at least one byte
+        require(size);
+        return Cell(alloc.make<Closure>(size));
+      default:
+        fail("unknown object kind");
+      }
+    }
+
+    void readObject(const Cell & obj)
+    {
+      if(obj.isA<Function>())
+      {
+        Function * f = obj.as<Function>();
+        std::size_t nArguments = get32();
+        std::size_t nOptional = get32();
+        bool rest = get8();
+        f->setNumCaptured(get32());
+        f->setName(getString());
+        std::size_t codeSize = get32();
+        require(codeSize);
+        Function::Code code(itr, itr + codeSize);
+        itr += codeSize;
+        f->setCode(std::move(code));
+        // the parameters are the first data elements
+        std::size_t n = get32();
+        if(n < nArguments || nArguments < nOptional + (rest ? 1 : 0))
+        {
+          fail("inconsistent parameters");
+        }
+        for(std::size_t i = 0; i < n; i++)
+        {
+          f->appendData(getCell());
+        }
+        f->setArguments(nArguments, nOptional, rest);
+      }
+      else if(obj.isA<Array>())
+      {
+        std::size_t n = get32();
+        for(std::size_t i = 0; i < n; i++)
+        {
+          obj.as<Array>()->append(getCell());
+        }
+      }
+      else if(obj.isA<Closure>())
+      {
+        Closure * closure = obj.as<Closure>();
+        Cell func(getCell());
+        if(!func.isA<Function>())
+        {
+          fail("closure without function");
+        }
+        closure->set(0, func);
+        for(std::size_t i = 0; i < closure->numCaptured(); i++)
+        {
+          closure->set(i + 1, getCell());
+        }
+      }
+      else
+      {
+        Lisp::BasicCons * cons = obj.as<Lisp::BasicCons>();
+        cons->setCar(getCell());
+        cons->setCdr(getCell());
+      }
+    }
+
+    Cell getCell()
+    {
+      switch(get8())
+      {
+      case TAG_NIL:
+        return Lisp::nil;
+      case TAG_UNDEFINED:
+        return Lisp::undefined;
+      case TAG_UINTEGER:
+        return Cell(UIntegerType(get64()));
+      case TAG_BOOLEAN:
+        return Object::boolean(get8() != 0);
+      case TAG_SYMBOL:
+        return symbol(get32());
+      case TAG_STRING:
+        return Cell(alloc.makeRoot<String>(getString()));
+      case TAG_OBJECT:
+        return object(get32());
+      case TAG_BUILTIN:
+        return builtin(getString());
+      default:
+        fail("unknown cell tag");
+      }
+    }
+
+    const Cell & builtin(const std::string & name)
+    {
+      if(!env)
+      {
+        fail("builtin in code image");
+      }
+      const Object & value = env->find(Object(alloc.makeRoot<Symbol>(name)));
+      if(!value.isA<BuiltinFunction>())
+      {
+        fail("unknown builtin");
+      }
+      return value;
+    }
+
+    const Object & symbol(std::size_t i)
+    {
+      if(i >= symbols.size())
+      {
+        fail("symbol index out of range");
+      }
+      return symbols[i];
+    }
+
+    const Cell & object(std::size_t i)
+    {
+      if(i >= objects.size())
+      {
+        fail("object index out of range");
+      }
+      return objects[i];
+    }
+
+    void require(std::size_t n)
+    {
+      if(std::size_t(end - itr) < n)
+      {
+        fail("truncated image");
+      }
+    }
+
+    std::uint8_t get8()
+    {
+      require(1);
+      return std::uint8_t(*itr++);
+    }
+
+    std::uint32_t get32()
+    {
+      std::uint32_t value;
+      require(sizeof(value));
+      std::memcpy(&value, itr, sizeof(value));
+      itr += sizeof(value);
+      return value;
+    }
+
+    std::uint64_t get64()
+    {
+      std::uint64_t value;
+      require(sizeof(value));
+      std::memcpy(&value, itr, sizeof(value));
+      itr += sizeof(value);
+      return value;
+    }
+
+    std::string getString()
+    {
+      std::size_t n = get32();
+      require(n);
+      std::string str(itr, n);
+      itr += n;
+      return str;
+    }
+
+    const char * begin;
+    const char * itr;
+    const char * end;
+    Allocator & alloc;
+    Env * env;
+    std::vector<Object> symbols;
+    std::vector<Cell> objects;
+  };
+
+  template<typename READ>
+  std::vector<Object> mapImage(const std::string & path, READ read)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+      throw InvalidImage(0, "cannot open " + path);
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+      close(fd);
+      throw InvalidImage(0, "cannot read " + path);
+    }
+    std::size_t size = st.st_size;
+    void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+    {
+      throw InvalidImage(0, "cannot map " + path);
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    try
+    {
+      std::vector<Object> result(read(static_cast<const char*>(data), size));
+      munmap(data, size);
+      return result;
+    }
+    catch(...)
+    {
+      munmap(data, size);
+      throw;
+    }
+  }
+}
+
+void Lisp::writeImage(std::ostream & ost, const std::vector<Cell> & functions)
+{
+  Writer(ost).write(functions);
+}
+
+void Lisp::saveImage(const std::string & path, const std::vector<Cell> & functions)
+{
+  std::ofstream ost(path, std::ios::binary);
+  writeImage(ost, functions);
+  if(!ost)
+  {
+    throw InvalidImage(0, "cannot write " + path);
+  }
+}
+
+std::vector<Object> Lisp::readImage(const char * data, std::size_t size,
+                                    Allocator & alloc)
+{
+  return Reader(data, size, alloc).read();
+}
+
+std::vector<Object> Lisp::loadImage(const std::string & path, Allocator & alloc)
+{
+  return mapImage(path, [&alloc](const char * data, std::size_t size) {
+      return readImage(data, size, alloc);
+  });
+}
+
+void Lisp::writeHeapImage(std::ostream & ost, const Env & env,
+                          const std::vector<Cell> & roots)
+{
+  Writer(ost, &env).write(roots);
+}
+
+void Lisp::saveHeapImage(const std::string & path, const Env & env,
+                         const std::vector<Cell> & roots)
+{
+  std::ofstream ost(path, std::ios::binary);
+  writeHeapImage(ost, env, roots);
+  if(!ost)
+  {
+    throw InvalidImage(0, "cannot write " + path);
+  }
+}
+
+std::vector<Object> Lisp::readHeapImage(const char * data, std::size_t size,
+                                        Allocator & alloc, Env & env)
+{
+  return Reader(data, size, alloc, &env).read();
+}
+
+std::vector<Object> Lisp::loadHeapImage(const std::string & path,
+                                        Allocator & alloc, Env & env)
+{
+  return mapImage(path, [&alloc, &env](const char * data, std::size_t size) {
+      return readHeapImage(data, size, alloc, env);
+  });
+}
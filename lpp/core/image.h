@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <lpp/core/object.h>
+
+namespace Lisp
+{
+  class Allocator;
+  class Env;
+
+  /**
+   * Bytecode images.
+   *
+   * An image stores compiled functions (e.g. the top level forms of a
+   * source file, see Language::compile) with all objects reachable
+   * from them: code, parameters, captured variable counts, names,
+   * nested lambdas and the constants of their data (numbers, booleans,
+   * strings, symbols, conses, references and arrays).
+   * Shared structure and cycles are preserved.
+   *
+   * Layout (native byte order):
+   *   header   magic, version, number of symbols, objects and roots
+   *   symbols  names of all symbols
+   *   kinds    type of each object (and the number of captured
+   *            values of a closure)
+   *   objects  contents of each object, cells refer to symbols and
+   *            objects by index
+   *   roots    cell of each stored function
+   *
+   * The reader interns the symbols through the allocator, allocates all
+   * objects (the conses in bulk, see Allocator::reserve) and then fills
+   * them in a single pass over the image, which relinks the object
+   * indices to the new addresses: loading takes time proportional to the
+   * size of the image. Only the roots are added to the root set.
+   * Loaded code is checked by the verifier when it is called first.
+   *
+   * Heap images (writeHeapImage) store the global bindings of an Env and
+   * additional roots with everything reachable from them, including
+   * closures. Builtins are stored by name and bound to the builtin of the
+   * same name in the environment of the reader. The header has the number
+   * of bindings after the number of roots, the bindings (symbol index
+   * and value) follow the roots. Continuations and forms are not
+   * serializable.
+   */
+
+  /**
+   * Write the image of functions to ost.
+   * @throw NotSerializable for values that cannot be stored
+   *        (builtins, closures, continuations, ...), closures are
+   *        only stored in heap images
+   */
+  void writeImage(std::ostream & ost, const std::vector<Cell> & functions);
+
+  /**
+   * Write the image of functions to the file path.
+   */
+  void saveImage(const std::string & path, const std::vector<Cell> & functions);
+
+  /**
+   * Restore the functions of the image [data, data + size).
+   * @throw InvalidImage
+   */
+  std::vector<Object> readImage(const char * data, std::size_t size,
+                                Allocator & alloc);
+
+  /**
+   * Map the image file path into memory and restore its functions.
+   * @throw InvalidImage
+   */
+  std::vector<Object> loadImage(const std::string & path, Allocator & alloc);
+
+  /**
+   * Write the heap image of the bindings of env and of roots to ost.
+   * @throw NotSerializable
+   */
+  void writeHeapImage(std::ostream & ost, const Env & env,
+                      const std::vector<Cell> & roots = std::vector<Cell>());
+
+  /**
+   * Write the heap image of env and roots to the file path.
+   */
+  void saveHeapImage(const std::string & path, const Env & env,
+                     const std::vector<Cell> & roots = std::vector<Cell>());
+
+  /**
+   * Restore the heap image [data, data + size): the bindings are set
+   * in env (replacing existing bindings), the roots are returned.
+   * env is not modified if the image is invalid.
+   * @throw InvalidImage
+   */
+  std::vector<Object> readHeapImage(const char * data, std::size_t size,
+                                    Allocator & alloc, Env & env);
+
+  /**
+   * Map the heap image file path into memory and restore it.
+   * @throw InvalidImage
+   */
+  std::vector<Object> loadHeapImage(const std::string & path,
+                                    Allocator & alloc, Env & env);
+}
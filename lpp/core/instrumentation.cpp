@@ -0,0 +1,58 @@
+#include <iomanip>
+#include <lpp/core/instrumentation.h>
+#include <lpp/core/config.h>
+
+using Instrumentation = Lisp::Instrumentation;
+
+#ifdef DO_INSTRUMENT
+const bool Instrumentation::enabled = true;
+#else
+const bool Instrumentation::enabled = false;
+#endif
+
+Instrumentation::Instrumentation()
+{
+  reset();
+}
+
+void Instrumentation::reset()
+{
+  for(OpcodeCounter & counter : opcodes)
+  {
+    counter.count = 0;
+    counter.ticks = 0;
+  }
+  calls = 0;
+  tailCalls = 0;
+  builtinCalls = 0;
+  maxStackSize = 0;
+  maxCallDepth = 0;
+  active = false;
+  current = 0;
+  start = 0;
+}
+
+void Instrumentation::dump(std::ostream & ost) const
+{
+  ost << std::left << std::setw(14) << "opcode"
+      << std::right << std::setw(14) << "count"
+      << std::setw(16) << "ticks"
+      << std::setw(12) << "ticks/instr" << std::endl;
+  for(std::size_t i = 0; i < NUM_OPCODES; i++)
+  {
+    if(opcodes[i].count)
+    {
+      const char * name = opcodeName(InstructionType(i));
+      ost << std::left << std::setw(14) << (name ? name : "?")
+          << std::right << std::setw(14) << opcodes[i].count
+          << std::setw(16) << opcodes[i].ticks
+          << std::setw(12) << std::fixed << std::setprecision(1)
+          << (double(opcodes[i].ticks) / opcodes[i].count) << std::endl;
+    }
+  }
+  ost << "calls:          " << calls << std::endl;
+  ost << "tail calls:     " << tailCalls << std::endl;
+  ost << "builtin calls:  " << builtinCalls << std::endl;
+  ost << "max stack size: " << maxStackSize << std::endl;
+  ost << "max call depth: " << maxCallDepth << std::endl;
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <lpp/core/opcode.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+namespace Lisp
+{
+  /**
+   * Execution counters of the interpreter.
+   *
+   * Compiled in with the INSTRUMENT build option (see config.h),
+   * otherwise the interpreter has no hooks and all counters stay 0.
+   * Per opcode, the number of executions and the time from the start of
+   * the instruction to the start of the next instruction (including
+   * dispatch and, for calls, the frame setup) are recorded. Time is
+   * measured in TSC ticks on x86, in nanoseconds otherwise.
+   */
+  class Instrumentation
+  {
+  public:
+    static const bool enabled;
+
+    struct OpcodeCounter
+    {
+      std::uint64_t count;
+      std::uint64_t ticks;
+    };
+
+    Instrumentation();
+
+    inline const OpcodeCounter & getOpcodeCounter(InstructionType opcode) const;
+    inline std::uint64_t numCalls() const;
+    inline std::uint64_t numTailCalls() const;
+    inline std::uint64_t numBuiltinCalls() const;
+
+    /**
+     * Largest number of cells on a value stack and of frames
+     * on a call stack.
+     */
+    inline std::size_t getMaxStackSize() const;
+    inline std::size_t getMaxCallDepth() const;
+
+    void reset();
+
+    /**
+     * Table of opcodes (count, ticks, ticks per instruction),
+     * followed by the call counters and the maximum depths.
+     */
+    void dump(std::ostream & ost) const;
+
+    /* hooks of the interpreter */
+    inline void begin(InstructionType opcode);
+    inline void end();
+    inline void cancel();
+    inline void call(std::size_t stackSize, std::size_t callDepth);
+    inline void tailCall(std::size_t stackSize);
+    inline void builtinCall();
+
+    static inline std::uint64_t now();
+
+  private:
+    OpcodeCounter opcodes[NUM_OPCODES];
+    std::uint64_t calls;
+    std::uint64_t tailCalls;
+    std::uint64_t builtinCalls;
+    std::size_t maxStackSize;
+    std::size_t maxCallDepth;
+    // instruction in progress
+    bool active;
+    InstructionType current;
+    std::uint64_t start;
+  };
+}
+
+/******************************************************************************
+ * implementation
+ ******************************************************************************/
+inline const Lisp::Instrumentation::OpcodeCounter &
+Lisp::Instrumentation::getOpcodeCounter(InstructionType opcode) const
+{
+  return opcodes[opcode < NUM_OPCODES ? opcode : 0];
+}
+
+inline std::uint64_t Lisp::Instrumentation::numCalls() const
+{
+  return calls;
+}
+
+inline std::uint64_t Lisp::Instrumentation::numTailCalls() const
+{
+  return tailCalls;
+}
+
+inline std::uint64_t Lisp::Instrumentation::numBuiltinCalls() const
+{
+  return builtinCalls;
+}
+
+inline std::size_t Lisp::Instrumentation::getMaxStackSize() const
+{
+  return maxStackSize;
+}
+
+inline std::size_t Lisp::Instrumentation::getMaxCallDepth() const
+{
+  return maxCallDepth;
+}
+
+inline std::uint64_t Lisp::Instrumentation::now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return std::uint64_t(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+inline void Lisp::Instrumentation::begin(InstructionType opcode)
+{
+  std::uint64_t t = now();
+  if(active)
+  {
+    opcodes[current].ticks += t - start;
+  }
+  if(opcode < NUM_OPCODES)
+  {
+    ++opcodes[opcode].count;
+    active = true;
+    current = opcode;
+    start = t;
+  }
+  else
+  {
+    active = false;
+  }
+}
+
+inline void Lisp::Instrumentation::end()
+{
+  if(active)
+  {
+    opcodes[current].ticks += now() - start;
+    active = false;
+  }
+}
+
+inline void Lisp::Instrumentation::cancel()
+{
+  active = false;
+}
+
+inline void Lisp::Instrumentation::call(std::size_t stackSize, std::size_t callDepth)
+{
+  ++calls;
+  if(stackSize > maxStackSize)
+  {
+    maxStackSize = stackSize;
+  }
+  if(callDepth > maxCallDepth)
+  {
+    maxCallDepth = callDepth;
+  }
+}
+
+inline void Lisp::Instrumentation::tailCall(std::size_t stackSize)
+{
+  ++tailCalls;
+  if(stackSize > maxStackSize)
+  {
+    maxStackSize = stackSize;
+  }
+}
+
+inline void Lisp::Instrumentation::builtinCall()
+{
+  ++builtinCalls;
+}
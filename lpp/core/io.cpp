@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <lpp/core/builtins.h>
+#include <lpp/core/vm.h>
+#include <lpp/core/scheduler.h>
+#include <lpp/core/event_loop.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+#include <lpp/core/types/string.h>
+
+using Cell = Lisp::Cell;
+using Object = Lisp::Object;
+using Vm = Lisp::Vm;
+using Allocator = Lisp::Allocator;
+using BuiltinFunction = Lisp::BuiltinFunction;
+using String = Lisp::String;
+using Scheduler = Lisp::Scheduler;
+using EventLoop = Lisp::EventLoop;
+using UIntegerType = Lisp::UIntegerType;
+using IoError = Lisp::IoError;
+using NotAString = Lisp::NotAString;
+
+namespace
+{
+  int fileDescriptor(const char * operation, const Cell & cell)
+  {
+    UIntegerType fd = Lisp::Builtin::integer(cell);
+    if(fd > INT_MAX)
+    {
+      throw IoError(operation, EBADF);
+    }
+    return fd;
+  }
+
+  // the flag is kept, see Builtin::defineIo
+  void setNonBlocking(int fd)
+  {
+    int flags = fcntl(fd, F_GETFL);
+    if(flags < 0)
+    {
+      throw IoError("fcntl", errno);
+    }
+    if(!(flags & O_NONBLOCK) && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+      throw IoError("fcntl", errno);
+    }
+  }
+
+  // block the thread until fd is ready (no scheduler)
+  void waitFor(int fd, short events)
+  {
+    pollfd p;
+    p.fd = fd;
+    p.events = events;
+    p.revents = 0;
+    while(::poll(&p, 1, -1) < 0)
+    {
+      if(errno != EINTR)
+      {
+        throw IoError("poll", errno);
+      }
+    }
+  }
+
+  /**
+   * Read up to n bytes from fd into a string, nil at the end of file.
+   * @return false if the read would block
+   */
+  bool readSome(Allocator & alloc, int fd, std::size_t n, Object & result)
+  {
+    std::string buffer(n, '\0');
+    ssize_t r;
+    do
+    {
+      r = ::read(fd, &buffer[0], n);
+    } while(r < 0 && errno == EINTR);
+    if(r < 0)
+    {
+      if(errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        return false;
+      }
+      throw IoError("read", errno);
+    }
+    if(r == 0)
+    {
+      result = Lisp::nil;
+    }
+    else
+    {
+      buffer.resize(r);
+      result = Object(alloc.makeRoot<String>(buffer));
+    }
+    return true;
+  }
+
+  /**
+   * Write data from offset on, offset is advanced.
+   * @return false if the write would block before all data is written
+   */
+  bool writeSome(int fd, const std::string & data, std::size_t & offset)
+  {
+    while(offset < data.size())
+    {
+      ssize_t r = ::write(fd, data.data() + offset, data.size() - offset);
+      if(r < 0)
+      {
+        if(errno == EINTR)
+        {
+          continue;
+        }
+        if(errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+          return false;
+        }
+        throw IoError("write", errno);
+      }
+      offset += r;
+    }
+    return true;
+  }
+}
+
+void Lisp::Builtin::defineIo(Vm & vm)
+{
+  Object readFd = vm.make<BuiltinFunction>(
+      "read-fd",
+      [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+        int fd = fileDescriptor("read-fd", args[0]);
+        std::size_t n = std::min<UIntegerType>(integer(args[1]),
+                                               Builtin::maxReadSize);
+        if(n == 0)
+        {
+          return Object(alloc.makeRoot<String>(""));
+        }
+        Scheduler * scheduler = Scheduler::current();
+        if(scheduler)
+        {
+          setNonBlocking(fd);
+        }
+        Object result;
+        while(!readSome(alloc, fd, n, result))
+        {
+          if(scheduler)
+          {
+            scheduler->park(fd, EventLoop::Readable,
+                            [&alloc, fd, n](Object & res) {
+                              return readSome(alloc, fd, n, res);
+                            });
+            break;
+          }
+          waitFor(fd, POLLIN);
+        }
+        return result;
+      },
+      2);
+  readFd.as<BuiltinFunction>()->setSuspending(true);
+  vm.define("read-fd", readFd);
+
+  Object writeFd = vm.make<BuiltinFunction>(
+      "write-fd",
+      [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+        int fd = fileDescriptor("write-fd", args[0]);
+        if(!args[1].isA<String>())
+        {
+          throw NotAString(args[1]);
+        }
+        auto data = std::make_shared<std::string>(args[1].as<String>()->getCString());
+        auto offset = std::make_shared<std::size_t>(0);
+        Scheduler * scheduler = Scheduler::current();
+        if(scheduler)
+        {
+          setNonBlocking(fd);
+        }
+        while(!writeSome(fd, *data, *offset))
+        {
+          if(scheduler)
+          {
+            scheduler->park(fd, EventLoop::Writable,
+                            [fd, data, offset](Object & res) {
+                              if(!writeSome(fd, *data, *offset))
+                              {
+                                return false;
+                              }
+                              res = Object(Cell(UIntegerType(data->size())));
+                              return true;
+                            });
+            break;
+          }
+          waitFor(fd, POLLOUT);
+        }
+        return Object(Cell(UIntegerType(data->size())));
+      },
+      2);
+  writeFd.as<BuiltinFunction>()->setSuspending(true);
+  vm.define("write-fd", writeFd);
+
+  vm.define("close-fd", vm.make<BuiltinFunction>(
+                "close-fd",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  int fd = fileDescriptor("close-fd", args[0]);
+                  Scheduler * scheduler = Scheduler::current();
+                  if(scheduler)
+                  {
+                    // green threads that wait for fd fail
+                    scheduler->getEventLoop().forget(fd);
+                  }
+                  if(::close(fd) != 0)
+                  {
+                    throw IoError("close", errno);
+                  }
+                  return Object(Lisp::nil);
+                },
+                1));
+}
@@ -29,13 +29,70 @@ of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #include <stdexcept>
+#include <unordered_set>
+#include <vector>
 #include <lpp/core/memory/allocator.h>
+#include <lpp/core/equal.h>
 #include <lpp/core/types/collectible.h>
 #include <lpp/core/types/container.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/verifier.h>
 
 using Allocator = Lisp::Allocator;
 using Cell = Lisp::Cell;
 
+static inline const void * frozenId(const Cell & cell)
+{
+  if(cell.isA<Lisp::BasicCons>())
+  {
+    return cell.as<Lisp::BasicCons>();
+  }
+  else
+  {
+    return cell.as<Lisp::Container>();
+  }
+}
+
+// verify the functions reachable from cell (also through closures,
+// conses and arrays) before they become immutable
+static void verifyReachable(const Cell & cell)
+{
+  std::vector<Cell> todo({cell});
+  std::unordered_set<const void*> visited;
+  while(!todo.empty())
+  {
+    Cell current = todo.back();
+    todo.pop_back();
+    if(current.isA<Lisp::BasicCons>())
+    {
+      if(current.as<Lisp::BasicCons>()->isFrozen() ||
+         !visited.insert(current.as<Lisp::BasicCons>()).second)
+      {
+        continue;
+      }
+    }
+    else if(current.isA<Lisp::Container>())
+    {
+      if(current.as<Lisp::Container>()->isFrozen() ||
+         !visited.insert(current.as<Lisp::Container>()).second)
+      {
+        continue;
+      }
+      if(current.isA<Lisp::Function>())
+      {
+        Lisp::verified(*current.as<Lisp::Function>());
+      }
+    }
+    else
+    {
+      continue;
+    }
+    current.forEachChild([&todo](const Cell & child){
+        todo.push_back(child);
+    });
+  }
+}
+
 Allocator::~Allocator()
 {
   cycle();
@@ -44,6 +101,15 @@ Allocator::~Allocator()
     assert(p.second->allocator == this);
     p.second->allocator = nullptr;
   }
+  // release pinned symbols after they have been detached,
+  // other threads may still hold references
+  sharedSymbols.clear();
+  // frozen conses are released with the cons pages
+  Container * container;
+  while((container = containerMap.popPermanent()))
+  {
+    delete container;
+  }
 }
 
 void Allocator::forEachContainer(const CollectibleContainer<Container> & containers,
@@ -73,6 +139,11 @@ void Allocator::forEachReachable(std::function<void(const Cell &)> func) const
     func(cell);
     todo.erase(cell);
     root.insert(cell);
+    if(cell.isFrozen())
+    {
+      // the frozen subgraph is closed
+      continue;
+    }
     cell.forEachChild([&todo, &root, &cell, &func](const Cell& child) {
         if(child.isA<const Collectible>() &&
            todo.find(child) == todo.end() &&
@@ -83,6 +154,92 @@ void Allocator::forEachReachable(std::function<void(const Cell &)> func) const
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// importSymbols
+//
+////////////////////////////////////////////////////////////////////////////////
+void Allocator::importSymbols(const Allocator & other)
+{
+  for(const Cell & cell : other.sharedSymbols)
+  {
+    const std::string & name = cell.as<Symbol>()->getName();
+    if(symbols.find(name) == symbols.end())
+    {
+      importedSymbols.emplace(name, cell);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// freeze
+//
+////////////////////////////////////////////////////////////////////////////////
+void Allocator::freeze(const Cell & cell)
+{
+  // a function that fails verification leaves the subgraph mutable
+  verifyReachable(cell);
+  std::vector<Cell> todo({cell});
+  std::vector<Cell> frozen;
+  while(!todo.empty())
+  {
+    Cell current = todo.back();
+    todo.pop_back();
+    if(current.isA<BasicCons>())
+    {
+      auto cons = current.as<BasicCons>();
+      if(cons->isFrozen())
+      {
+        continue;
+      }
+      assert(cons->getAllocator() == this);
+      consMap.freeze(cons);
+      frozen.push_back(current);
+    }
+    else if(current.isA<Container>())
+    {
+      auto container = current.as<Container>();
+      if(container->isFrozen())
+      {
+        continue;
+      }
+      assert(container->getAllocator() == this);
+      containerMap.freeze(container);
+      if(current.isA<Array>())
+      {
+        frozen.push_back(current);
+      }
+    }
+    else
+    {
+      if(current.isA<ManagedType>() &&
+         !current.as<ManagedType>()->isShared())
+      {
+        share(current);
+      }
+      continue;
+    }
+    current.forEachChild([&todo](const Cell & child){
+        todo.push_back(child);
+    });
+  }
+  // hashes are cached once the whole subgraph is frozen; a traversal
+  // that runs into a cycle leaves the remaining nodes to the next one
+  auto cache = [this](const Cell & node, std::size_t hash, bool cyclic) {
+    frozenHashes.emplace(frozenId(node), std::make_pair(hash, cyclic));
+  };
+  for(const Cell & node : frozen)
+  {
+    std::size_t hash;
+    bool cyclic;
+    if(!getFrozenHash(frozenId(node), hash, cyclic))
+    {
+      equalHash(node, cache);
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // process garbage collector
@@ -79,10 +79,54 @@ namespace Lisp
     template<typename C,  typename... ARGS>
     inline C * makeRoot(ARGS && ... rest);
 
+    /**
+     * Allocate the cons pages for numConses conses in advance
+     * (bulk allocation, e.g. when an image is loaded).
+     */
+    inline void reserve(std::size_t numConses);
+
     /**
      * Remove a symbol
      */
     inline void remove(Symbol * symbol);
+
+    /**
+     * Make a managed object (String, Symbol, ...) shareable between threads.
+     * See ManagedType::share().
+     * Shared symbols are pinned in the symbol table until the allocator
+     * is destroyed, such that an interned symbol is never released
+     * by a foreign thread while it is still in the table.
+     */
+    inline void share(const Cell & cell);
+
+    /**
+     * Use the shared symbols of other for names that are not interned
+     * by this allocator, such that both allocators agree on the symbols
+     * (and their ids) of these names. The imported symbols are a snapshot
+     * held by this allocator, other may be used by another thread.
+     */
+    void importSymbols(const Allocator & other);
+
+    /**
+     * Freeze the collectible subgraph reachable from cell.
+     * Frozen conses and containers are moved to a permanent space:
+     * they are never scanned or collected, rooting them is a no-op and
+     * mutators throw FrozenObject. Managed leaves are shared.
+     * Frozen objects can be referenced read-only from other allocators,
+     * they live as long as this allocator.
+     * The equalHash of the frozen conses and arrays is cached.
+     * The functions of the subgraph are verified (see verifier.h)
+     * before anything is frozen.
+     * @throw InvalidBytecode
+     */
+    void freeze(const Cell & cell);
+
+    /**
+     * Cached equalHash of a cons or an array frozen by this allocator.
+     * cyclic is true if a cycle is reachable from obj.
+     * @return false if obj has not been frozen by this allocator
+     */
+    inline bool getFrozenHash(const void * obj, std::size_t & hash, bool & cyclic) const;
     
     inline std::size_t numCollectible() const;
     inline std::size_t numRootCollectible() const;
@@ -92,6 +136,7 @@ namespace Lisp
     inline std::size_t numBulkCollectible(Color color) const;
     inline std::size_t numVoidCollectible() const;
     inline std::size_t numDisposedCollectible() const;
+    inline std::size_t numFrozenCollectible() const;
 
     inline std::vector<Cell> get(void(Allocator::*func)(std::function<void(const Cell &)> func) const) const;
     inline std::vector<Cell> get(Color color,
@@ -135,6 +180,9 @@ namespace Lisp
     ColorMap<BasicCons> consMap;
     ColorMap<Container> containerMap;
     std::unordered_map<std::string, Symbol*> symbols;
+    std::vector<Cell> sharedSymbols;
+    std::unordered_map<std::string, Cell> importedSymbols;
+    std::unordered_map<const void*, std::pair<std::size_t, bool>> frozenHashes;
     Container * toBeRecycled;
     ConsPages consPages;
     unsigned short int garbageSteps;
@@ -407,6 +455,14 @@ inline C * Lisp::Allocator::_make(SymbolStorageTrait, const std::string & name)
 template<typename C>
 inline C * Lisp::Allocator::_makeRoot(SymbolStorageTrait, const std::string & name)
 {
+  if(!importedSymbols.empty())
+  {
+    auto itr = importedSymbols.find(name);
+    if(itr != importedSymbols.end())
+    {
+      return itr->second.as<Symbol>();
+    }
+  }
   auto res = symbols.insert(std::make_pair(name, (Symbol*)nullptr));
   if(res.second)
   {
@@ -426,6 +482,38 @@ inline void Lisp::Allocator::remove(Symbol * symbol)
   symbols.erase(itr);
 }
 
+inline void Lisp::Allocator::share(const Cell & cell)
+{
+  if(cell.isA<Symbol>())
+  {
+    Symbol * symbol = cell.as<Symbol>();
+    assert(symbol->allocator == this);
+    if(!symbol->isShared())
+    {
+      symbol->share();
+      sharedSymbols.push_back(cell);
+    }
+  }
+  else if(cell.isA<ManagedType>())
+  {
+    cell.as<ManagedType>()->share();
+  }
+}
+
+inline bool Lisp::Allocator::getFrozenHash(const void * obj,
+                                           std::size_t & hash,
+                                           bool & cyclic) const
+{
+  auto itr = frozenHashes.find(obj);
+  if(itr == frozenHashes.end())
+  {
+    return false;
+  }
+  hash = itr->second.first;
+  cyclic = itr->second.second;
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // numCollectible
@@ -467,6 +555,11 @@ inline std::size_t Lisp::Allocator::numBulkCollectible(Color color) const
   return consMap.size(color) + containerMap.size(color);
 }
 
+inline void Lisp::Allocator::reserve(std::size_t numConses)
+{
+  consPages.reserve(numConses);
+}
+
 inline std::size_t Lisp::Allocator::numVoidCollectible() const
 {
   return consPages.getNumVoid();
@@ -477,6 +570,11 @@ inline std::size_t Lisp::Allocator::numDisposedCollectible() const
   return consMap.numDisposed() + containerMap.numDisposed();
 }
 
+inline std::size_t Lisp::Allocator::numFrozenCollectible() const
+{
+  return consMap.permanentSize() + containerMap.permanentSize();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // forEachCollectible
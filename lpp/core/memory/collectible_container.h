@@ -51,7 +51,8 @@ namespace Lisp
     friend class ColorMap<T>;
     friend class UnmanagedCollectibleContainer<T>;
 
-    CollectibleContainer(Color _color, bool _isRoot, Allocator * _gc);
+    CollectibleContainer(Color _color, bool _isRoot, Allocator * _gc,
+                         bool _isPermanent=false);
     inline void remove(T * obj);
     inline void add(T * obj);
     inline void move(T * obj);
@@ -61,6 +62,12 @@ namespace Lisp
     inline bool empty() const;
     inline std::size_t size() const;
     inline bool isRoot() const;
+
+    /**
+     * Permanent containers hold frozen objects.
+     * Elements are never rooted, unrooted, greyed or collected.
+     */
+    inline bool isPermanent() const;
     inline Color getColor() const;
     
     inline void root(T * obj);
@@ -87,14 +94,24 @@ namespace Lisp
     CollectibleContainer<T> * toElements;
     Color color;
     bool _isRoot;
+    bool _isPermanent;
     Allocator * gc;
   };
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 template<typename T>
-inline Lisp::CollectibleContainer<T>::CollectibleContainer(Color _color, bool __isRoot, Allocator * _gc)
-  : color(_color), _isRoot(__isRoot), gc(_gc)
+inline Lisp::CollectibleContainer<T>::CollectibleContainer(Color _color,
+                                                          bool __isRoot,
+                                                          Allocator * _gc,
+                                                          bool __isPermanent)
+  : otherElements(nullptr),
+    greyElements(nullptr),
+    toElements(nullptr),
+    color(_color),
+    _isRoot(__isRoot),
+    _isPermanent(__isPermanent),
+    gc(_gc)
 {
 }
 
@@ -156,6 +173,12 @@ inline bool Lisp::CollectibleContainer<T>::isRoot() const
   return _isRoot;
 }
 
+template<typename T>
+inline bool Lisp::CollectibleContainer<T>::isPermanent() const
+{
+  return _isPermanent;
+}
+
 template<typename T>
 inline Lisp::Color Lisp::CollectibleContainer<T>::getColor() const
 {
@@ -165,7 +188,11 @@ inline Lisp::Color Lisp::CollectibleContainer<T>::getColor() const
 template<typename T>
 inline void Lisp::CollectibleContainer<T>::root(T * obj)
 {
-  if(_isRoot)
+  if(_isPermanent)
+  {
+    return;
+  }
+  else if(_isRoot)
   {
     ++obj->refCount;
   }
@@ -182,6 +209,10 @@ inline void Lisp::CollectibleContainer<T>::root(T * obj)
 template<typename T>
 inline void Lisp::CollectibleContainer<T>::unroot(T * obj)
 {
+  if(_isPermanent)
+  {
+    return;
+  }
   assert(obj->isRoot());
   assert(obj->getRefCount() > 0u);
   assert(obj == elements[obj->index]);
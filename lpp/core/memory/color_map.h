@@ -47,6 +47,14 @@ namespace Lisp
     ~ColorMap();
     inline void add(T * obj);
     inline void addRoot(T * obj);
+
+    /**
+     * Move object to the permanent space.
+     * Permanent objects are black roots that are never scanned again.
+     */
+    inline void freeze(T * obj);
+    inline T * popPermanent();
+    inline std::size_t permanentSize() const;
     inline std::size_t size(Color color) const;
     inline std::size_t rootSize(Color color) const;
     inline std::size_t numDisposed() const;
@@ -69,6 +77,7 @@ namespace Lisp
     CollectibleContainer<T> * whiteRoot;
     CollectibleContainer<T> * greyRoot;
     CollectibleContainer<T> * blackRoot;
+    CollectibleContainer<T> * permanent;
     UnmanagedCollectibleContainer<T> disposed;
   };
 }
@@ -83,6 +92,7 @@ Lisp::ColorMap<T>::ColorMap(Allocator * p)
   whiteRoot = new CollectibleContainer<T>(Lisp::Color::White, true,  p);
   greyRoot  = new CollectibleContainer<T>(Lisp::Color::Grey,  true,  p);
   blackRoot = new CollectibleContainer<T>(Lisp::Color::Black, true,  p);
+  permanent = new CollectibleContainer<T>(Lisp::Color::Black, true,  p, true);
 
   // we don't know if another object still refers to unrooted objects
   // -> never transition from root to white
@@ -115,6 +125,7 @@ Lisp::ColorMap<T>::~ColorMap()
   delete whiteRoot;
   delete greyRoot;
   delete blackRoot;
+  delete permanent;
   delete white;
   delete grey;
   delete black;
@@ -132,6 +143,25 @@ inline void Lisp::ColorMap<T>::addRoot(T * obj)
   whiteRoot->add(obj);
 }
 
+template<typename T>
+inline void Lisp::ColorMap<T>::freeze(T * obj)
+{
+  assert(obj->checkIndex());
+  permanent->move(obj);
+}
+
+template<typename T>
+inline T * Lisp::ColorMap<T>::popPermanent()
+{
+  return permanent->empty() ? nullptr : permanent->popBack();
+}
+
+template<typename T>
+inline std::size_t Lisp::ColorMap<T>::permanentSize() const
+{
+  return permanent->size();
+}
+
 template<typename T>
 inline std::size_t Lisp::ColorMap<T>::size(Color color) const
 {
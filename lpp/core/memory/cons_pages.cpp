@@ -47,6 +47,21 @@ ConsPages::~ConsPages()
     }
     delete [] pages[p];
   }
+  for(BasicCons * page : spare)
+  {
+    delete [] page;
+  }
+}
+
+void ConsPages::reserve(std::size_t n)
+{
+  std::size_t available = recycled.size() + (pageSize - pos) +
+    spare.size() * pageSize;
+  while(available < n)
+  {
+    spare.push_back(new BasicCons[pageSize]);
+    available += pageSize;
+  }
 }
 
 void ConsPages::recycleAll(const std::unordered_set<BasicCons*> & reachable,
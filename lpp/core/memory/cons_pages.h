@@ -92,6 +92,12 @@ namespace Lisp
 
     inline BasicCons * next();
 
+    /**
+     * Allocate the pages for n further conses in advance,
+     * next() does not allocate until they are used up.
+     */
+    void reserve(std::size_t n);
+
     inline void recycle(BasicCons * cons);
     void recycleAll(const std::unordered_set<BasicCons*> & reachable,
                     CollectibleContainer<BasicCons> & target,
@@ -101,6 +107,8 @@ namespace Lisp
     std::size_t pos;
     std::vector<BasicCons*> pages;
     std::vector<BasicCons*> recycled;
+    // reserved pages, used in reverse order
+    std::vector<BasicCons*> spare;
   };
 }
 
@@ -309,9 +317,16 @@ inline Lisp::BasicCons * Lisp::ConsPages::next()
   {
     if(pos == pageSize)
     {
-      pages.push_back(new BasicCons[pageSize]);
+      if(spare.empty())
+      {
+        pages.push_back(new BasicCons[pageSize]);
+      }
+      else
+      {
+        pages.push_back(spare.back());
+        spare.pop_back();
+      }
       pos = 0;
-
     }
     return pages.back() + pos++;
   }
@@ -112,7 +112,7 @@ Object & Object::operator=(const Object & rhs)
     assert(rhs.getRefCount() > 0u);
     assert(rhs.checkIndex());
     data.pCons = rhs.data.pCons;
-    data.pCons->refCount++;
+    data.pCons->getContainer()->root(data.pCons);
   }
   else if(rhs.isA<Lisp::Container>())
   {
@@ -120,7 +120,7 @@ Object & Object::operator=(const Object & rhs)
     assert(rhs.getRefCount() > 0u);
     assert(rhs.checkIndex());
     data.pContainer = rhs.data.pContainer;
-    data.pContainer->refCount++;
+    data.pContainer->getContainer()->root(data.pContainer);
   }
   else if(rhs.isA<Lisp::ManagedType>())
   {
@@ -160,6 +160,11 @@ void Object::unsetCons()
   {
     // Unroot the object if reference count is 0 (after removing this reference)
     auto container = data.pCons->getContainer();
+    if(container->isPermanent())
+    {
+      // frozen objects are not tracked and may belong to another allocator
+      return;
+    }
     container->unroot(data.pCons);
 
     // Perform GC step
@@ -175,6 +180,11 @@ void Object::unsetCons()
   {
     // Unroot the object if reference count is 0 (after removing this reference)
     auto container = data.pContainer->getContainer();
+    if(container->isPermanent())
+    {
+      // frozen objects are not tracked and may belong to another allocator
+      return;
+    }
     container->unroot(data.pContainer);
 
     // Perform GC step
@@ -48,6 +48,7 @@ namespace Lisp
 
     static Object nil();
     static Object undefined();
+    static Object boolean(BooleanType value);
 
     Object & operator=(const Cell & rhs);
     Object & operator=(Cell && rhs);
@@ -102,6 +103,14 @@ inline Lisp::Object Lisp::Object::undefined()
   return ret;
 }
 
+inline Lisp::Object Lisp::Object::boolean(BooleanType value)
+{
+  Object ret;
+  ret.typeId = TypeTraits<BooleanType>::getTypeId();
+  ret.data.boolValue = value;
+  return ret;
+}
+
 inline void Lisp::Object::init(ManagedType * managedType, TypeId _typeId)
 {
   Cell::init(managedType, _typeId);
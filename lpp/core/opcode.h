@@ -30,10 +30,18 @@ either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 
 namespace Lisp
 {
-  using InstructionType = std::size_t;
+  /**
+   * Bytecode unit.
+   * Opcodes take one byte, operands are encoded as unsigned LEB128
+   * (7 bits per byte, high bit set on all but the last byte),
+   * such that operands below 128 take one byte.
+   */
+  using InstructionType = std::uint8_t;
 
   /**
    * return / push a value from stack 
@@ -59,5 +67,160 @@ namespace Lisp
    * push the current state on call stack
    */
   static const InstructionType FUNCALL = 0x06;
+
+  /*
+   * Superinstructions generated by the peephole optimizer (see peephole.h).
+   * PUSHV2 a b          = PUSHV a, PUSHV b
+   * PUSHVFUNCALL a n    = PUSHV a, FUNCALL n
+   * PUSHLFUNCALL a n    = PUSHL a, FUNCALL n
+   */
+  static const InstructionType PUSHV2 = 0x15;
+  static const InstructionType PUSHVFUNCALL = 0x16;
+  static const InstructionType PUSHLFUNCALL = 0x17;
+
+  /*
+   * Primitive operations (see builtins.h).
+   * The operand is the number of arguments on the stack.
+   * The arguments are replaced by the result without a call frame.
+   */
+  static const InstructionType CAR = 0x18;
+  static const InstructionType CDR = 0x19;
+  static const InstructionType CONS = 0x1a;
+  static const InstructionType EQ = 0x1b;
+  static const InstructionType ADD = 0x1c;
+  static const InstructionType SUB = 0x1d;
+  static const InstructionType LT = 0x1e;
+
+  /*
+   * Arguments and closures
+   * PUSHA i     push the ith argument of the current function
+   * PUSHC i     push the ith captured value of the current closure
+   * PUSHR i     push the list of the rest arguments (i is the position
+   *             of the rest parameter)
+   * CLOSURE k   create a closure of the function at data position k
+   *             from the captured values on top of the stack
+   */
+  static const InstructionType PUSHA = 0x1f;
+  static const InstructionType PUSHC = 0x20;
+  static const InstructionType CLOSURE = 0x21;
+  static const InstructionType PUSHR = 0x23;
+
+  /*
+   * CALLCC 1    call the function on top of the stack with the
+   *             continuation of the instruction (call/cc)
+   */
+  static const InstructionType CALLCC = 0x22;
+
+  /**
+   * Upper bound of the opcode values
+   */
+  static const std::size_t NUM_OPCODES = 0x24;
+
+  /**
+   * Number of operands of an instruction
+   */
+  inline std::size_t numOperands(InstructionType opcode);
+
+  /**
+   * Mnemonic of an opcode, nullptr for unknown opcodes.
+   */
+  inline const char * opcodeName(InstructionType opcode);
+
+  /**
+   * Append an encoded operand to code.
+   */
+  inline void appendOperand(std::vector<InstructionType> & code,
+                            std::size_t value);
+
+  /**
+   * Decode the operand at itr and advance itr past it.
+   */
+  template<typename ITR>
+  inline std::size_t decodeOperand(ITR & itr);
+
+  /**
+   * Decode the first operand of the instruction at itr and advance itr
+   * past it.
+   */
+  template<typename ITR>
+  inline std::size_t fetchOperand(ITR & itr);
+}
+
+inline std::size_t Lisp::numOperands(InstructionType opcode)
+{
+  switch(opcode)
+  {
+  case PUSHV2:
+  case PUSHVFUNCALL:
+  case PUSHLFUNCALL:
+    return 2;
+  default:
+    return 1;
+  }
 }
 
+inline const char * Lisp::opcodeName(InstructionType opcode)
+{
+  switch(opcode)
+  {
+  case PUSHV:        return "PUSHV";
+  case RETURNS:      return "RETURNS";
+  case RETURNL:      return "RETURNL";
+  case PUSHL:        return "PUSHL";
+  case DEFINES:      return "DEFINES";
+  case FUNCALL:      return "FUNCALL";
+  case PUSHV2:       return "PUSHV2";
+  case PUSHVFUNCALL: return "PUSHVFUNCALL";
+  case PUSHLFUNCALL: return "PUSHLFUNCALL";
+  case CAR:          return "CAR";
+  case CDR:          return "CDR";
+  case CONS:         return "CONS";
+  case EQ:           return "EQ";
+  case ADD:          return "ADD";
+  case SUB:          return "SUB";
+  case LT:           return "LT";
+  case PUSHA:        return "PUSHA";
+  case PUSHC:        return "PUSHC";
+  case CLOSURE:      return "CLOSURE";
+  case PUSHR:        return "PUSHR";
+  case CALLCC:       return "CALLCC";
+  default:           return nullptr;
+  }
+}
+
+inline void Lisp::appendOperand(std::vector<InstructionType> & code,
+                                std::size_t value)
+{
+  while(value >= 0x80)
+  {
+    code.push_back(InstructionType(value | 0x80));
+    value >>= 7;
+  }
+  code.push_back(InstructionType(value));
+}
+
+template<typename ITR>
+inline std::size_t Lisp::decodeOperand(ITR & itr)
+{
+  InstructionType byte = *itr++;
+  if(!(byte & 0x80))
+  {
+    return byte;
+  }
+  std::size_t value = byte & 0x7f;
+  unsigned int shift = 7;
+  do
+  {
+    byte = *itr++;
+    value |= std::size_t(byte & 0x7f) << shift;
+    shift += 7;
+  } while(byte & 0x80);
+  return value;
+}
+
+template<typename ITR>
+inline std::size_t Lisp::fetchOperand(ITR & itr)
+{
+  ++itr;
+  return decodeOperand(itr);
+}
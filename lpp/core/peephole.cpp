@@ -0,0 +1,109 @@
+#include <vector>
+#include <utility>
+#include <lpp/core/peephole.h>
+#include <lpp/core/opcode.h>
+#include <lpp/core/types/function.h>
+
+using PeepholeStatistics = Lisp::PeepholeStatistics;
+using Function = Lisp::Function;
+using InstructionType = Lisp::InstructionType;
+
+namespace
+{
+  struct Instruction
+  {
+    InstructionType opcode;
+    std::size_t operand;
+  };
+}
+
+PeepholeStatistics::PeepholeStatistics()
+  : pushv2(0), pushvFuncall(0), pushlFuncall(0), emptyBodies(0)
+{
+}
+
+PeepholeStatistics & PeepholeStatistics::operator+=(const PeepholeStatistics & rhs)
+{
+  pushv2 += rhs.pushv2;
+  pushvFuncall += rhs.pushvFuncall;
+  pushlFuncall += rhs.pushlFuncall;
+  emptyBodies += rhs.emptyBodies;
+  return *this;
+}
+
+std::size_t PeepholeStatistics::total() const
+{
+  return pushv2 + pushvFuncall + pushlFuncall + emptyBodies;
+}
+
+std::ostream & Lisp::operator<<(std::ostream & ost, const PeepholeStatistics & stats)
+{
+  ost << "PUSHV2:       " << stats.pushv2 << std::endl;
+  ost << "PUSHVFUNCALL: " << stats.pushvFuncall << std::endl;
+  ost << "PUSHLFUNCALL: " << stats.pushlFuncall << std::endl;
+  ost << "EMPTY BODIES: " << stats.emptyBodies << std::endl;
+  return ost;
+}
+
+void Lisp::peephole(Function * func, PeepholeStatistics & stats)
+{
+  // the builder only emits single operand instructions
+  std::vector<Instruction> code;
+  for(auto itr = func->cbegin(); itr != func->cend();)
+  {
+    InstructionType opcode = *itr;
+    if(numOperands(opcode) != 1)
+    {
+      // already optimized
+      return;
+    }
+    code.push_back(Instruction{opcode, fetchOperand(itr)});
+  }
+
+  // the function epilogue moves the top of the stack to the stack frame:
+  // a body that only returns the last argument is empty
+  if(code.size() == 1 && code.back().opcode == PUSHA &&
+     code.back().operand + 1 == func->numArguments())
+  {
+    code.pop_back();
+    stats.emptyBodies++;
+  }
+
+  Function::Code result;
+  result.reserve(func->numInstructions());
+  std::size_t n = code.size();
+  for(std::size_t i = 0; i < n; i++)
+  {
+    const Instruction & instr(code[i]);
+    InstructionType next = (i + 1 < n) ? code[i + 1].opcode : 0;
+    if(instr.opcode == PUSHV && next == FUNCALL)
+    {
+      result.push_back(PUSHVFUNCALL);
+      appendOperand(result, instr.operand);
+      appendOperand(result, code[++i].operand);
+      stats.pushvFuncall++;
+    }
+    else if(instr.opcode == PUSHL && next == FUNCALL)
+    {
+      result.push_back(PUSHLFUNCALL);
+      appendOperand(result, instr.operand);
+      appendOperand(result, code[++i].operand);
+      stats.pushlFuncall++;
+    }
+    else if(instr.opcode == PUSHV && next == PUSHV &&
+            !(i + 2 < n && code[i + 2].opcode == FUNCALL))
+    {
+      // PUSHV, PUSHV, FUNCALL is fused as PUSHV, PUSHVFUNCALL
+      result.push_back(PUSHV2);
+      appendOperand(result, instr.operand);
+      appendOperand(result, code[++i].operand);
+      stats.pushv2++;
+    }
+    else
+    {
+      result.push_back(instr.opcode);
+      appendOperand(result, instr.operand);
+    }
+  }
+  func->setCode(std::move(result));
+}
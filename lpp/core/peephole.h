@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+
+namespace Lisp
+{
+  class Function;
+
+  /**
+   * Number of times each rewrite of the peephole optimizer fired.
+   */
+  class PeepholeStatistics
+  {
+  public:
+    PeepholeStatistics();
+    PeepholeStatistics & operator+=(const PeepholeStatistics & rhs);
+    std::size_t total() const;
+
+    /** PUSHV, PUSHV -> PUSHV2 */
+    std::size_t pushv2;
+
+    /** PUSHV, FUNCALL -> PUSHVFUNCALL */
+    std::size_t pushvFuncall;
+
+    /** PUSHL, FUNCALL -> PUSHLFUNCALL */
+    std::size_t pushlFuncall;
+
+    /** removed bodies that only PUSHA the last argument (done by the function epilogue) */
+    std::size_t emptyBodies;
+  };
+
+  std::ostream & operator<<(std::ostream & ost, const PeepholeStatistics & stats);
+
+  /**
+   * Fuse instruction sequences of func into superinstructions
+   * and remove redundant stack operations.
+   */
+  void peephole(Function * func, PeepholeStatistics & stats);
+}
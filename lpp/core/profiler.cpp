@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <sys/time.h>
+#include <lpp/core/profiler.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/continuation.h>
+
+using Profiler = Lisp::Profiler;
+using Function = Lisp::Function;
+using Continuation = Lisp::Continuation;
+using ContinuationState = Lisp::ContinuationState;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+
+volatile std::sig_atomic_t Profiler::expired = 0;
+
+void Profiler::handler(int)
+{
+  expired = 1;
+}
+
+Profiler::Profiler()
+  : samples(0), period(0), countdown(0), running(false), timer(false)
+{
+}
+
+Profiler::~Profiler()
+{
+  stop();
+}
+
+void Profiler::start(std::size_t interval)
+{
+  stop();
+  struct sigaction action;
+  action.sa_handler = &Profiler::handler;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGPROF, &action, &oldAction);
+  struct itimerval value;
+  value.it_interval.tv_sec = interval / 1000000;
+  value.it_interval.tv_usec = interval % 1000000;
+  value.it_value = value.it_interval;
+  expired = 0;
+  timer = true;
+  running = true;
+  setitimer(ITIMER_PROF, &value, nullptr);
+}
+
+void Profiler::startCounting(std::size_t _period)
+{
+  stop();
+  period = _period ? _period : 1;
+  countdown = period;
+  timer = false;
+  running = true;
+}
+
+void Profiler::stop()
+{
+  if(running && timer)
+  {
+    struct itimerval value = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_PROF, &value, nullptr);
+    sigaction(SIGPROF, &oldAction, nullptr);
+  }
+  running = false;
+  timer = false;
+}
+
+void Profiler::sample(const Continuation & cont)
+{
+  Stack stack;
+  cont.forEachFrame([this, &stack](const ContinuationState & state) {
+      const Function * f = state.getFunction();
+      stack.push_back(Frame{f, state.getOffset()});
+      if(functions.find(f) == functions.end())
+      {
+        functions.insert(std::make_pair(f, Object(Cell(const_cast<Function*>(f)))));
+      }
+  });
+  if(!stack.empty())
+  {
+    ++stacks[stack];
+    ++samples;
+  }
+}
+
+void Profiler::clear()
+{
+  stacks.clear();
+  functions.clear();
+  samples = 0;
+}
+
+std::string Profiler::getName(const Function * f)
+{
+  if(f->getName().empty())
+  {
+    std::stringstream ss;
+    ss << "lambda@" << static_cast<const void*>(f);
+    return ss.str();
+  }
+  return f->getName();
+}
+
+void Profiler::writeFolded(std::ostream & ost, bool withOffsets) const
+{
+  // stacks that only differ in offsets are merged
+  std::map<std::string, std::size_t> folded;
+  for(const auto & p : stacks)
+  {
+    std::stringstream ss;
+    for(std::size_t i = 0; i < p.first.size(); i++)
+    {
+      if(i)
+      {
+        ss << ";";
+      }
+      ss << getName(p.first[i].function);
+      if(withOffsets)
+      {
+        ss << "+" << p.first[i].offset;
+      }
+    }
+    folded[ss.str()] += p.second;
+  }
+  for(const auto & p : folded)
+  {
+    ost << p.first << " " << p.second << std::endl;
+  }
+}
+
+void Profiler::writeTop(std::ostream & ost, std::size_t n) const
+{
+  struct Entry
+  {
+    const Function * function;
+    std::size_t self;
+    std::size_t total;
+  };
+  std::map<const Function*, Entry> entries;
+  for(const auto & p : stacks)
+  {
+    std::set<const Function*> seen;
+    for(const Frame & frame : p.first)
+    {
+      Entry & entry = entries.insert(std::make_pair(frame.function,
+                                                    Entry{frame.function, 0, 0})).first->second;
+      if(seen.insert(frame.function).second)
+      {
+        entry.total += p.second;
+      }
+    }
+    entries[p.first.back().function].self += p.second;
+  }
+  std::vector<Entry> sorted;
+  for(const auto & p : entries)
+  {
+    sorted.push_back(p.second);
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const Entry & a, const Entry & b) {
+      return a.self > b.self || (a.self == b.self && a.total > b.total);
+  });
+  if(sorted.size() > n)
+  {
+    sorted.resize(n);
+  }
+  ost << std::setw(8) << "self" << std::setw(8) << "total"
+      << "  function (" << samples << " samples)" << std::endl;
+  for(const Entry & entry : sorted)
+  {
+    ost << std::fixed << std::setprecision(1)
+        << std::setw(7) << (100.0 * entry.self / samples) << "%"
+        << std::setw(7) << (100.0 * entry.total / samples) << "%"
+        << "  " << getName(entry.function) << std::endl;
+  }
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <csignal>
+#include <signal.h>
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <lpp/core/object.h>
+
+namespace Lisp
+{
+  class Function;
+  class Continuation;
+
+  /**
+   * Sampling profiler for compiled code.
+   *
+   * Continuations poll the profiler at safe points (function entry and
+   * return into a function). When a sample is due, the frames of the
+   * continuation are recorded: function and instruction offset, from the
+   * outermost to the innermost frame.
+   * Samples are due after every interval of CPU time (SIGPROF timer, the
+   * signal handler only sets a flag) or after every period safe points.
+   * Without a profiler, the poll is a single null pointer test.
+   *
+   * The timer is process wide: only one profiler can run with an
+   * interval at a time. The sampled functions are kept alive until
+   * clear() is called or the profiler is destroyed.
+   */
+  class Profiler
+  {
+  public:
+    struct Frame
+    {
+      const Function * function;
+      std::size_t offset;
+      inline bool operator<(const Frame & rhs) const;
+    };
+    using Stack = std::vector<Frame>;
+
+    Profiler();
+    ~Profiler();
+    Profiler(const Profiler & rhs) = delete;
+    Profiler & operator=(const Profiler & rhs) = delete;
+
+    /**
+     * Sample every interval microseconds of CPU time.
+     */
+    void start(std::size_t interval);
+
+    /**
+     * Sample every period-th safe point (deterministic).
+     */
+    void startCounting(std::size_t period);
+
+    void stop();
+    inline bool isRunning() const;
+
+    /**
+     * Called by continuations at safe points.
+     * @return true if a sample is due
+     */
+    inline bool due();
+
+    /**
+     * Record the frames of cont.
+     */
+    void sample(const Continuation & cont);
+
+    inline std::size_t numSamples() const;
+    inline const std::map<Stack, std::size_t> & getStacks() const;
+    void clear();
+
+    /**
+     * Name of a function in the reports: the name given by define,
+     * or lambda@address.
+     */
+    static std::string getName(const Function * f);
+
+    /**
+     * Folded stacks, input of flamegraph tools. One line per distinct
+     * stack: outer;...;inner count
+     * @param withOffsets append +offset to each frame
+     */
+    void writeFolded(std::ostream & ost, bool withOffsets = false) const;
+
+    /**
+     * The n functions with the most samples in which they are the
+     * innermost frame (self) and the number of samples in which they
+     * appear in any frame (total).
+     */
+    void writeTop(std::ostream & ost, std::size_t n = 10) const;
+
+  private:
+    static volatile std::sig_atomic_t expired;
+    static void handler(int);
+
+    std::map<Stack, std::size_t> stacks;
+    std::map<const Function*, Object> functions;
+    std::size_t samples;
+    std::size_t period;
+    std::size_t countdown;
+    bool running;
+    bool timer;
+    struct sigaction oldAction;
+  };
+}
+
+/******************************************************************************
+ * implementation
+ ******************************************************************************/
+inline bool Lisp::Profiler::Frame::operator<(const Frame & rhs) const
+{
+  return function < rhs.function ||
+    (function == rhs.function && offset < rhs.offset);
+}
+
+inline bool Lisp::Profiler::isRunning() const
+{
+  return running;
+}
+
+inline bool Lisp::Profiler::due()
+{
+  if(!running)
+  {
+    return false;
+  }
+  if(timer)
+  {
+    if(!expired)
+    {
+      return false;
+    }
+    expired = 0;
+    return true;
+  }
+  if(--countdown)
+  {
+    return false;
+  }
+  countdown = period;
+  return true;
+}
+
+inline std::size_t Lisp::Profiler::numSamples() const
+{
+  return samples;
+}
+
+inline const std::map<Lisp::Profiler::Stack, std::size_t> & Lisp::Profiler::getStacks() const
+{
+  return stacks;
+}
@@ -0,0 +1,587 @@
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <lpp/core/reader.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/memory/allocator.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/string.h>
+
+using Reader = Lisp::Reader;
+using Allocator = Lisp::Allocator;
+using ParseError = Lisp::ParseError;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Cons = Lisp::Cons;
+using Symbol = Lisp::Symbol;
+using String = Lisp::String;
+using UIntegerType = Lisp::UIntegerType;
+
+const std::size_t Reader::defaultChunkSize = 64 * 1024;
+const std::size_t Reader::defaultBatchSize = 4096;
+const std::size_t Reader::numCachedSymbols = 256;
+
+namespace
+{
+  inline bool isSpace(char c)
+  {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+  }
+
+  inline bool isDelimiter(char c)
+  {
+    return isSpace(c) || c == '(' || c == ')' || c == '"' || c == ';' || c == '\'';
+  }
+
+#ifdef __SSE2__
+  // 0xff for the whitespace bytes of v
+  inline __m128i spaceMask(__m128i v)
+  {
+    // '\t' ... '\r': unsigned v - '\t' <= '\r' - '\t'
+    __m128i x = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    return _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8('\r' - '\t')), x),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+  }
+
+  inline __m128i load(const char * p)
+  {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+#endif
+
+  // first byte of [p, end) that is not whitespace
+  inline const char * skipWhitespace(const char * p, const char * end)
+  {
+#ifdef __SSE2__
+    for(; end - p >= 16; p += 16)
+    {
+      unsigned mask = ~_mm_movemask_epi8(spaceMask(load(p))) & 0xffff;
+      if(mask)
+      {
+        return p + __builtin_ctz(mask);
+      }
+    }
+#endif
+    while(p != end && isSpace(*p))
+    {
+      ++p;
+    }
+    return p;
+  }
+
+  // first delimiter of [p, end)
+  inline const char * findDelimiter(const char * p, const char * end)
+  {
+#ifdef __SSE2__
+    for(; end - p >= 16; p += 16)
+    {
+      __m128i v = load(p);
+      __m128i m = _mm_or_si128(spaceMask(v),
+                               _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('(')),
+                                            _mm_cmpeq_epi8(v, _mm_set1_epi8(')'))));
+      m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                       _mm_cmpeq_epi8(v, _mm_set1_epi8(';'))));
+      m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+      unsigned mask = _mm_movemask_epi8(m);
+      if(mask)
+      {
+        return p + __builtin_ctz(mask);
+      }
+    }
+#endif
+    while(p != end && !isDelimiter(*p))
+    {
+      ++p;
+    }
+    return p;
+  }
+
+  // first '"' or '\\' of [p, end)
+  inline const char * findStringEnd(const char * p, const char * end)
+  {
+#ifdef __SSE2__
+    for(; end - p >= 16; p += 16)
+    {
+      __m128i v = load(p);
+      unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+      if(mask)
+      {
+        return p + __builtin_ctz(mask);
+      }
+    }
+#endif
+    while(p != end && *p != '"' && *p != '\\')
+    {
+      ++p;
+    }
+    return p;
+  }
+
+  inline Cell consCell(Cons * cons)
+  {
+    return Cell(cons, Lisp::TypeTraits<Cons>::getTypeId());
+  }
+}
+
+Reader::Reader(Allocator & _alloc, const char * data, std::size_t size)
+  : alloc(_alloc),
+    ist(nullptr),
+    chunkSize(0),
+    batchSize(defaultBatchSize),
+    begin(data),
+    pos(data),
+    end(data + size),
+    base(0),
+    allocations(0),
+    quote(alloc.makeRoot<Symbol>("quote")),
+    symbols(numCachedSymbols),
+    done(false)
+{
+}
+
+Reader::Reader(Allocator & _alloc, std::istream & _ist, std::size_t _chunkSize)
+  : alloc(_alloc),
+    ist(&_ist),
+    chunkSize(_chunkSize ? _chunkSize : defaultChunkSize),
+    batchSize(defaultBatchSize),
+    begin(nullptr),
+    pos(nullptr),
+    end(nullptr),
+    base(0),
+    allocations(0),
+    quote(alloc.makeRoot<Symbol>("quote")),
+    symbols(numCachedSymbols),
+    done(false)
+{
+}
+
+bool Reader::read(Object & value)
+{
+  // open lists of a failed read are discarded
+  frames.clear();
+  result = Lisp::nil;
+  done = false;
+  while(!done)
+  {
+    bool more = true;
+    {
+      // the expression is incomplete but reachable from result:
+      // the collector is only held during a batch of allocations
+      Allocator::Guard guard(alloc);
+      allocations = 0;
+      while(!done && allocations < batchSize && (more = skipSpace()))
+      {
+        token();
+      }
+    }
+    collect();
+    if(!more)
+    {
+      if(!frames.empty())
+      {
+        fail("unexpected end of input");
+      }
+      return false;
+    }
+  }
+  value = result;
+  result = Lisp::nil;
+  return true;
+}
+
+void Reader::collect()
+{
+  // the steps that the allocations of the batch have skipped
+  for(; allocations; allocations--)
+  {
+    alloc.step();
+    alloc.recycle();
+  }
+}
+
+std::vector<Object> Reader::readAll()
+{
+  std::vector<Object> values;
+  Object value;
+  while(read(value))
+  {
+    values.push_back(value);
+  }
+  return values;
+}
+
+bool Reader::refill()
+{
+  if(!ist || !*ist)
+  {
+    return false;
+  }
+  // keep the unread part [pos, end)
+  std::size_t keep = end - pos;
+  base += pos - begin;
+  if(buffer.size() < keep + chunkSize)
+  {
+    std::vector<char> tmp(keep + chunkSize);
+    if(keep)
+    {
+      std::memcpy(tmp.data(), pos, keep);
+    }
+    buffer.swap(tmp);
+  }
+  else if(keep)
+  {
+    std::memmove(buffer.data(), pos, keep);
+  }
+  ist->read(buffer.data() + keep, chunkSize);
+  std::size_t n = ist->gcount();
+  begin = pos = buffer.data();
+  end = pos + keep + n;
+  return n != 0;
+}
+
+bool Reader::skipSpace()
+{
+  while(true)
+  {
+    pos = skipWhitespace(pos, end);
+    if(pos == end)
+    {
+      if(!refill())
+      {
+        return false;
+      }
+    }
+    else if(*pos == ';')
+    {
+      skipLine();
+    }
+    else
+    {
+      return true;
+    }
+  }
+}
+
+void Reader::skipLine()
+{
+  while(true)
+  {
+    const char * nl = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+    if(nl)
+    {
+      pos = nl + 1;
+      return;
+    }
+    pos = end;
+    if(!refill())
+    {
+      return;
+    }
+  }
+}
+
+std::size_t Reader::scanToken()
+{
+  // refill keeps the token at pos
+  std::size_t n = findDelimiter(pos, end) - pos;
+  while(pos + n == end && refill())
+  {
+    n = findDelimiter(pos + n, end) - pos;
+  }
+  return n;
+}
+
+void Reader::token()
+{
+  Cons * cons;
+  bool cdr;
+  switch(*pos)
+  {
+  case '(':
+    reserve(cons, cdr);
+    ++pos;
+    open(cons, cdr, State::List);
+    break;
+  case ')':
+    close();
+    ++pos;
+    break;
+  case '\'':
+    {
+      // (quote . (datum . nil))
+      reserve(cons, cdr);
+      ++pos;
+      Cons * q = this->cons();
+      q->setCar(quote);
+      store(cons, cdr, consCell(q));
+      Cons * inner = this->cons();
+      q->setCdr(consCell(inner));
+      open(inner, false, State::Quote);
+    }
+    break;
+  case '"':
+    string();
+    break;
+  default:
+    {
+      std::size_t n = scanToken();
+      if(n == 1 && *pos == '.')
+      {
+        dot();
+        ++pos;
+        break;
+      }
+      Object value(atom(n));
+      reserve(cons, cdr);
+      pos += n;
+      store(cons, cdr, value);
+      complete();
+    }
+  }
+}
+
+Object Reader::atom(std::size_t n)
+{
+  std::size_t i = 0;
+  while(i < n && pos[i] >= '0' && pos[i] <= '9')
+  {
+    i++;
+  }
+  if(i == n)
+  {
+    // up to 19 digits cannot overflow
+    const std::size_t safeDigits = std::numeric_limits<UIntegerType>::digits10;
+    UIntegerType value = 0;
+    for(i = 0; i < n; i++)
+    {
+      UIntegerType digit = pos[i] - '0';
+      if(i >= safeDigits &&
+         value > (std::numeric_limits<UIntegerType>::max() - digit) / 10)
+      {
+        fail("integer out of range");
+      }
+      value = value * 10 + digit;
+    }
+    return Object(Cell(value));
+  }
+  if(n == 2 && pos[0] == '#' && (pos[1] == 't' || pos[1] == 'f'))
+  {
+    return Object::boolean(pos[1] == 't');
+  }
+  // recently read symbols are looked up without interning their name
+  std::size_t h = 2166136261u;
+  for(i = 0; i < n; i++)
+  {
+    h = (h ^ static_cast<unsigned char>(pos[i])) * 16777619u;
+  }
+  Object & cached = symbols[h % numCachedSymbols];
+  if(!cached.isA<Symbol>() ||
+     cached.as<Symbol>()->getName().size() != n ||
+     std::memcmp(cached.as<Symbol>()->getName().data(), pos, n) != 0)
+  {
+    cached = Object(alloc.makeRoot<Symbol>(std::string(pos, n)));
+  }
+  return cached;
+}
+
+void Reader::dot()
+{
+  if(frames.empty() || frames.back().state != State::List || !frames.back().tail)
+  {
+    fail("unexpected .");
+  }
+  frames.back().state = State::Dotted;
+}
+
+void Reader::string()
+{
+  std::string value;
+  ++pos;
+  while(true)
+  {
+    const char * p = findStringEnd(pos, end);
+    value.append(pos, p);
+    pos = p;
+    if(pos == end)
+    {
+      if(!refill())
+      {
+        fail("unterminated string");
+      }
+      continue;
+    }
+    if(*pos == '"')
+    {
+      ++pos;
+      break;
+    }
+    // escape sequence
+    ++pos;
+    if(pos == end && !refill())
+    {
+      fail("unterminated string");
+    }
+    switch(*pos)
+    {
+    case 'n':
+      value.push_back('\n');
+      break;
+    case 't':
+      value.push_back('\t');
+      break;
+    default:
+      value.push_back(*pos);
+    }
+    ++pos;
+  }
+  Cons * cons;
+  bool cdr;
+  reserve(cons, cdr);
+  store(cons, cdr, Object(alloc.makeRoot<String>(value)));
+  complete();
+}
+
+Cons * Reader::cons()
+{
+  ++allocations;
+  return alloc.make<Cons>(Lisp::nil, Lisp::nil);
+}
+
+void Reader::reserve(Cons *& cons, bool & cdr)
+{
+  // the next datum goes to the car of a new last cons of the open list
+  // (linked before the next allocation), to the cdr of the last cons
+  // after a dot or to the quoted cons
+  cons = nullptr;
+  cdr = false;
+  if(frames.empty())
+  {
+    return;
+  }
+  Frame & frame = frames.back();
+  switch(frame.state)
+  {
+  case State::List:
+    cons = this->cons();
+    if(frame.tail)
+    {
+      frame.tail->setCdr(consCell(cons));
+    }
+    else
+    {
+      store(frame.cons, frame.cdr, consCell(cons));
+    }
+    frame.tail = cons;
+    break;
+  case State::Dotted:
+    cons = frame.tail;
+    cdr = true;
+    frame.state = State::Closed;
+    break;
+  case State::Closed:
+    fail("expected )");
+    break;
+  case State::Quote:
+    cons = frame.cons;
+    break;
+  }
+}
+
+void Reader::store(Cons * cons, bool cdr, const Cell & value)
+{
+  if(!cons)
+  {
+    result = Object(value);
+  }
+  else if(cdr)
+  {
+    cons->setCdr(value);
+  }
+  else
+  {
+    cons->setCar(value);
+  }
+}
+
+void Reader::open(Cons * cons, bool cdr, State state)
+{
+  frames.push_back(Frame{cons, cdr, nullptr, state});
+}
+
+void Reader::close()
+{
+  if(frames.empty() || frames.back().state == State::Quote)
+  {
+    fail("unexpected )");
+  }
+  if(frames.back().state == State::Dotted)
+  {
+    fail("expected datum after .");
+  }
+  frames.pop_back();
+  complete();
+}
+
+void Reader::complete()
+{
+  while(!frames.empty() && frames.back().state == State::Quote)
+  {
+    frames.pop_back();
+  }
+  done = frames.empty();
+}
+
+void Reader::fail(const std::string & reason) const
+{
+  throw ParseError(getOffset(), reason);
+}
+
+std::vector<Object> Lisp::readFile(const std::string & path, Allocator & alloc)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+  {
+    throw IoError("open " + path, errno);
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0)
+  {
+    int error = errno;
+    ::close(fd);
+    throw IoError("stat " + path, error);
+  }
+  std::size_t size = st.st_size;
+  if(size == 0)
+  {
+    ::close(fd);
+    return std::vector<Object>();
+  }
+  void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if(data == MAP_FAILED)
+  {
+    throw IoError("mmap " + path, error);
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+  try
+  {
+    std::vector<Object> result(Reader(alloc, static_cast<const char*>(data), size).readAll());
+    munmap(data, size);
+    return result;
+  }
+  catch(...)
+  {
+    munmap(data, size);
+    throw;
+  }
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <lpp/core/object.h>
+
+namespace Lisp
+{
+  class Allocator;
+  class Cons;
+
+  /**
+   * Streaming reader of S-expressions.
+   *
+   * Reads lists (including dotted pairs), 'x as (quote x), unsigned
+   * integers, #t / #f, strings (escapes \n, \t, \\ and \") and symbols
+   * from a buffer or from an input stream that is read in chunks.
+   * Comments start with ; and extend to the end of the line.
+   *
+   * Conses are allocated unrooted (Allocator::make) and linked into the
+   * expression before the next allocation: lists are built front to
+   * back through their last cons, nested lists on an explicit stack
+   * of open lists, without recursion. Only the expression that is read
+   * is rooted, such that the collector may run between batches of
+   * allocations. During a batch the collector is held (Allocator::Guard),
+   * after the batch it catches up with the garbage and recycle steps of
+   * each allocation of the batch.
+   *
+   * Whitespace and delimiters are scanned 16 bytes at a time (SSE2)
+   * where available. Recently read symbols are cached by the reader.
+   */
+  class Reader
+  {
+  public:
+    static const std::size_t defaultChunkSize;
+    static const std::size_t defaultBatchSize;
+
+    /**
+     * Read from the buffer [data, data + size), which has to outlive
+     * the reader.
+     */
+    Reader(Allocator & _alloc, const char * data, std::size_t size);
+
+    /**
+     * Read from ist in chunks of chunkSize bytes.
+     */
+    Reader(Allocator & _alloc, std::istream & _ist,
+           std::size_t _chunkSize = defaultChunkSize);
+
+    Reader(const Reader & rhs) = delete;
+    Reader & operator=(const Reader & rhs) = delete;
+
+    /**
+     * Read the next expression.
+     * @return false at the end of the input
+     * @throw ParseError
+     */
+    bool read(Object & result);
+
+    /**
+     * Read all remaining expressions.
+     * @throw ParseError
+     */
+    std::vector<Object> readAll();
+
+    /**
+     * Number of allocations during which the collector is held.
+     */
+    inline std::size_t getBatchSize() const;
+    inline void setBatchSize(std::size_t n);
+
+    /**
+     * Byte position of the next character in the input.
+     */
+    inline std::size_t getOffset() const;
+
+  private:
+    static const std::size_t numCachedSymbols;
+
+    enum class State { List, Dotted, Closed, Quote };
+
+    // an open list: the list goes to the car or the cdr of cons (the
+    // result if cons is nullptr), tail is its last cons. The datum of a
+    // quote goes to the car of cons.
+    struct Frame
+    {
+      Cons * cons;
+      bool cdr;
+      Cons * tail;
+      State state;
+    };
+
+    void collect();
+    bool refill();
+    bool skipSpace();
+    void skipLine();
+    std::size_t scanToken();
+    void token();
+    Object atom(std::size_t n);
+    void dot();
+    void string();
+    Cons * cons();
+    void reserve(Cons *& cons, bool & cdr);
+    void store(Cons * cons, bool cdr, const Cell & value);
+    void open(Cons * cons, bool cdr, State state);
+    void close();
+    void complete();
+    void fail(const std::string & reason) const;
+
+    Allocator & alloc;
+    std::istream * ist;
+    std::size_t chunkSize;
+    std::size_t batchSize;
+    std::vector<char> buffer;
+    // [begin, end) is the part of the input at byte position base
+    const char * begin;
+    const char * pos;
+    const char * end;
+    std::size_t base;
+    std::vector<Frame> frames;
+    std::size_t allocations;
+    Object result;
+    Object quote;
+    std::vector<Object> symbols;
+    bool done;
+  };
+
+  /**
+   * Map the file path into memory and read all its expressions.
+   * @throw ParseError if the file is malformed
+   * @throw IoError if the file cannot be opened or mapped
+   */
+  std::vector<Object> readFile(const std::string & path, Allocator & alloc);
+}
+
+/******************************************************************************
+ * implementation
+ ******************************************************************************/
+inline std::size_t Lisp::Reader::getBatchSize() const
+{
+  return batchSize;
+}
+
+inline void Lisp::Reader::setBatchSize(std::size_t n)
+{
+  batchSize = n ? n : 1;
+}
+
+inline std::size_t Lisp::Reader::getOffset() const
+{
+  return base + (pos - begin);
+}
@@ -0,0 +1,149 @@
+#include <lpp/core/scheduler.h>
+#include <lpp/core/vm.h>
+#include <lpp/core/types/continuation.h>
+#include <lpp/core/exception.h>
+
+using Scheduler = Lisp::Scheduler;
+using Continuation = Lisp::Continuation;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Vm = Lisp::Vm;
+using Timeout = Lisp::Timeout;
+
+namespace
+{
+  thread_local Scheduler * currentScheduler = nullptr;
+
+  class CurrentScheduler
+  {
+  public:
+    CurrentScheduler(Scheduler * scheduler) : previous(currentScheduler)
+    {
+      currentScheduler = scheduler;
+    }
+
+    ~CurrentScheduler()
+    {
+      currentScheduler = previous;
+    }
+
+  private:
+    Scheduler * previous;
+  };
+}
+
+Scheduler::Scheduler(Vm & _vm, std::size_t _slice)
+  : vm(_vm), slice(_slice), parked(0), steps(0), parking(false)
+{
+}
+
+Scheduler * Scheduler::current()
+{
+  return currentScheduler;
+}
+
+Object Scheduler::spawn(const Cell & func)
+{
+  Object cont = vm.make<Continuation>(func);
+  cont.as<Continuation>()->setMaxStackSize(vm.getMaxStackSize());
+  cont.as<Continuation>()->setProfiler(vm.getProfiler().get());
+  cont.as<Continuation>()->setInstrumentation(&vm.getInstrumentation());
+  cont.as<Continuation>()->setBudget(vm.getBudget());
+  if(vm.getTimeLimit() != Continuation::Clock::duration::zero())
+  {
+    cont.as<Continuation>()->setDeadline(Continuation::Clock::now() + vm.getTimeLimit());
+  }
+  queue.push_back(cont);
+  return cont;
+}
+
+bool Scheduler::step()
+{
+  if(parked && (queue.empty() || steps >= queue.size()))
+  {
+    // block only if there is nothing else to do
+    steps = 0;
+    loop.poll(queue.empty() ? -1 : 0);
+  }
+  if(queue.empty())
+  {
+    return parked != 0;
+  }
+  ++steps;
+  running = std::move(queue.front());
+  queue.pop_front();
+  parking = false;
+  bool finished;
+  {
+    CurrentScheduler guard(this);
+    try
+    {
+      finished = running.as<Continuation>()->run(slice);
+    }
+    catch(...)
+    {
+      running = Lisp::nil;
+      throw;
+    }
+  }
+  if(!finished && running.as<Continuation>()->isExhausted())
+  {
+    Object cont(std::move(running));
+    running = Lisp::nil;
+    throw Timeout(cont);
+  }
+  if(!finished && !parking)
+  {
+    queue.push_back(std::move(running));
+  }
+  running = Lisp::nil;
+  return true;
+}
+
+void Scheduler::park(int fd, EventLoop::Event event, Retry retry)
+{
+  assert(running.isA<Continuation>());
+  assert(!parking);
+  resumeWhenReady(running, fd, event, std::move(retry));
+  parking = true;
+  ++parked;
+}
+
+void Scheduler::resumeWhenReady(const Object & cont, int fd,
+                                EventLoop::Event event, Retry retry)
+{
+  loop.wait(fd, event, [this, cont, fd, event, retry]() {
+      Object result;
+      bool done;
+      try
+      {
+        done = retry(result);
+      }
+      catch(...)
+      {
+        // the green thread fails at the call of the builtin
+        // (e.g. fd has been closed by another green thread)
+        cont.as<Continuation>()->setError(std::current_exception());
+        --parked;
+        queue.push_back(cont);
+        return;
+      }
+      if(done)
+      {
+        cont.as<Continuation>()->setResult(result);
+        --parked;
+        queue.push_back(cont);
+      }
+      else
+      {
+        resumeWhenReady(cont, fd, event, retry);
+      }
+  });
+}
+
+void Scheduler::run()
+{
+  while(step())
+  {
+  }
+}
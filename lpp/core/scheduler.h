@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <lpp/core/object.h>
+#include <lpp/core/event_loop.h>
+
+namespace Lisp
+{
+  class Vm;
+
+  /**
+   * Cooperative scheduler for green threads.
+   * Each green thread is a Continuation. The scheduler runs the
+   * continuations of its run queue in turn until they yield, their time
+   * slice is used up or they finish. All continuations run on the
+   * thread that calls run() / step().
+   *
+   * Green threads that wait for I/O (read-fd, write-fd, bound by
+   * Builtin::defineIo) are parked on the event loop of the scheduler and do not occupy
+   * the run queue: a single thread overlaps the I/O of all its
+   * green threads. The event loop is polled once per round through
+   * the run queue, and blocks when all green threads are parked.
+   */
+  class Scheduler
+  {
+  public:
+    /**
+     * @param slice number of function calls after which a green thread
+     *        is preempted, 0: green threads run until they yield.
+     */
+    Scheduler(Vm & _vm, std::size_t _slice = 0);
+
+    /**
+     * Add a green thread that evaluates func (a function without
+     * arguments).
+     * @return the Continuation, see Continuation::isFinished()
+     *         and Continuation::eval() for the result.
+     */
+    Object spawn(const Cell & func);
+
+    /**
+     * Run the next green thread of the queue.
+     * Exceptions of the green thread are propagated, the thread is
+     * removed from the queue. A green thread that exhausts its budget
+     * or time limit (see Vm::setBudget) raises Timeout.
+     * @return false if the queue is empty
+     */
+    bool step();
+
+    /**
+     * Run until all green threads have finished.
+     */
+    void run();
+
+    /**
+     * Retry of an I/O operation that would block: returns false if it
+     * still would block, otherwise true and the result of the builtin.
+     */
+    using Retry = std::function<bool(Object & result)>;
+
+    /**
+     * Park the running green thread until fd is ready for event and
+     * retry succeeds. The result of retry replaces the result of the
+     * suspending builtin that called park (see Continuation::setResult),
+     * an exception of retry is raised by the green thread when it is
+     * resumed (see Continuation::setError).
+     */
+    void park(int fd, EventLoop::Event event, Retry retry);
+
+    /**
+     * Scheduler that is running a green thread on this thread,
+     * nullptr if there is none.
+     */
+    static Scheduler * current();
+
+    /**
+     * Number of green threads (running and parked).
+     */
+    inline std::size_t size() const;
+    inline std::size_t numParked() const;
+    inline EventLoop & getEventLoop();
+    inline std::size_t getSlice() const;
+    inline void setSlice(std::size_t _slice);
+
+  private:
+    void resumeWhenReady(const Object & cont, int fd, EventLoop::Event event,
+                         Retry retry);
+
+    Vm & vm;
+    std::size_t slice;
+    std::deque<Object> queue;
+    EventLoop loop;
+    std::size_t parked;
+    // steps since the event loop has been polled
+    std::size_t steps;
+    // green thread of the current step, and whether it has been parked
+    Object running;
+    bool parking;
+  };
+}
+
+inline std::size_t Lisp::Scheduler::size() const
+{
+  return queue.size() + parked;
+}
+
+inline std::size_t Lisp::Scheduler::numParked() const
+{
+  return parked;
+}
+
+inline Lisp::EventLoop & Lisp::Scheduler::getEventLoop()
+{
+  return loop;
+}
+
+inline std::size_t Lisp::Scheduler::getSlice() const
+{
+  return slice;
+}
+
+inline void Lisp::Scheduler::setSlice(std::size_t _slice)
+{
+  slice = _slice;
+}
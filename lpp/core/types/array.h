@@ -31,6 +31,7 @@ either expressed or implied, of the FreeBSD Project.
 #pragma once
 #include <vector>
 #include <lpp/core/object.h>
+#include <lpp/core/exception.h>
 #include <lpp/core/types/container.h>
 
 namespace Lisp
@@ -46,6 +47,9 @@ namespace Lisp
     inline Object at(std::size_t pos) const;
     inline Object operator[](std::size_t pos) const;
 
+    /**
+     * Modifiers throw FrozenObject if the array is frozen.
+     */
     inline void set(std::size_t pos, const Cell & rhs);
     inline void set(std::size_t pos, Cell && rhs);
 
@@ -132,6 +136,10 @@ inline Lisp::Object Lisp::Array::operator[](std::size_t pos) const
 
 inline void Lisp::Array::set(std::size_t pos, const Cell & rhs)
 {
+  if(isFrozen())
+  {
+    throw FrozenObject(Cell(this));
+  }
   assert(pos < data.size());
   data[pos] = rhs;
   data[pos].grey();
@@ -139,6 +147,10 @@ inline void Lisp::Array::set(std::size_t pos, const Cell & rhs)
 
 inline void Lisp::Array::set(std::size_t pos, Cell && rhs)
 {
+  if(isFrozen())
+  {
+    throw FrozenObject(Cell(this));
+  }
   assert(pos < data.size());
   data[pos] = rhs;
   data[pos].grey();
@@ -150,6 +162,10 @@ inline void Lisp::Array::append()
 
 inline void Lisp::Array::append(const Cell & rhs)
 {
+  if(isFrozen())
+  {
+    throw FrozenObject(Cell(this));
+  }
   rhs.grey();
   data.push_back(rhs);
 }
@@ -0,0 +1,38 @@
+#include <lpp/core/types/captured_continuation.h>
+
+using CapturedContinuation = Lisp::CapturedContinuation;
+using StackView = Lisp::StackView;
+using Cell = Lisp::Cell;
+using TypeId = Lisp::TypeId;
+
+CapturedContinuation::CapturedContinuation(const StackView & _view)
+  : view(_view)
+{
+}
+
+TypeId CapturedContinuation::getTypeId() const
+{
+  return TypeTraits<CapturedContinuation>::getTypeId();
+}
+
+void CapturedContinuation::forEachChild(std::function<void(const Cell&)> func) const
+{
+  view.forEachCell(func);
+}
+
+bool CapturedContinuation::greyChildren()
+{
+  view.forEachCell([](const Cell & c) { c.grey(); });
+  return true;
+}
+
+void CapturedContinuation::resetGcPosition()
+{
+}
+
+bool CapturedContinuation::recycleNextChild()
+{
+  // the segments are shared and immutable, they release their
+  // cells when the last view is destroyed
+  return true;
+}
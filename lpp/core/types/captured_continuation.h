@@ -0,0 +1,40 @@
+#pragma once
+#include <lpp/core/cell.h>
+#include <lpp/core/types/type_id.h>
+#include <lpp/core/types/container.h>
+#include <lpp/core/types/continuation.h>
+
+namespace Lisp
+{
+  /**
+   * First-class continuation created by call/cc.
+   * Calling it with a value discards the stack of the calling
+   * continuation and returns the value from the call/cc expression
+   * that created it. It refers to the captured stack segments and keeps
+   * their cells alive.
+   */
+  class CapturedContinuation : public Container
+  {
+  public:
+    CapturedContinuation(const StackView & _view);
+
+    inline const StackView & getView() const;
+
+    //////////////////////////////////////////////////
+    // implementation of the Container interface
+    //////////////////////////////////////////////////
+    virtual TypeId getTypeId() const override;
+    virtual void forEachChild(std::function<void(const Cell&)> func) const override;
+    virtual bool greyChildren() override;
+    virtual void resetGcPosition() override;
+    virtual bool recycleNextChild() override;
+
+  private:
+    StackView view;
+  };
+}
+
+inline const Lisp::StackView & Lisp::CapturedContinuation::getView() const
+{
+  return view;
+}
@@ -0,0 +1,88 @@
+#include <lpp/core/types/closure.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/exception.h>
+
+using Closure = Lisp::Closure;
+using Cell = Lisp::Cell;
+using TypeId = Lisp::TypeId;
+
+Closure::Closure(const Cell & func, const Cell * captured, std::size_t n)
+  : gcPosition(0)
+{
+  assert(func.isA<Function>());
+  values.reserve(n + 1);
+  values.push_back(func);
+  values.insert(values.end(), captured, captured + n);
+  for(const Cell & c : values)
+  {
+    c.grey();
+  }
+}
+
+Closure::Closure(std::size_t n)
+  : values(n + 1, Lisp::nil), gcPosition(0)
+{
+}
+
+void Closure::set(std::size_t i, const Cell & value)
+{
+  if(isFrozen())
+  {
+    throw Lisp::FrozenObject(Cell(this));
+  }
+  assert(i < values.size());
+  values[i] = value;
+  values[i].grey();
+}
+
+TypeId Closure::getTypeId() const
+{
+  return TypeTraits<Closure>::getTypeId();
+}
+
+void Closure::forEachChild(std::function<void(const Cell&)> func) const
+{
+  for(const Cell & c : values)
+  {
+    func(c);
+  }
+}
+
+bool Closure::greyChildren()
+{
+  if(gcPosition < values.size())
+  {
+    values[gcPosition].grey();
+    if(++gcPosition == values.size())
+    {
+      gcPosition = 0;
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  else
+  {
+    return true;
+  }
+}
+
+void Closure::resetGcPosition()
+{
+  gcPosition = 0;
+}
+
+bool Closure::recycleNextChild()
+{
+  if(gcPosition < values.size())
+  {
+    if(!values[gcPosition].isA<Collectible>())
+    {
+      values[gcPosition] = Lisp::nil;
+    }
+    return ++gcPosition == values.size();
+  }
+  return true;
+}
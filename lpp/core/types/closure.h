@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <lpp/core/cell.h>
+#include <lpp/core/types/type_id.h>
+#include <lpp/core/types/container.h>
+#include <lpp/core/types/function.h>
+
+namespace Lisp
+{
+  class Function;
+
+  /**
+   * Flat closure: a function and the values of its free variables.
+   * Created by the CLOSURE instruction when a lambda expression with
+   * free variables is evaluated. The captured values are copied,
+   * they are not shared with the frame of the enclosing function.
+   */
+  class Closure : public Container
+  {
+  public:
+    Closure(const Cell & func, const Cell * captured, std::size_t n);
+
+    /**
+     * Closure with n captured values that are set later (see image.h).
+     * All values are nil.
+     */
+    Closure(std::size_t n);
+
+    inline Function * getFunction() const;
+    inline const Cell & getFunctionCell() const;
+    inline std::size_t numCaptured() const;
+    inline const Cell & getCaptured(std::size_t i) const;
+
+    /**
+     * Replace the function (i = 0) or the captured value i - 1.
+     * Throws FrozenObject if the closure is frozen.
+     */
+    void set(std::size_t i, const Cell & value);
+
+    //////////////////////////////////////////////////
+    // implementation of the Container interface
+    //////////////////////////////////////////////////
+    virtual TypeId getTypeId() const override;
+    virtual void forEachChild(std::function<void(const Cell&)> func) const override;
+    virtual bool greyChildren() override;
+    virtual void resetGcPosition() override;
+    virtual bool recycleNextChild() override;
+
+  private:
+    // function followed by the captured values
+    std::vector<Cell> values;
+    std::size_t gcPosition;
+  };
+}
+
+inline Lisp::Function * Lisp::Closure::getFunction() const
+{
+  return values.front().as<Function>();
+}
+
+inline const Lisp::Cell & Lisp::Closure::getFunctionCell() const
+{
+  return values.front();
+}
+
+inline std::size_t Lisp::Closure::numCaptured() const
+{
+  return values.size() - 1;
+}
+
+inline const Lisp::Cell & Lisp::Closure::getCaptured(std::size_t i) const
+{
+  assert(i + 1 < values.size());
+  return values[i + 1];
+}
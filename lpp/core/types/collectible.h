@@ -46,6 +46,12 @@ namespace Lisp
 
     inline Color getColor() const;
     inline bool isRoot() const;
+
+    /**
+     * True if the object has been moved to the permanent space
+     * with Allocator::freeze().
+     */
+    inline bool isFrozen() const;
     inline std::size_t getIndex() const;
     inline Allocator * getAllocator() const;
     inline CollectibleContainer<T> * getContainer() const;
@@ -63,6 +69,7 @@ namespace Lisp
 template<typename T>
 inline Lisp::CollectibleMixin<T>::CollectibleMixin()
 {
+  container = nullptr;
   refCount = 0;
 }
 
@@ -84,6 +91,13 @@ bool Lisp::CollectibleMixin<T>::isRoot() const
   return container->isRoot();
 }
 
+template<typename T>
+bool Lisp::CollectibleMixin<T>::isFrozen() const
+{
+  // embedded objects (e.g. the data array of a function) have no container
+  return container && container->isPermanent();
+}
+
 template<typename T>
 std::size_t Lisp::CollectibleMixin<T>::getIndex() const
 {
@@ -36,6 +36,7 @@ either expressed or implied, of the FreeBSD Project.
 #include <lpp/core/types/collectible.h>
 #include <lpp/core/types/type_id.h>
 #include <lpp/core/object.h>
+#include <lpp/core/exception.h>
 #include <lpp/core/types/array.h>
 
 namespace Lisp
@@ -66,6 +67,10 @@ namespace Lisp
     inline const Cell & getCdrCell() const;
     inline void unsetCar();
     inline void unsetCdr();
+    /**
+     * Set car / cdr.
+     * Throws FrozenObject if the cons is frozen.
+     */
     inline void setCar(const Cell & rhs);
     inline void setCdr(const Cell & rhs);
 
@@ -148,6 +153,10 @@ inline void Lisp::BasicCons::unsetCdr()
 
 inline void Lisp::BasicCons::setCar(const Cell & rhs)
 {
+  if(isFrozen())
+  {
+    throw FrozenObject(Cell(this, getTypeId()));
+  }
   if(rhs.isA<BasicCons>())
   {
     setCarCdr(car, rhs.data.pCons, rhs.getTypeId());
@@ -168,6 +177,10 @@ inline void Lisp::BasicCons::setCar(const Cell & rhs)
 
 inline void Lisp::BasicCons::setCdr(const Cell & rhs)
 {
+  if(isFrozen())
+  {
+    throw FrozenObject(Cell(this, getTypeId()));
+  }
   if(rhs.isA<BasicCons>())
   {
     setCarCdr(cdr, rhs.data.pCons, rhs.getTypeId());
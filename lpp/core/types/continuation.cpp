@@ -1,12 +1,33 @@
+#include <limits>
 #include <lpp/core/types/continuation.h>
 #include <lpp/core/types/function.h>
+#include <lpp/core/types/closure.h>
+#include <lpp/core/types/captured_continuation.h>
 #include <lpp/core/object.h>
 #include <lpp/core/env.h>
+#include <lpp/core/builtins.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+#include <lpp/core/profiler.h>
+#include <lpp/core/instrumentation.h>
+#include <lpp/core/verifier.h>
 
 using Cell = Lisp::Cell;
 using Continuation = Lisp::Continuation;
 using ContinuationState = Lisp::ContinuationState;
+using StackView = Lisp::StackView;
+using StackSegment = Lisp::StackSegment;
+using CapturedContinuation = Lisp::CapturedContinuation;
+using NonMatchingArguments = Lisp::NonMatchingArguments;
+using MissingClosure = Lisp::MissingClosure;
+using NotAFunction = Lisp::NotAFunction;
+using InvalidBytecode = Lisp::InvalidBytecode;
 using TypeId = Lisp::TypeId;
+using Object = Lisp::Object;
+using Function = Lisp::Function;
+using Cons = Lisp::Cons;
+using UIntegerType = Lisp::UIntegerType;
+using Closure = Lisp::Closure;
+using Timeout = Lisp::Timeout;
 
 // logging data stack
 #ifdef DO_ASM_LOG
@@ -21,6 +42,98 @@ using TypeId = Lisp::TypeId;
 #define LOG_DATA_STACK(STACK)
 #endif
 
+// instrumentation (see instrumentation.h)
+#ifdef DO_INSTRUMENT
+#define INSTRUMENT_HOOK(EXPR)                   \
+  if(instrumentation)                           \
+  {                                             \
+    instrumentation->EXPR;                      \
+  }
+#else
+#define INSTRUMENT_HOOK(EXPR)
+#endif
+
+// instruction dispatch
+// threaded: every handler jumps directly to the handler of the next
+//           instruction, or to the end of the function.
+// switch:   portable fallback
+#ifdef DO_THREADED_DISPATCH
+#define DISPATCH_TABLE_SIZE Lisp::NUM_OPCODES
+#define OP_CASE(OP) L_##OP: INSTRUMENT_HOOK(begin(OP))
+#define OP_DEFAULT L_DEFAULT:
+#define OP_NEXT                                                   \
+  if(s.itr == s.end)                                              \
+  {                                                               \
+    goto L_END;                                                   \
+  }                                                               \
+  goto *(*s.itr < DISPATCH_TABLE_SIZE ?                           \
+         dispatchTable[*s.itr] : &&L_DEFAULT);
+#else
+#define OP_CASE(OP) case OP: INSTRUMENT_HOOK(begin(OP))
+#define OP_DEFAULT default:
+#define OP_NEXT break;
+#endif
+
+// functions are verified on their first call (see verifier.h). A frame
+// of a verified function never exceeds the maximum stack depth of the
+// function: the room is reserved on entry and the handlers push without
+// capacity checks.
+#define ENTER_FRAME                                                     \
+  stack.reserve(s.stackFramePos + frameSize(*s.f, stack, s.stackFramePos));
+
+// sampling profiler (see profiler.h)
+#define PROFILER_SAFE_POINT                     \
+  if(profiler && profiler->due())               \
+  {                                             \
+    callStack.back() = s;                       \
+    profiler->sample(*this);                    \
+  }
+
+// function of a callee (Function or Closure)
+static inline Function * calleeFunction(const Cell & cell)
+{
+  if(cell.isA<Function>())
+  {
+    if(cell.as<Function>()->numCaptured())
+    {
+      // PUSHC reads the captured values from the closure
+      throw MissingClosure(cell);
+    }
+    return cell.as<Function>();
+  }
+  else if(cell.isA<Closure>())
+  {
+    return cell.as<Closure>()->getFunction();
+  }
+  else
+  {
+    throw NotAFunction(cell);
+  }
+}
+
+// maximum number of cells of the frame at sf: the rest arguments
+// are not part of the maximum stack depth of the function. Once the
+// rest list is built (see PUSHR), the number of rest arguments is kept
+// in the slot following the rest parameter.
+static inline std::size_t frameSize(Function & f,
+                                    const Lisp::ValueStack & stack,
+                                    std::size_t sf)
+{
+  std::size_t n = Lisp::verified(f);
+  if(f.hasRestArgument())
+  {
+    std::size_t pos = sf + f.numArguments();
+    if(stack[pos].isA<UIntegerType>())
+    {
+      n += stack[pos].as<UIntegerType>();
+    }
+    else
+    {
+      n += stack[pos + 1].as<UIntegerType>();
+    }
+  }
+  return n;
+}
 
 inline ContinuationState::ContinuationState(Function * _f,
                                             std::size_t _stackFramePos)
@@ -30,27 +143,110 @@ inline ContinuationState::ContinuationState(Function * _f,
   end = f->cend();
 }
 
+void StackView::forEachCell(std::function<void(const Cell&)> func) const
+{
+  const StackView * view = this;
+  while(view->segment)
+  {
+    for(std::size_t i = 0; i < view->numCells; i++)
+    {
+      func(view->segment->cells[i]);
+    }
+    view = &view->segment->below;
+  }
+}
+
+std::size_t ContinuationState::getOffset() const
+{
+  return itr - f->cbegin();
+}
+
+const std::size_t Continuation::unlimited = std::numeric_limits<std::size_t>::max();
+const std::size_t Continuation::deadlineInterval = 1024;
+
 Continuation::Continuation(const Cell & func,
                            const std::shared_ptr<Env> & _env)
-  : callStack({ContinuationState(func.as<Function>(), 0)}),
+  : callStack({ContinuationState(calleeFunction(func), 0)}),
     env(_env)
 {
-  assert(func.isA<Function>());
-  assert(stack.size() == func.as<Function>()->numArguments());
+  assert(calleeFunction(func)->acceptsArguments(0));
   stack.push_back(func);
+  bindArguments(*calleeFunction(func), 0);
   dsPosition = 0;
 }
 
 Continuation::Continuation(std::vector<Lisp::Cell> && _stack, const std::shared_ptr<Env> & _env)
-  : stack(std::move(_stack)), env(_env)
+  : env(_env)
 {
-  assert(!stack.empty());
-  assert(stack.front().isA<Function>());
-  assert((stack.front().as<Function>()->numArguments() + 1) == stack.size());
-  callStack.emplace_back(stack.front().as<Function>(), 0);
+  assert(!_stack.empty());
+  for(const Cell & c : _stack)
+  {
+    stack.push_back(c);
+  }
+  assert(calleeFunction(stack[0])->acceptsArguments(stack.size() - 1));
+  bindArguments(*calleeFunction(stack[0]), stack.size() - 1);
+  callStack.emplace_back(calleeFunction(stack[0]), 0);
   dsPosition = 0;
 }
 
+Continuation::Continuation(const std::shared_ptr<Env> & _env)
+  : dsPosition(0), env(_env)
+{
+}
+
+void Continuation::reset()
+{
+  stack.truncate(0);
+  callStack.clear();
+  below = StackView();
+  dsPosition = 0;
+  exhausted = false;
+}
+
+void Continuation::call(std::size_t nargs)
+{
+  assert(isFinished());
+  assert(stack.size() == nargs + 1);
+  if(stack[0].isA<BuiltinFunction>() &&
+     stack[0].as<BuiltinFunction>()->getOpcode() == CALLCC && nargs == 1)
+  {
+    // the continuation of (call/cc f) returns from the evaluation:
+    // (f k) with a continuation k of no frames
+    stack[0] = stack[1];
+    stack[1] = Cell(getAllocator()->make<CapturedContinuation>(StackView()),
+                    TypeTraits<CapturedContinuation>::getTypeId());
+    stack[1].grey();
+  }
+  if(stack[0].isA<BuiltinFunction>())
+  {
+    // no frame: the result is the result of the evaluation
+    Object result(stack[0].as<BuiltinFunction>()->call(*getAllocator(),
+                                                       stack.data() + 1,
+                                                       nargs));
+    stack.truncate(0);
+    stack.push_back(result);
+  }
+  else if(stack[0].isA<CapturedContinuation>())
+  {
+    // resume the frames of k
+    if(nargs > 1)
+    {
+      throw NonMatchingArguments(nargs, stack[0].as<CapturedContinuation>());
+    }
+    Cell k(stack[0]);
+    k.grey();
+    resume(k.as<CapturedContinuation>()->getView(),
+           nargs ? stack.back() : Lisp::nil);
+    underflow();
+  }
+  else
+  {
+    // throws NotAFunction for any other value
+    Function * f = calleeFunction(stack[0]);
+    bindArguments(*f, nargs);
+    callStack.emplace_back(f, 0);
+  }
+}
 
 TypeId Continuation::getTypeId() const
 {
@@ -63,6 +259,7 @@ void Continuation::forEachChild(std::function<void(const Cell&)> func) const
   {
     func(c);
   }
+  below.forEachCell(func);
 }
 
 bool Continuation::greyChildren()
@@ -70,20 +267,14 @@ bool Continuation::greyChildren()
   if(dsPosition < stack.size())
   {
     stack[dsPosition].grey();
-    if(++dsPosition == stack.size())
-    {
-      dsPosition = 0;
-      return true;
-    }
-    else
+    if(++dsPosition < stack.size())
     {
       return false;
     }
   }
-  else
-  {
-    return true;
-  }
+  dsPosition = 0;
+  below.forEachCell([](const Cell & c) { c.grey(); });
+  return true;
 }
 
 void Continuation::resetGcPosition()
@@ -104,13 +295,208 @@ bool Continuation::recycleNextChild()
   return true;
 }
 
+const StackView & Continuation::capture(std::size_t pos)
+{
+  assert(pos <= stack.size());
+  auto segment = std::make_shared<StackSegment>();
+  segment->cells.assign(stack.begin(), stack.begin() + pos);
+  segment->frames.swap(callStack);
+  segment->below = below;
+  below.numFrames = segment->frames.size();
+  below.numCells = pos;
+  below.segment = segment;
+  stack.shift(0, stack.size() - pos);
+  return below;
+}
+
+void Continuation::resume(const StackView & view, const Cell & value)
+{
+  Cell result(value);
+  StackView target(view);
+  stack.truncate(0);
+  callStack.clear();
+  below = target;
+  stack.push_back(result);
+}
+
+std::size_t Continuation::bindArguments(Function & f, std::size_t nargs)
+{
+  if(!f.acceptsArguments(nargs))
+  {
+    throw NonMatchingArguments(nargs, &f);
+  }
+  std::size_t nfixed = f.numArguments() - (f.hasRestArgument() ? 1 : 0);
+  for(; nargs < nfixed; nargs++)
+  {
+    // missing optional argument
+    stack.push_back(Lisp::nil);
+  }
+  if(f.hasRestArgument())
+  {
+    // the rest arguments stay where they are, the slot of the
+    // rest parameter holds their number
+    std::size_t nrest = nargs - nfixed;
+    stack.insert(stack.size() - nrest, Cell(UIntegerType(nrest)));
+    nargs++;
+  }
+  return nargs;
+}
+
+void Continuation::underflow()
+{
+  assert(callStack.empty());
+  if(!below.segment)
+  {
+    return;
+  }
+  assert(stack.size() == 1);
+  std::shared_ptr<const StackSegment> segment(below.segment);
+  const ContinuationState & frame = segment->frames[below.numFrames - 1];
+  std::size_t begin = frame.stackFramePos;
+  Cell result(stack.back());
+  stack.truncate(0);
+  for(std::size_t i = begin; i < below.numCells; i++)
+  {
+    stack.push_back(segment->cells[i]);
+    stack.back().grey();
+  }
+  stack.push_back(result);
+  callStack.push_back(frame);
+  callStack.back().stackFramePos = 0;
+  if(below.numFrames == 1)
+  {
+    below = segment->below;
+  }
+  else
+  {
+    below.numFrames--;
+    below.numCells = begin;
+  }
+}
+
+void Continuation::forEachFrame(std::function<void(const ContinuationState&)> func) const
+{
+  std::vector<const StackView*> views;
+  for(const StackView * view = &below; view->segment; view = &view->segment->below)
+  {
+    views.push_back(view);
+  }
+  for(auto itr = views.rbegin(); itr != views.rend(); ++itr)
+  {
+    for(std::size_t i = 0; i < (*itr)->numFrames; i++)
+    {
+      func((*itr)->segment->frames[i]);
+    }
+  }
+  for(const ContinuationState & state : callStack)
+  {
+    func(state);
+  }
+}
+
 Cell & Continuation::eval()
 {
+  while(!run())
+  {
+    if(exhausted)
+    {
+      throw Timeout(Cell(this));
+    }
+  }
+  return stack.back();
+}
+
+std::size_t Continuation::nextCheck(std::size_t slice) const
+{
+  std::size_t n = slice < budget ? slice : budget;
+  if(hasDeadline && deadlineInterval < n)
+  {
+    n = deadlineInterval;
+  }
+  return n;
+}
+
+bool Continuation::checkpoint(std::size_t & issued, std::size_t & slice)
+{
+  if(slice != unlimited)
+  {
+    slice -= issued;
+  }
+  if(budget != unlimited)
+  {
+    budget -= issued;
+  }
+  if(budget == 0 || (hasDeadline && Clock::now() >= deadline))
+  {
+    exhausted = true;
+    return true;
+  }
+  if(slice == 0)
+  {
+    return true;
+  }
+  issued = nextCheck(slice);
+  return false;
+}
+
+bool Continuation::run(std::size_t slice)
+{
+  if(callStack.empty())
+  {
+    return true;
+  }
+  if(error)
+  {
+    std::exception_ptr e(std::move(error));
+    error = nullptr;
+    std::rethrow_exception(e);
+  }
+  // a single counter is decremented per call: the time slice, the
+  // budget and the deadline are only checked when it reaches zero
+  exhausted = false;
+  if(!slice)
+  {
+    slice = unlimited;
+  }
+  std::size_t issued = nextCheck(slice);
+  if(!issued)
+  {
+    exhausted = true;
+    return false;
+  }
+  std::size_t countdown = issued;
+  INSTRUMENT_HOOK(cancel());
+#ifdef DO_THREADED_DISPATCH
+  // constant initialized once, indexed by opcode
+  static_assert(RETURNS == 0x02 && RETURNL == 0x03 && DEFINES == 0x05 &&
+                FUNCALL == 0x06 && PUSHL == 0x13 && PUSHV == 0x14 &&
+                PUSHV2 == 0x15 && PUSHVFUNCALL == 0x16 &&
+                PUSHLFUNCALL == 0x17 && CAR == 0x18 && CDR == 0x19 &&
+                CONS == 0x1a && EQ == 0x1b && ADD == 0x1c && SUB == 0x1d &&
+                LT == 0x1e && PUSHA == 0x1f && PUSHC == 0x20 &&
+                CLOSURE == 0x21 && CALLCC == 0x22 && PUSHR == 0x23 &&
+                DISPATCH_TABLE_SIZE == 0x24,
+                "dispatch table does not match the opcodes");
+  static void * const dispatchTable[DISPATCH_TABLE_SIZE] = {
+    /* 0x00 */ &&L_DEFAULT, &&L_DEFAULT, &&L_RETURNS, &&L_RETURNL,
+    /* 0x04 */ &&L_DEFAULT, &&L_DEFINES, &&L_FUNCALL, &&L_DEFAULT,
+    /* 0x08 */ &&L_DEFAULT, &&L_DEFAULT, &&L_DEFAULT, &&L_DEFAULT,
+    /* 0x0c */ &&L_DEFAULT, &&L_DEFAULT, &&L_DEFAULT, &&L_DEFAULT,
+    /* 0x10 */ &&L_DEFAULT, &&L_DEFAULT, &&L_DEFAULT, &&L_PUSHL,
+    /* 0x14 */ &&L_PUSHV, &&L_PUSHV2, &&L_PUSHVFUNCALL, &&L_PUSHLFUNCALL,
+    /* 0x18 */ &&L_CAR, &&L_CDR, &&L_CONS, &&L_EQ,
+    /* 0x1c */ &&L_ADD, &&L_SUB, &&L_LT, &&L_PUSHA,
+    /* 0x20 */ &&L_PUSHC, &&L_CLOSURE, &&L_CALLCC, &&L_PUSHR
+  };
+#endif
   ContinuationState s(callStack.back());
   while(!callStack.empty())
   {
     s = callStack.back();
     std::size_t sf = s.stackFramePos;
+    ContinuationState::const_iterator instr;
+    std::size_t operand;
+    Function * callee;
     ASM_LOG("----------------------------------");
     ASM_LOG("eval        " << s.f);
     ASM_LOG("nargs       " << s.f->numArguments());
@@ -118,126 +504,457 @@ Cell & Continuation::eval()
     ASM_LOG("pos         " << (s.itr - s.f->cbegin()) << "/"  << (s.end - s.f->cbegin()));
     LOG_DATA_STACK(stack);
     ASM_LOG("----------------------------------");
-    s.f->makeReference(stack.end());
+    ENTER_FRAME;
+    PROFILER_SAFE_POINT;
+#ifdef DO_THREADED_DISPATCH
+    OP_NEXT;
+#else
     while(s.itr != s.end)
     {
       switch(*s.itr)
       {
-      case PUSHV:
-        assert((s.itr + 1) < s.end);
-        assert(s.itr[1] < s.f->dataSize());
-        ASM_LOG("\t"  << (s.itr - s.f->cbegin()) <<
-                " PUSHV @" << s.itr[1] << "=<" <<
-                s.f->data.atCell(s.itr[1]) << ">" <<
+#endif
+      OP_CASE(PUSHV)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.itr <= s.end);
+        assert(operand < s.f->dataSize());
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) <<
+                " PUSHV @" << operand << "=<" <<
+                s.f->data.atCell(operand) << ">" <<
                 " --> #" << stack.size());
-        stack.push_back(s.f->getValue(s.itr[1]));
-        s.itr += 2;
-        break;
-
-      case PUSHL:
-        assert((s.itr + 1) < s.end);
-        assert(s.itr[1] < s.f->dataSize());
-        assert(s.f->data.atCell(s.itr[1]).isA<Symbol>());
-        ASM_LOG("\t"  << (s.itr - s.f->cbegin()) << " RETURNL @" << s.itr[1] <<
-                "=<" << s.f->data.atCell(s.itr[1]) << ">" <<
+        stack.pushUnchecked(s.f->getValue(operand));
+        OP_NEXT;
+
+      OP_CASE(PUSHL)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.itr <= s.end);
+        assert(operand < s.f->dataSize());
+        assert(s.f->data.atCell(operand).isA<Symbol>());
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) << " RETURNL @" << operand <<
+                "=<" << s.f->data.atCell(operand) << ">" <<
                 " --> #" << stack.size() <<
                 " stackSize: " << stack.size());
-        stack.push_back(std::move(env->find(s.f->data.atCell(s.itr[1]))));
-        s.itr += 2;
-        break;
-
-      case RETURNS:
-        assert((s.itr + 1) < s.end);
-        assert(s.itr[1] <= stack.size());
-        ASM_LOG("\t"  << (s.itr - s.f->cbegin()) << " RETURNS " << s.itr[1] << " func: " <<
-                s.f << " #" << ((stack.size() - s.itr[1])) << "=<" <<
-                *(stack.end() - s.itr[1]) << ">" <<
+        stack.pushUnchecked(s.f->lookup(operand, *env));
+        OP_NEXT;
+
+      OP_CASE(RETURNS)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.itr <= s.end);
+        assert(operand <= stack.size());
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) << " RETURNS " << operand << " func: " <<
+                s.f << " #" << ((stack.size() - operand)) << "=<" <<
+                *(stack.end() - operand) << ">" <<
                 " stackFrame: " << sf <<
                 " / " << stack.size());
         assert(sf < stack.size());
-        stack[sf] = *(stack.end() - s.itr[1]);
-        stack.erase(stack.begin() + sf + 1, stack.end());
-        s.itr += 2;
-        break;
+        stack[sf] = *(stack.end() - operand);
+        stack.truncate(sf + 1);
+        OP_NEXT;
 
-      case RETURNL:
+      OP_CASE(RETURNL)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.itr <= s.end);
         // return a value from function data
         // @todo exception if unbound
-        assert((s.itr + 1) < s.end);
-        assert(s.itr[1] < s.f->dataSize());
-        assert(s.f->data.atCell(s.itr[1]).isA<Symbol>());
-        ASM_LOG("\t"  << (s.itr - s.f->cbegin()) << " RETURNL @" << s.itr[1] <<
-                "=<" << s.f->data.atCell(s.itr[1]) << ">" <<
+        assert(operand < s.f->dataSize());
+        assert(s.f->data.atCell(operand).isA<Symbol>());
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) << " RETURNL @" << operand <<
+                "=<" << s.f->data.atCell(operand) << ">" <<
                 " --> #" << stack.size());
-        stack.emplace_back(env->find(s.f->data.atCell(s.itr[1])));
+        stack.pushUnchecked(s.f->lookup(operand, *env));
         //assert(returnPos < stack.size());
-        //stack[returnPos] = env->find(s.f->data.atCell(s.itr[1]));
-        //stack[s.stackPos] = env->find(s.f->data.atCell(s.itr[1]));
-        s.itr += 2;
-        break;
+        //stack[returnPos] = env->find(s.f->data.atCell(operand));
+        //stack[s.stackPos] = env->find(s.f->data.atCell(operand));
+        OP_NEXT;
 
-      case DEFINES:
+      OP_CASE(DEFINES)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.itr <= s.end);
         // define a symbol
-        assert((s.itr + 1) < s.end);
-        assert(s.itr[1] < s.f->dataSize());
-        assert(s.f->data.atCell(s.itr[1]).isA<Symbol>());
+        assert(operand < s.f->dataSize());
+        assert(s.f->data.atCell(operand).isA<Symbol>());
         assert(stack.size() > 0);
-        ASM_LOG("\t"  << (s.itr - s.f->cbegin()) <<
-                " DEFINES @" << s.itr[1] << "=<" <<
-                s.f->data.atCell(s.itr[1]) << "> <-- " <<
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) <<
+                " DEFINES @" << operand << "=<" <<
+                s.f->data.atCell(operand) << "> <-- " <<
                 " #" << (stack.size() - 1) << "=<" <<
                 stack.back() << ">");
-        env->set(s.f->data.atCell(s.itr[1]), Object(stack.back()));
-        s.itr += 2;
-        break;
+        env->set(s.f->data.atCell(operand), Object(stack.back()));
+        OP_NEXT;
+
+      OP_CASE(PUSHV2)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand < s.f->dataSize());
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) <<
+                " PUSHV2 @" << operand << "=<" <<
+                s.f->data.atCell(operand) << ">" <<
+                " --> #" << stack.size());
+        stack.pushUnchecked(s.f->getValue(operand));
+        operand = decodeOperand(s.itr);
+        assert(s.itr <= s.end);
+        assert(operand < s.f->dataSize());
+        ASM_LOG("\t       @" << operand << "=<" <<
+                s.f->data.atCell(operand) << ">" <<
+                " --> #" << stack.size());
+        stack.pushUnchecked(s.f->getValue(operand));
+        OP_NEXT;
 
-      case FUNCALL:
+      OP_CASE(PUSHVFUNCALL)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand < s.f->dataSize());
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) <<
+                " PUSHVFUNCALL @" << operand << "=<" <<
+                s.f->data.atCell(operand) << ">" <<
+                " --> #" << stack.size());
+        stack.pushUnchecked(s.f->getValue(operand));
+        operand = decodeOperand(s.itr);
+        assert(s.itr <= s.end);
+        goto L_CALL;
+
+      OP_CASE(PUSHLFUNCALL)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand < s.f->dataSize());
+        assert(s.f->data.atCell(operand).isA<Symbol>());
+        ASM_LOG("\t"  << (instr - s.f->cbegin()) <<
+                " PUSHLFUNCALL @" << operand << "=<" <<
+                s.f->data.atCell(operand) << ">" <<
+                " --> #" << stack.size());
+        stack.pushUnchecked(s.f->lookup(operand, *env));
+        operand = decodeOperand(s.itr);
+        assert(s.itr <= s.end);
+        goto L_CALL;
+
+      OP_CASE(FUNCALL)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.itr <= s.end);
+      L_CALL:
         LOG_DATA_STACK(stack);
-        assert((s.itr + 1) < s.end);
-        assert(stack.size() >= (s.itr[1] + 1));
-        assert(stack[stack.size() - s.itr[1] - 1].isA<Function>());
-        // @todo check number of arguments
-        ASM_LOG("\t" << (s.itr - s.f->cbegin()) <<
-                " FUNCALL nargs: " << s.itr[1] <<
-                " func: " << stack[stack.size() - s.itr[1] - 1].as<Function>() <<
-                " stackFrame: " << (stack.size() - s.itr[1] - 1) <<
+        assert(stack.size() >= (operand + 1));
+        if(stack[stack.size() - operand - 1].isA<CapturedContinuation>())
+        {
+          // the captured stack replaces the current one
+          ASM_LOG("\t" << (instr - s.f->cbegin()) <<
+                  " CONTINUE nargs: " << operand);
+          if(operand > 1)
+          {
+            throw NonMatchingArguments(operand,
+                                       stack[stack.size() - operand - 1].as<CapturedContinuation>());
+          }
+          {
+            Cell k(stack[stack.size() - operand - 1]);
+            k.grey();
+            resume(k.as<CapturedContinuation>()->getView(),
+                   operand ? stack.back() : Lisp::nil);
+          }
+          underflow();
+          if(!--countdown)
+          {
+            if(checkpoint(issued, slice) && !callStack.empty())
+            {
+              // suspend at the resumed frame
+              ASM_LOG("\tSUSPEND");
+              INSTRUMENT_HOOK(end());
+              return false;
+            }
+            // the calls have been accounted
+            exhausted = false;
+            countdown = issued;
+          }
+          goto L_RESUME;
+        }
+        if(stack[stack.size() - operand - 1].isA<BuiltinFunction>())
+        {
+          if(operand == 1 &&
+             stack[stack.size() - 2].as<BuiltinFunction>()->getOpcode() == CALLCC)
+          {
+            // call/cc called through a variable
+            stack[stack.size() - 2] = stack.back();
+            stack.pop_back();
+            goto L_CALLCC_BODY;
+          }
+          // native call: no call frame, the result replaces
+          // the function and its arguments
+          sf = stack.size() - operand - 1;
+          ASM_LOG("\t" << (instr - s.f->cbegin()) <<
+                  " BUILTIN nargs: " << operand <<
+                  " stackFrame: " << sf);
+          bool suspend = stack[sf].as<BuiltinFunction>()->isSuspending();
+          {
+            Object result(stack[sf].as<BuiltinFunction>()->call(*getAllocator(),
+                                                                stack.data() + sf + 1,
+                                                                operand));
+            stack[sf] = result;
+          }
+          stack[sf].grey();
+          stack.truncate(sf + 1);
+          sf = s.stackFramePos;
+          INSTRUMENT_HOOK(builtinCall());
+          if(suspend)
+          {
+            ASM_LOG("\tSUSPEND");
+            INSTRUMENT_HOOK(end());
+            callStack.back() = s;
+            consume(issued - countdown);
+            return false;
+          }
+          OP_NEXT;
+        }
+        // throws NotAFunction for any other value
+        callee = calleeFunction(stack[stack.size() - operand - 1]);
+        if(operand != callee->numArguments() || !callee->hasFixedArity())
+        {
+          // optional and rest arguments, or a non-matching call
+          operand = bindArguments(*callee, operand);
+        }
+        ASM_LOG("\t" << (instr - s.f->cbegin()) <<
+                " FUNCALL nargs: " << operand <<
+                " func: " << stack[stack.size() - operand - 1] <<
+                " stackFrame: " << (stack.size() - operand - 1) <<
                 " nextitr: " << s.f << ":" <<
-                ((s.itr + 2) - s.f->cbegin()) << "/" <<
+                (s.itr - s.f->cbegin()) << "/" <<
                 (s.end - s.f->cbegin()));
-        if(s.itr + 2 == s.end)
+        if(s.itr == s.end)
         {
-          // tail recursion
-          // @todo check num args
+          // tail call: the callee and its arguments replace the
+          // current frame
           sf = s.stackFramePos;
-          ASM_LOG("\tTAIL RECURSION stackFrame:" << sf);
-          s.f = stack[stack.size() - s.itr[1] - 1].as<Function>();
+          ASM_LOG("\tTAIL CALL stackFrame:" << sf);
+          stack.shift(sf, operand + 1);
+          s.f = callee;
           s.itr = s.f->cbegin();
           s.end = s.f->cend();
-          s.f->makeReference(stack.end());
+          INSTRUMENT_HOOK(tailCall(stack.size()));
         }
         else
         {
-          sf = stack.size() - s.itr[1] - 1;
-          s.itr++;
-          s.itr++;
+          sf = stack.size() - operand - 1;
           callStack.back() = s;
-          callStack.emplace_back(stack[sf].as<Function>(), sf);
+          callStack.emplace_back(callee, sf);
           s = callStack.back();
+          INSTRUMENT_HOOK(call(stack.size(), callStack.size()));
           ASM_LOG("\t" << (s.itr - s.f->cbegin()) <<
                   " BEGINFUNC nargs: " << s.f->numArguments() <<
                   " func: " << s.f <<
                   " stackFrame: " << sf);
-          //assert(s.itr[1] + 2 <= stack.size());
-          s.f->makeReference(stack.end());
         }
-        break;
+        ENTER_FRAME;
+        if(!--countdown)
+        {
+          if(checkpoint(issued, slice))
+          {
+            // time slice or budget used up: suspend at the entry of
+            // the callee
+            ASM_LOG("\tSUSPEND");
+            INSTRUMENT_HOOK(end());
+            callStack.back() = s;
+            return false;
+          }
+          countdown = issued;
+        }
+        PROFILER_SAFE_POINT;
+        OP_NEXT;
+
+      OP_CASE(PUSHA)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand < s.f->numArguments());
+        assert(sf + 1 + operand < stack.size());
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " PUSHA " << operand <<
+                " --> #" << stack.size());
+        stack.pushUnchecked(stack[sf + 1 + operand]);
+        OP_NEXT;
 
-      default:
-        // @todo proper exception
+      OP_CASE(PUSHC)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(stack[sf].isA<Closure>());
+        assert(operand < stack[sf].as<Closure>()->numCaptured());
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " PUSHC " << operand <<
+                " --> #" << stack.size());
+        stack.pushUnchecked(stack[sf].as<Closure>()->getCaptured(operand));
+        OP_NEXT;
+
+      OP_CASE(PUSHR)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.f->hasRestArgument() && operand + 1 == s.f->numArguments());
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " PUSHR " << operand <<
+                " --> #" << stack.size());
+        {
+          // the list is only built when the rest parameter is used
+          // as a value, the arguments remain on the stack. The first
+          // use stores the list in the slot of the rest parameter and
+          // moves the number of rest arguments to the slot of the first
+          // rest argument (see frameSize), later uses push the same list.
+          std::size_t pos = sf + 1 + operand;
+          if(stack[pos].isA<UIntegerType>())
+          {
+            std::size_t n = stack[pos].as<UIntegerType>();
+            stack.pushUnchecked(Lisp::nil);
+            for(std::size_t i = n; i > 0; i--)
+            {
+              Cons * cons = getAllocator()->make<Cons>(stack[pos + i], stack.back());
+              stack.back() = Cell(cons, TypeTraits<Cons>::getTypeId());
+              stack.back().grey();
+            }
+            if(n)
+            {
+              stack[pos + 1] = Cell(UIntegerType(n));
+              stack[pos] = stack.back();
+            }
+          }
+          else
+          {
+            stack.pushUnchecked(stack[pos]);
+          }
+        }
+        OP_NEXT;
+
+      OP_CASE(CLOSURE)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(s.f->atCell(operand).isA<Function>());
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " CLOSURE @" << operand);
+        {
+          std::size_t n = s.f->atCell(operand).as<Function>()->numCaptured();
+          assert(stack.size() >= n);
+          Closure * closure = getAllocator()->make<Closure>(s.f->atCell(operand),
+                                                            stack.data() + stack.size() - n,
+                                                            n);
+          stack.truncate(stack.size() - n);
+          stack.pushUnchecked(Cell(closure, TypeTraits<Closure>::getTypeId()));
+          stack.back().grey();
+        }
+        OP_NEXT;
+
+      OP_CASE(CALLCC)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand == 1 && stack.size() >= 1);
+      L_CALLCC_BODY:
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " CALLCC");
+        // the result of call/cc replaces its argument: capture all
+        // frames and the cells below the argument
+        callStack.back() = s;
+        {
+          CapturedContinuation * k =
+            getAllocator()->make<CapturedContinuation>(capture(stack.size() - 1));
+          stack.push_back(Cell(k, TypeTraits<CapturedContinuation>::getTypeId()));
+          stack.back().grey();
+        }
+        // f is tail-called from a frame that has already returned:
+        // when f returns, the innermost captured frame is copied back
+        // to the live stack (see underflow)
+        s.itr = s.end;
+        s.stackFramePos = 0;
+        sf = 0;
+        callStack.push_back(s);
+        operand = 1;
+        goto L_CALL;
+
+      OP_CASE(CAR)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand == 1 && stack.size() >= 1);
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " CAR");
+        stack.back() = Builtin::car(stack.back());
+        stack.back().grey();
+        OP_NEXT;
+
+      OP_CASE(CDR)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand == 1 && stack.size() >= 1);
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " CDR");
+        stack.back() = Builtin::cdr(stack.back());
+        stack.back().grey();
+        OP_NEXT;
+
+      OP_CASE(CONS)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand == 2 && stack.size() >= 2);
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " CONS");
+        {
+          Cons * cons = getAllocator()->make<Cons>(stack[stack.size() - 2],
+                                                   stack.back());
+          stack.pop_back();
+          stack.back() = Cell(cons, TypeTraits<Cons>::getTypeId());
+          stack.back().grey();
+        }
+        OP_NEXT;
+
+      OP_CASE(EQ)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand == 2 && stack.size() >= 2);
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " EQ");
+        {
+          BooleanType value = Builtin::eq(stack[stack.size() - 2], stack.back());
+          stack.pop_back();
+          stack.back() = Object::boolean(value);
+        }
+        OP_NEXT;
+
+      OP_CASE(ADD)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(stack.size() >= operand);
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " ADD " << operand);
+        {
+          UIntegerType value = Builtin::add(stack.data() + stack.size() - operand,
+                                            operand);
+          stack.truncate(stack.size() - operand);
+          stack.pushUnchecked(Cell(value));
+        }
+        OP_NEXT;
+
+      OP_CASE(SUB)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand > 0 && stack.size() >= operand);
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " SUB " << operand);
+        {
+          UIntegerType value = Builtin::sub(stack.data() + stack.size() - operand,
+                                            operand);
+          stack.truncate(stack.size() - operand + 1);
+          stack.back() = Cell(value);
+        }
+        OP_NEXT;
+
+      OP_CASE(LT)
+        instr = s.itr;
+        operand = fetchOperand(s.itr);
+        assert(operand > 0 && stack.size() >= operand);
+        ASM_LOG("\t" << (instr - s.f->cbegin()) << " LT " << operand);
+        {
+          BooleanType value = Builtin::lessThan(stack.data() + stack.size() - operand,
+                                                operand);
+          stack.truncate(stack.size() - operand + 1);
+          stack.back() = Object::boolean(value);
+        }
+        OP_NEXT;
+
+      OP_DEFAULT
+        // unreachable for verified code
         ASM_LOG("unkown instruction " << *s.itr);
-        throw 1;
+        throw InvalidBytecode(s.f, s.itr - s.f->cbegin(), "unknown opcode");
+#ifdef DO_THREADED_DISPATCH
+  L_END:
+#else
       }
     } // while s.itr != s.end
+#endif
+    INSTRUMENT_HOOK(end());
     ASM_LOG("----------------------------------");
     ASM_LOG("return from " << s.f <<
             " pos:" << (s.itr - s.f->cbegin()) << "/"  << (s.end - s.f->cbegin()) <<
@@ -246,8 +963,7 @@ Cell & Continuation::eval()
     {
       LOG_DATA_STACK(stack);
       ASM_LOG("reduce    " << stack.size() << " -> " << (sf + 1));
-      stack[sf] = std::move(stack.back());
-      stack.erase(stack.begin() + sf + 1, stack.end());
+      stack.collapse(sf);
     }
     else
     {
@@ -256,6 +972,12 @@ Cell & Continuation::eval()
       assert((sf + 1) == stack.size());
     }
     callStack.pop_back();
+  L_RESUME:
+    if(callStack.empty())
+    {
+      underflow();
+    }
   }
-  return stack.back();
+  consume(issued - countdown);
+  return true;
 }
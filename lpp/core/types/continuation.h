@@ -1,15 +1,27 @@
+#pragma once
+#include <chrono>
+#include <exception>
+#include <memory>
 #include <lpp/core/cell.h>
 #include <lpp/core/types/container.h>
 #include <lpp/core/opcode.h>
+#include <lpp/core/value_stack.h>
 
 namespace Lisp
 {
   class Env;
+  class Profiler;
+  class Instrumentation;
 
   class ContinuationState
   {
   public:
     inline Function * getFunction() const { return f; }
+
+    /**
+     * Byte position of the next instruction.
+     */
+    std::size_t getOffset() const;
     ContinuationState(Function * _f, std::size_t _stackFramePos);
   private:
     friend class Continuation;
@@ -21,15 +33,179 @@ namespace Lisp
     std::size_t stackFramePos;
   };
 
+  class StackSegment;
+
+  /**
+   * Bottom part of a stack that has been captured by call/cc:
+   * the frames [0, numFrames) and the cells [0, numCells) of segment,
+   * followed by the view of the segment below it.
+   */
+  class StackView
+  {
+  public:
+    std::shared_ptr<const StackSegment> segment;
+    std::size_t numFrames = 0;
+    std::size_t numCells = 0;
+
+    void forEachCell(std::function<void(const Cell&)> func) const;
+  };
+
+  /**
+   * Frames and cells of a continuation that were moved off the live
+   * stack by call/cc. Segments are immutable and shared by all
+   * continuations and captured continuations that refer to them.
+   * Each capture only moves the part of the stack that has been pushed
+   * since the previous capture; frames are copied back one at a time
+   * when the live stack returns into them.
+   */
+  class StackSegment
+  {
+  public:
+    std::vector<Cell> cells;
+    std::vector<ContinuationState> frames;
+    StackView below;
+  };
+
   class Continuation : public Container
   {
   public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Budget without limit.
+     */
+    static const std::size_t unlimited;
+
+    /**
+     * Number of function calls between two reads of the clock
+     * when a deadline is set.
+     */
+    static const std::size_t deadlineInterval;
+
     Continuation(const Cell & func, const std::shared_ptr<Env> & _env);
     Continuation(std::vector<Lisp::Cell> && _stack, const std::shared_ptr<Env> & _env);
+
+    /**
+     * Finished continuation without a function, see call().
+     */
+    Continuation(const std::shared_ptr<Env> & _env);
     inline std::size_t stackSize() const;
     inline void push(const Cell & rhs);
+
+    /**
+     * Maximum number of cells on the value stack.
+     * Exceeding it raises StackOverflow.
+     */
+    inline std::size_t getMaxStackSize() const;
+    inline void setMaxStackSize(std::size_t n);
+
+    /**
+     * Run to completion and return the result.
+     * Suspensions (yield) are resumed immediately.
+     * @throw Timeout if the budget or the deadline is exhausted, the
+     *        continuation can be resumed after a new budget (or
+     *        deadline) has been set.
+     */
     Cell & eval();
 
+    /**
+     * Run until the function returns, a suspending builtin (yield)
+     * has been called, the time slice is used up or the budget or the
+     * deadline is exhausted (see isExhausted()).
+     * Call run() again to resume.
+     * @param slice number of function calls after which the
+     *        continuation is suspended, 0: no limit.
+     * @return true if the function returned (see isFinished())
+     */
+    bool run(std::size_t slice = 0);
+
+    inline bool isFinished() const;
+
+    /**
+     * Remaining number of function calls (including tail calls and
+     * invocations of captured continuations) of all following runs,
+     * unlimited by default. Code has no backward jumps: the number of
+     * instructions between two calls is bounded, a budget of calls
+     * bounds the number of instructions.
+     */
+    inline std::size_t getBudget() const;
+    inline void setBudget(std::size_t calls);
+
+    /**
+     * Point in time after which run() suspends, the clock is read
+     * every deadlineInterval function calls.
+     */
+    inline void setDeadline(Clock::time_point _deadline);
+    inline void clearDeadline();
+
+    /**
+     * True if the last run() has been suspended because the budget
+     * or the deadline has been exhausted.
+     */
+    inline bool isExhausted() const;
+
+    /**
+     * Discard the stack and all frames, the continuation is finished.
+     * The capacity of the stack is kept for the next call().
+     */
+    void reset();
+
+    /**
+     * Start a call of the function on an empty continuation: the
+     * function and its nargs arguments have been pushed (see reset()).
+     * Builtin functions are called immediately, the continuation holds
+     * their result. A captured continuation is resumed with the argument.
+     * @throw NonMatchingArguments
+     * @throw NotAFunction
+     * @throw MissingClosure
+     */
+    void call(std::size_t nargs);
+
+    /**
+     * Replace the result of the suspending builtin that has suspended
+     * the continuation, e.g. by the result of an I/O operation that
+     * completes later (see Scheduler::park).
+     */
+    inline void setResult(const Cell & value);
+
+    /**
+     * Raise error in place of the result of the suspending builtin,
+     * the next run() rethrows it (e.g. an I/O operation that fails
+     * after the green thread has been parked).
+     */
+    inline void setError(std::exception_ptr _error);
+
+    /**
+     * Iterate over all frames (captured and live), from the outermost
+     * to the innermost frame.
+     */
+    void forEachFrame(std::function<void(const ContinuationState&)> func) const;
+
+    /**
+     * Profiler polled at function entry and return, nullptr: no
+     * profiling.
+     */
+    inline void setProfiler(Profiler * _profiler);
+
+    /**
+     * Counters of an instrumented build (see instrumentation.h),
+     * nullptr: no counting.
+     */
+    inline void setInstrumentation(Instrumentation * _instrumentation);
+
+    /**
+     * Move the cells [0, pos) and all frames into a new stack segment.
+     * The cells above pos remain on the live stack, at position 0.
+     * @return the view of the captured part of the stack
+     */
+    const StackView & capture(std::size_t pos);
+
+    /**
+     * Discard the current stack and return value to the
+     * continuation captured in view.
+     */
+    void resume(const StackView & view, const Cell & value);
+
     /* implementation of Container */
     virtual void forEachChild(std::function<void(const Cell&)> func) const override;
     virtual TypeId getTypeId() const override;
@@ -38,10 +214,47 @@ namespace Lisp
     virtual bool recycleNextChild() override;
 
   private:
+    /**
+     * Bind the nargs arguments on top of the stack to the parameters
+     * of f: missing optional arguments are nil, the rest arguments
+     * remain on the stack above their number.
+     * @return number of cells of the frame above the function
+     * @throw NonMatchingArguments
+     */
+    std::size_t bindArguments(Function & f, std::size_t nargs);
+
+    /**
+     * Copy the innermost frame of the captured stack back to the live
+     * stack after the last live frame has returned.
+     */
+    void underflow();
+
+    /**
+     * Number of calls until the next check of the time slice, the
+     * budget and the deadline, 0: budget exhausted.
+     */
+    std::size_t nextCheck(std::size_t slice) const;
+
+    /**
+     * Account the issued calls of run() to the time slice and the
+     * budget, and compute the next interval.
+     * @return true if run() has to suspend
+     */
+    bool checkpoint(std::size_t & issued, std::size_t & slice);
+    inline void consume(std::size_t calls);
+
     std::size_t dsPosition;
-    std::vector<Lisp::Cell> stack;
+    ValueStack stack;
     std::vector<Lisp::ContinuationState> callStack;
+    StackView below;
     std::shared_ptr<Env> env;
+    Profiler * profiler = nullptr;
+    Instrumentation * instrumentation = nullptr;
+    std::size_t budget = unlimited;
+    Clock::time_point deadline;
+    bool hasDeadline = false;
+    bool exhausted = false;
+    std::exception_ptr error;
   };
 }
 
@@ -55,3 +268,78 @@ inline std::size_t Lisp::Continuation::stackSize() const
 {
   return stack.size();
 }
+
+inline std::size_t Lisp::Continuation::getMaxStackSize() const
+{
+  return stack.getMaxSize();
+}
+
+inline void Lisp::Continuation::setMaxStackSize(std::size_t n)
+{
+  stack.setMaxSize(n);
+}
+
+inline void Lisp::Continuation::setProfiler(Profiler * _profiler)
+{
+  profiler = _profiler;
+}
+
+inline void Lisp::Continuation::setInstrumentation(Instrumentation * _instrumentation)
+{
+  instrumentation = _instrumentation;
+}
+
+inline bool Lisp::Continuation::isFinished() const
+{
+  return callStack.empty() && !below.segment;
+}
+
+inline std::size_t Lisp::Continuation::getBudget() const
+{
+  return budget;
+}
+
+inline void Lisp::Continuation::setBudget(std::size_t calls)
+{
+  budget = calls;
+  exhausted = false;
+}
+
+inline void Lisp::Continuation::setDeadline(Clock::time_point _deadline)
+{
+  deadline = _deadline;
+  hasDeadline = true;
+  exhausted = false;
+}
+
+inline void Lisp::Continuation::clearDeadline()
+{
+  hasDeadline = false;
+  exhausted = false;
+}
+
+inline void Lisp::Continuation::consume(std::size_t calls)
+{
+  if(budget != unlimited)
+  {
+    budget -= calls;
+  }
+}
+
+inline bool Lisp::Continuation::isExhausted() const
+{
+  return exhausted;
+}
+
+inline void Lisp::Continuation::setResult(const Cell & value)
+{
+  assert(!isFinished() && !stack.empty());
+  value.grey();
+  stack.back() = value;
+}
+
+inline void Lisp::Continuation::setError(std::exception_ptr _error)
+{
+  assert(!isFinished());
+  error = std::move(_error);
+}
@@ -2,53 +2,113 @@
 #include <lpp/core/types/function.h>
 #include <lpp/core/opcode.h>
 using Function = Lisp::Function;
+using InstructionType = Lisp::InstructionType;
 
 const std::size_t Function::notFound = std::numeric_limits<std::size_t>::max();
+const std::size_t Function::variadic = std::numeric_limits<std::size_t>::max();
 
 void Function::disassemble(std::ostream & ost) const
 {
   //@todo human readable
-  std::size_t i = 0;
   ost << "[Function " << this << "]" << std::endl;
-  for(auto instr = cbegin(); instr != cend(); ++instr)
+  auto instr = cbegin();
+  while(instr != cend())
   {
     ost << (instr - cbegin()) << ":\t";
-    switch(*instr)
+    InstructionType opcode = *instr;
+    std::size_t operand = fetchOperand(instr);
+    switch(opcode)
     {
     case PUSHV:
-      ost << "PUSHV " << data.atCell(instr[1]);
-      instr++;
+      ost << "PUSHV " << data.atCell(operand);
       break;
 
     case RETURNS:
-      ost << "RETURNS " << *instr;
-      instr++;
+      ost << "RETURNS " << operand;
       break;
 
     case RETURNL:
-      ost << "RETURNL " << data.atCell(instr[1]);
-      instr++;
+      ost << "RETURNL " << data.atCell(operand);
       break;
 
     case PUSHL:
-      ost << "PUSHL " << data.atCell(instr[1]);
-      instr++;
+      ost << "PUSHL " << data.atCell(operand);
       break;
 
     case FUNCALL:
-      ost << "FUNCALL " << instr[1];
-      instr++;
+      ost << "FUNCALL " << operand;
       break;
 
     case DEFINES:
-      ost << "DEFINES " << data.atCell(instr[1]);
-      instr++;
+      ost << "DEFINES " << data.atCell(operand);
+      break;
+
+    case PUSHV2:
+      ost << "PUSHV2 " << data.atCell(operand);
+      ost << " " << data.atCell(decodeOperand(instr));
+      break;
+
+    case PUSHVFUNCALL:
+      ost << "PUSHVFUNCALL " << data.atCell(operand);
+      ost << " " << decodeOperand(instr);
+      break;
+
+    case PUSHLFUNCALL:
+      ost << "PUSHLFUNCALL " << data.atCell(operand);
+      ost << " " << decodeOperand(instr);
+      break;
+
+    case CAR:
+      ost << "CAR " << operand;
+      break;
+
+    case CDR:
+      ost << "CDR " << operand;
+      break;
+
+    case CONS:
+      ost << "CONS " << operand;
+      break;
+
+    case EQ:
+      ost << "EQ " << operand;
+      break;
+
+    case ADD:
+      ost << "ADD " << operand;
+      break;
+
+    case SUB:
+      ost << "SUB " << operand;
+      break;
+
+    case LT:
+      ost << "LT " << operand;
+      break;
+
+    case PUSHA:
+      ost << "PUSHA " << operand;
+      break;
+
+    case PUSHC:
+      ost << "PUSHC " << operand;
+      break;
+
+    case PUSHR:
+      ost << "PUSHR " << operand;
+      break;
+
+    case CLOSURE:
+      ost << "CLOSURE " << data.atCell(operand);
+      break;
+
+    case CALLCC:
+      ost << "CALLCC " << operand;
       break;
 
     default:
-      ost << "instr " << *instr;
+      ost << "instr " << std::size_t(opcode) << " " << operand;
     }
-    i++;
     ost << std::endl;
   }
   ost << "[End " << this << "]" << std::endl;
@@ -32,8 +32,10 @@ either expressed or implied, of the FreeBSD Project.
 #include <cstdint>
 #include <vector>
 #include <limits>
+#include <string>
 #include <lpp/core/opcode.h>
 #include <lpp/core/object.h>
+#include <lpp/core/env.h>
 #include <lpp/core/memory/allocator.h>
 #include <lpp/core/types/type_id.h>
 #include <lpp/core/types/container.h>
@@ -46,72 +48,141 @@ namespace Lisp
   class Object;
   class Vm;
   class Allocator;
+  class Function;
 
-  class ArgumentTraits
-  {
-  public:
-    ArgumentTraits();
-    inline bool isReference() const;
-    inline void setReference(std::size_t index);
-    inline std::size_t getReferenceIndex() const;
-  private:
-    bool ref;
-    std::size_t refIndex;
-  };
+  std::size_t verify(Function & f);
 
   class Function : public Container
   {
   public:
     friend class Vm; //@todo remove this friendship
     friend class Continuation;
+    friend std::size_t verify(Function & f);
     using Code = std::vector<InstructionType>;
     using const_iterator = Code::const_iterator;
     static const std::size_t notFound;
+    static const std::size_t variadic;
 
     Function();
     Function(const Code & instr, const Array & data);
     Function(Code && instr, Array && data);
 
     /**
-     * Add instructions 
+     * Add instructions (see opcode.h for the encoding)
+     *
+     * The builder methods and setters throw FrozenObject if the
+     * function is frozen.
      */
     inline void addPUSHV(const Cell & rhs);
-    inline void addRETURNS(InstructionType offset);
+    inline void addRETURNS(std::size_t offset);
     inline void addRETURNL(const Cell & rhs);
     inline void addPUSHL(const Cell & rhs);
-    inline void addFUNCALL(const InstructionType & n);
+    inline void addFUNCALL(std::size_t n);
     inline void addDEFINES(const Cell & symbol);
+    inline void addPUSHA(std::size_t i);
+    inline void addPUSHC(std::size_t i);
+    inline void addPUSHR(std::size_t i);
+    inline void addCLOSURE(const Cell & function);
+
+    /**
+     * Add a primitive operation (see builtins.h) on nargs arguments.
+     */
+    inline void addPrimitive(InstructionType opcode, std::size_t nargs);
+
+    /**
+     * Remove the instruction at byte position pos.
+     * The data elements are not modified.
+     */
+    inline void removeInstruction(std::size_t pos);
 
     inline void appendData(const Cell & rhs);
+
+    /**
+     * Add a parameter. Required parameters come first, followed by the
+     * optional parameters and at most one rest parameter.
+     * Missing optional arguments are nil. The rest parameter is bound to
+     * the list of the remaining arguments (see PUSHR in opcode.h).
+     */
     inline void addArgument(const Cell & cell);
+    inline void addOptionalArgument(const Cell & cell);
+    inline void addRestArgument(const Cell & cell);
+
+    /**
+     * Declare the first n data elements as parameters, of which
+     * nOptional are optional, followed by a rest parameter if
+     * hasRest (used to restore a function from an image).
+     */
+    inline void setArguments(std::size_t n, std::size_t _nOptional, bool hasRest);
+
+    /**
+     * Replace the code (e.g. by an optimized version).
+     * The data elements are not modified.
+     */
+    inline void setCode(Code && code);
     
     /**
-     * Modify the ith argument: make it shareable
+     * Number of free variables of the function.
+     * If it is non-zero, the function is called through a Closure
+     * that holds the captured values (see CLOSURE in opcode.h).
+     */
+    inline void setNumCaptured(std::size_t n);
+    inline std::size_t numCaptured() const;
+
+    /**
+     * Name for diagnostics (see Profiler). The compiler names the
+     * functions of (define name (lambda ...)), other functions are
+     * anonymous (empty name).
+     */
+    inline const std::string & getName() const;
+    inline void setName(const std::string & _name);
+
+    /**
+     * True if the code has been accepted by the verifier (see
+     * verifier.h). Modifying the code resets the flag.
+     */
+    inline bool isVerified() const;
+
+    /**
+     * Maximum number of cells of a frame of the function, including
+     * the function and its arguments (valid if isVerified()).
      */
-    inline Object shareArgument(std::size_t i);
+    inline std::size_t getMaxStackDepth() const;
 
     /**
      * Number of static data elements.
      */
     inline std::size_t dataSize() const;
+
+    /**
+     * Number of parameters, including the optional and rest parameters.
+     */
     inline std::size_t numArguments() const;
+    inline std::size_t numOptionalArguments() const;
+    inline bool hasRestArgument() const;
 
     /**
-     * Number of instructions
+     * True if the function has neither optional nor rest parameters.
      */
-    inline std::size_t numInstructions() const;
+    inline bool hasFixedArity() const;
 
     /**
-     * Shrink all internal vectors to fit size.
+     * Range of the number of arguments of a call,
+     * getMaxArguments() is Function::variadic if there is a rest
+     * parameter.
      */
-    inline void shrink();
+    inline std::size_t getMinArguments() const;
+    inline std::size_t getMaxArguments() const;
+    inline bool acceptsArguments(std::size_t n) const;
 
     /**
-     * Get properties of ith function argument.
-     * @param index of argument i in [0 ... numArguments() )
+     * Size of the encoded code in bytes
      */
-    inline const ArgumentTraits & getArgumentTraits(const std::size_t i) const;
-    inline ArgumentTraits & getArgumentTraits(const std::size_t i);
+    inline std::size_t numInstructions() const;
+
+    /**
+     * Shrink all internal vectors to fit size.
+     */
+    inline void shrink();
 
     /**
      * Return the position of the argument.
@@ -138,10 +209,12 @@ namespace Lisp
     inline const Cell & getValue(std::size_t i) const;
 
     /**
-     * Modifies stack values to references for each argument
-     * that has reference trait
+     * Look up the global binding of the symbol at data position i.
+     * Each position has its own inline cache, the hash lookup in env
+     * is only performed on a cache miss.
+     * Frozen functions may be shared between threads and bypass the cache.
      */
-    inline void makeReference(std::vector<Cell>::iterator stack_itr);
+    inline const Object & lookup(std::size_t i, const Env & env);
 
     void disassemble(std::ostream & ost) const;
     //////////////////////////////////////////////////
@@ -173,9 +246,24 @@ namespace Lisp
     }
 
   private:
-    std::vector<ArgumentTraits> argumentTraits;
+    /**
+     * Throw FrozenObject if the function is frozen. Called before
+     * any field is modified.
+     */
+    inline void checkMutable();
+    inline void addInstruction(InstructionType opcode, std::size_t operand);
+    std::size_t nArguments = 0;
+    std::size_t nOptional = 0;
+    bool rest = false;
+    std::size_t nCaptured = 0;
+    std::string name;
     Code instructions;
     Array data;
+    std::vector<InlineCache> inlineCache;
+
+    // verifier (see verifier.h)
+    bool verified = false;
+    std::size_t maxStackDepth = 0;
   };
 }
 
@@ -184,120 +272,171 @@ namespace Lisp
 // Implementation
 //
 ///////////////////////////////////////////////////////////////////////////////
-inline Lisp::ArgumentTraits::ArgumentTraits() : ref(false), refIndex(0)
+inline Lisp::Function::Function()
 {
 }
 
-inline bool Lisp::ArgumentTraits::isReference() const
+inline Lisp::Function::Function(const std::vector<InstructionType> & instr,
+                                const Array & _data)
+  : instructions(instr), data(_data)
 {
-  return ref;
 }
 
-inline void Lisp::ArgumentTraits::setReference(std::size_t index)
+inline Lisp::Function::Function(Code && instr, Array && _data)
+  : instructions(std::move(instr)), data(std::move(_data))
 {
-  refIndex = index;
-  ref = true;
 }
 
-inline std::size_t Lisp::ArgumentTraits::getReferenceIndex() const
+inline void Lisp::Function::checkMutable()
 {
-  return refIndex;
+  if(isFrozen())
+  {
+    throw FrozenObject(Cell(this));
+  }
 }
 
-
-///////////////////////////////////////////////////////////////////////////////
-inline Lisp::Function::Function()
+inline void Lisp::Function::appendData(const Cell & rhs)
 {
+  checkMutable();
+  data.append(rhs);
 }
 
-inline Lisp::Function::Function(const std::vector<InstructionType> & instr,
-                                const Array & _data)
-  : instructions(instr), data(_data)
+inline void Lisp::Function::setCode(Code && code)
 {
+  checkMutable();
+  instructions = std::move(code);
+  verified = false;
 }
 
-inline Lisp::Function::Function(Code && instr, Array && _data)
-  : instructions(std::move(instr)), data(std::move(_data))
+inline void Lisp::Function::addArgument(const Cell & cell)
 {
+  assert(!nOptional && !rest);
+  appendData(cell);
+  nArguments++;
+  verified = false;
 }
 
-inline void Lisp::Function::appendData(const Cell & rhs)
+inline void Lisp::Function::addOptionalArgument(const Cell & cell)
 {
-  data.append(rhs);
+  assert(!rest);
+  appendData(cell);
+  nArguments++;
+  nOptional++;
+  verified = false;
 }
 
-inline void Lisp::Function::addArgument(const Cell & cell)
+inline void Lisp::Function::addRestArgument(const Cell & cell)
 {
-  argumentTraits.push_back(ArgumentTraits());
+  assert(!rest);
   appendData(cell);
+  nArguments++;
+  rest = true;
+  verified = false;
 }
 
-inline Lisp::Object Lisp::Function::shareArgument(std::size_t i)
+inline void Lisp::Function::setArguments(std::size_t n,
+                                         std::size_t _nOptional,
+                                         bool hasRest)
 {
-  assert(i < argumentTraits.size());
-  if(argumentTraits[i].isReference())
-  {
-    return data[argumentTraits[i].getReferenceIndex()];
-  }
-  else
-  {
-    auto allocator = getAllocator();
-    //@todo using guard
-    //Guard _lock(allocator);
-    //argumentTraits[i].setReference(data.size());
-    //Cell obj(gc->make<Reference>(data.atCell(i), Lisp::nil))
-    //appendData(obj);
-    //return Object(obj);
-    Object obj(allocator->makeRoot<Reference>(data.atCell(i), Lisp::nil));
-    argumentTraits[i].setReference(data.size());
-    appendData(obj);
-    return obj;
-  }
+  checkMutable();
+  assert(n <= data.size() && _nOptional + (hasRest ? 1 : 0) <= n);
+  nArguments = n;
+  nOptional = _nOptional;
+  rest = hasRest;
+  verified = false;
+}
+
+inline void Lisp::Function::addInstruction(InstructionType opcode,
+                                           std::size_t operand)
+{
+  checkMutable();
+  instructions.push_back(opcode);
+  appendOperand(instructions, operand);
+  verified = false;
 }
 
 inline void Lisp::Function::addPUSHV(const Cell & rhs)
 {
-  instructions.push_back(PUSHV);
-  instructions.push_back(data.size());
+  addInstruction(PUSHV, data.size());
   data.append(rhs);
 }
 
-inline void Lisp::Function::addRETURNS(InstructionType offset)
+inline void Lisp::Function::addRETURNS(std::size_t offset)
 {
-  instructions.push_back(RETURNS);
-  instructions.push_back(offset);
+  addInstruction(RETURNS, offset);
 }
 
 inline void Lisp::Function::addRETURNL(const Cell & rhs)
 {
   assert(rhs.isA<Symbol>());
-  instructions.push_back(RETURNL);
-  instructions.push_back(data.size());
+  addInstruction(RETURNL, data.size());
   data.append(rhs);
 }
 
 inline void Lisp::Function::addPUSHL(const Cell & rhs)
 {
   assert(rhs.isA<Symbol>());
-  instructions.push_back(PUSHL);
-  instructions.push_back(data.size());
+  addInstruction(PUSHL, data.size());
   data.append(rhs);
 }
 
-inline void Lisp::Function::addFUNCALL(const InstructionType & n)
+inline void Lisp::Function::addFUNCALL(std::size_t n)
 {
-  instructions.push_back(FUNCALL);
-  instructions.push_back(n);
+  addInstruction(FUNCALL, n);
 }
 
 inline void Lisp::Function::addDEFINES(const Cell & symbol)
 {
   assert(symbol.isA<Symbol>());
-  instructions.push_back(DEFINES);
-  instructions.push_back(data.size());
+  addInstruction(DEFINES, data.size());
   data.append(symbol);
 }
 
+inline void Lisp::Function::addPUSHA(std::size_t i)
+{
+  addInstruction(PUSHA, i);
+}
+
+inline void Lisp::Function::addPUSHC(std::size_t i)
+{
+  addInstruction(PUSHC, i);
+}
+
+inline void Lisp::Function::addPUSHR(std::size_t i)
+{
+  assert(rest && i + 1 == nArguments);
+  addInstruction(PUSHR, i);
+}
+
+inline void Lisp::Function::addCLOSURE(const Cell & function)
+{
+  assert(function.isA<Function>());
+  addInstruction(CLOSURE, data.size());
+  data.append(function);
+}
+
+inline void Lisp::Function::addPrimitive(InstructionType opcode,
+                                         std::size_t nargs)
+{
+  assert(opcode >= CAR && opcode < NUM_OPCODES);
+  addInstruction(opcode, nargs);
+}
+
+inline void Lisp::Function::removeInstruction(std::size_t pos)
+{
+  checkMutable();
+  assert(pos < instructions.size());
+  auto itr = instructions.cbegin() + pos;
+  std::size_t n = numOperands(*itr);
+  ++itr;
+  for(std::size_t i = 0; i < n; i++)
+  {
+    decodeOperand(itr);
+  }
+  instructions.erase(instructions.cbegin() + pos, itr);
+  verified = false;
+}
+
 inline std::size_t Lisp::Function::dataSize() const
 {
   return data.size();
@@ -305,34 +444,87 @@ inline std::size_t Lisp::Function::dataSize() const
 
 inline std::size_t Lisp::Function::numArguments() const
 {
-  return argumentTraits.size();
+  return nArguments;
 }
 
-inline std::size_t Lisp::Function::numInstructions() const
+inline std::size_t Lisp::Function::numOptionalArguments() const
 {
-  return instructions.size();
+  return nOptional;
 }
 
-inline void Lisp::Function::shrink()
+inline bool Lisp::Function::hasRestArgument() const
 {
-  data.shrink();
-  instructions.shrink_to_fit();
-  argumentTraits.shrink_to_fit();
+  return rest;
+}
+
+inline bool Lisp::Function::hasFixedArity() const
+{
+  return !nOptional && !rest;
+}
+
+inline std::size_t Lisp::Function::getMinArguments() const
+{
+  return nArguments - nOptional - (rest ? 1 : 0);
+}
+
+inline std::size_t Lisp::Function::getMaxArguments() const
+{
+  return rest ? variadic : nArguments;
+}
+
+inline bool Lisp::Function::acceptsArguments(std::size_t n) const
+{
+  return n >= getMinArguments() && n <= getMaxArguments();
+}
+
+inline void Lisp::Function::setNumCaptured(std::size_t n)
+{
+  checkMutable();
+  nCaptured = n;
+  verified = false;
+}
+
+inline bool Lisp::Function::isVerified() const
+{
+  return verified;
 }
 
-inline const Lisp::ArgumentTraits & Lisp::Function::getArgumentTraits(const std::size_t i) const
+inline std::size_t Lisp::Function::getMaxStackDepth() const
 {
-  return argumentTraits[i];
+  return maxStackDepth;
 }
 
-inline Lisp::ArgumentTraits & Lisp::Function::getArgumentTraits(const std::size_t i)
+inline const std::string & Lisp::Function::getName() const
 {
-  return argumentTraits[i];
+  return name;
+}
+
+inline void Lisp::Function::setName(const std::string & _name)
+{
+  checkMutable();
+  name = _name;
+}
+
+inline std::size_t Lisp::Function::numCaptured() const
+{
+  return nCaptured;
+}
+
+inline std::size_t Lisp::Function::numInstructions() const
+{
+  return instructions.size();
+}
+
+inline void Lisp::Function::shrink()
+{
+  checkMutable();
+  data.shrink();
+  instructions.shrink_to_fit();
 }
 
 inline std::size_t Lisp::Function::getArgumentPos(const Cell & cell) const
 {
-  std::size_t n = argumentTraits.size();
+  std::size_t n = nArguments;
   for(std::size_t i = 0; i < n; i++)
   {
     assert(data[i].as<Symbol>());
@@ -372,22 +564,17 @@ inline const Lisp::Cell & Lisp::Function::getValue(std::size_t i) const
   }
 }
 
-inline void Lisp::Function::makeReference(std::vector<Cell>::iterator stack_itr)
+inline const Lisp::Object & Lisp::Function::lookup(std::size_t i, const Env & env)
 {
-  //@todo only execute, if function has at least one reference
-  std::size_t i = 0;
-  stack_itr-= numArguments();
-  for(const ArgumentTraits & traits : argumentTraits)
+  assert(i < data.size());
+  assert(data.atCell(i).isA<Symbol>());
+  if(isFrozen())
   {
-    if(traits.isReference())
-    {
-      if(!stack_itr->isA<Reference>())
-      {
-        data[traits.getReferenceIndex()].as<Reference>()->setCdr(*stack_itr);
-        *stack_itr = data[traits.getReferenceIndex()];
-      }
-    }
-    ++stack_itr;
-    i++;
+    return env.find(data.atCell(i));
+  }
+  if(i >= inlineCache.size())
+  {
+    inlineCache.resize(data.size());
   }
+  return inlineCache[i].find(env, data.atCell(i));
 }
@@ -1,18 +1,133 @@
 #pragma once
 #include <functional>
-#include <lpp/core/types/lisp_function_interface.h>
+#include <limits>
+#include <string>
+#include <lpp/core/types/type_id.h>
+#include <lpp/core/types/managed_type.h>
+#include <lpp/core/object.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/opcode.h>
 
 namespace Lisp
 {
-  class BuiltinFunction : public FunctionInterface
+  class Allocator;
+
+  /**
+   * Native function.
+   * A builtin operates directly on the window of the continuation stack
+   * that holds its arguments. The result replaces the function and its
+   * arguments on the stack.
+   */
+  class BuiltinFunction : public ManagedType
   {
   public:
-    typedef std::function<void(Vm&)> FunctionType;
-    BuiltinFunction(FunctionType lambda) {
-    }
+    using FunctionType = std::function<Object(Allocator & alloc,
+                                              const Cell * args,
+                                              std::size_t nargs)>;
+    static const std::size_t variadic = std::numeric_limits<std::size_t>::max();
+
+    inline BuiltinFunction(const std::string & _name,
+                           FunctionType _func,
+                           std::size_t _minArgs,
+                           std::size_t _maxArgs);
+    inline BuiltinFunction(const std::string & _name,
+                           FunctionType _func,
+                           std::size_t nargs);
+
+    inline const std::string & getName() const;
+    inline std::size_t getMinArguments() const;
+    inline std::size_t getMaxArguments() const;
+
+    /**
+     * A suspending builtin returns control from Continuation::run
+     * after it has been called (e.g. yield).
+     */
+    inline bool isSuspending() const;
+    inline void setSuspending(bool _suspending);
+
+    /**
+     * Builtins that operate on the continuation (call/cc) are
+     * executed by the instruction opcode instead of the function.
+     * 0: the builtin is an ordinary function.
+     */
+    inline InstructionType getOpcode() const;
+    inline void setOpcode(InstructionType _opcode);
 
-    virtual void eval(Vm& vm) const override {
-      // @todo match lambda list, throw exception if no match
-    }
+    /**
+     * Call the function with nargs arguments starting at args.
+     * @throw NonMatchingArguments
+     */
+    inline Object call(Allocator & alloc,
+                       const Cell * args,
+                       std::size_t nargs) const;
+
+  private:
+    std::string name;
+    FunctionType func;
+    std::size_t minArgs;
+    std::size_t maxArgs;
+    bool suspending = false;
+    InstructionType opcode = 0;
   };
 }
+
+inline Lisp::BuiltinFunction::BuiltinFunction(const std::string & _name,
+                                              FunctionType _func,
+                                              std::size_t _minArgs,
+                                              std::size_t _maxArgs)
+  : name(_name), func(_func), minArgs(_minArgs), maxArgs(_maxArgs)
+{
+}
+
+inline Lisp::BuiltinFunction::BuiltinFunction(const std::string & _name,
+                                              FunctionType _func,
+                                              std::size_t nargs)
+  : BuiltinFunction(_name, _func, nargs, nargs)
+{
+}
+
+inline const std::string & Lisp::BuiltinFunction::getName() const
+{
+  return name;
+}
+
+inline std::size_t Lisp::BuiltinFunction::getMinArguments() const
+{
+  return minArgs;
+}
+
+inline std::size_t Lisp::BuiltinFunction::getMaxArguments() const
+{
+  return maxArgs;
+}
+
+inline bool Lisp::BuiltinFunction::isSuspending() const
+{
+  return suspending;
+}
+
+inline void Lisp::BuiltinFunction::setSuspending(bool _suspending)
+{
+  suspending = _suspending;
+}
+
+inline Lisp::InstructionType Lisp::BuiltinFunction::getOpcode() const
+{
+  return opcode;
+}
+
+inline void Lisp::BuiltinFunction::setOpcode(InstructionType _opcode)
+{
+  opcode = _opcode;
+}
+
+inline Lisp::Object Lisp::BuiltinFunction::call(Allocator & alloc,
+                                                const Cell * args,
+                                                std::size_t nargs) const
+{
+  if(nargs < minArgs || nargs > maxArgs)
+  {
+    throw NonMatchingArguments(nargs, this);
+  }
+  return func(alloc, args, nargs);
+}
@@ -29,6 +29,7 @@ of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #pragma once
+#include <atomic>
 #include <lpp/core/types/type_id.h>
 
 namespace Lisp
@@ -41,6 +42,12 @@ namespace Lisp
    * All references of Cell and Object are counted.
    * A managed object must not have Cell or Object members.
    * In order to define more complex objects, use Container classes.
+   *
+   * Reference counting is biased towards the owning thread:
+   * as long as the object is local, the count is maintained with
+   * plain (relaxed) loads and stores. After share() has been called
+   * all updates are atomic read-modify-write operations and the
+   * object can be referenced from several threads.
    */
   class ManagedType
   {
@@ -48,10 +55,26 @@ namespace Lisp
     ManagedType();
     virtual ~ManagedType() {}
     inline std::size_t getRefCount() const;
+
+    /**
+     * Switch to atomic reference counting.
+     * Must be called by the owning thread before the object
+     * is handed over to another thread. Objects cannot be unshared.
+     */
+    inline void share();
+    inline bool isShared() const;
   private:
     friend class Cell;
     friend class Env;
-    std::size_t refCount;
+    inline void incRefCount();
+
+    /**
+     * Decrement the reference count.
+     * @return true if the last reference has been removed.
+     */
+    inline bool decRefCount();
+    std::atomic<std::size_t> refCount;
+    bool shared;
   };
 }
 
@@ -60,14 +83,48 @@ namespace Lisp
 // implementation
 //
 ///////////////////////////////////////////////////////////////////////
-inline Lisp::ManagedType::ManagedType()
+inline Lisp::ManagedType::ManagedType() : refCount(0), shared(false)
 {
-  refCount = 0;
 }
 
 inline std::size_t Lisp::ManagedType::getRefCount() const
 {
-  return refCount;
+  return refCount.load(std::memory_order_relaxed);
+}
+
+inline void Lisp::ManagedType::share()
+{
+  shared = true;
+}
+
+inline bool Lisp::ManagedType::isShared() const
+{
+  return shared;
 }
 
+inline void Lisp::ManagedType::incRefCount()
+{
+  if(shared)
+  {
+    refCount.fetch_add(1, std::memory_order_relaxed);
+  }
+  else
+  {
+    refCount.store(refCount.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+}
 
+inline bool Lisp::ManagedType::decRefCount()
+{
+  if(shared)
+  {
+    return refCount.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+  else
+  {
+    std::size_t n = refCount.load(std::memory_order_relaxed) - 1;
+    refCount.store(n, std::memory_order_relaxed);
+    return n == 0;
+  }
+}
@@ -29,8 +29,11 @@ of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #pragma once
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <lpp/core/types/type_id.h>
 #include <lpp/core/types/managed_type.h>
 
@@ -41,15 +44,28 @@ namespace Lisp
   public:
     String(const std::string & str);
     inline std::string getCString() const;
+    inline std::size_t size() const;
+
+    /**
+     * Compare the content of two strings.
+     */
+    inline bool equal(const String & rhs) const;
+
+    /**
+     * Hash value of the content.
+     * Strings are immutable, the value is computed once and cached.
+     */
+    inline std::size_t hash() const;
   private:
     std::shared_ptr<std::string> shared_string;
     std::string::iterator begin;
     std::string::iterator end;
+    mutable std::atomic<std::size_t> hashValue;
   };
 }
 
 inline Lisp::String::String(const std::string & str)
-  : shared_string(std::make_shared<std::string>(str))
+  : shared_string(std::make_shared<std::string>(str)), hashValue(0)
 {
   begin = shared_string->begin();
   end = shared_string->end();
@@ -59,3 +75,32 @@ inline std::string Lisp::String::getCString() const
 {
   return std::string(begin, end);
 }
+
+inline std::size_t Lisp::String::size() const
+{
+  return end - begin;
+}
+
+inline bool Lisp::String::equal(const String & rhs) const
+{
+  return size() == rhs.size() && std::equal(begin, end, rhs.begin);
+}
+
+inline std::size_t Lisp::String::hash() const
+{
+  // 0 marks "not computed yet"
+  std::size_t h = hashValue.load(std::memory_order_relaxed);
+  if(!h)
+  {
+    // FNV-1a
+    h = 14695981039346656037u;
+    for(auto itr = begin; itr != end; ++itr)
+    {
+      h ^= static_cast<unsigned char>(*itr);
+      h *= 1099511628211u;
+    }
+    h = h ? h : 1u;
+    hashValue.store(h, std::memory_order_relaxed);
+  }
+  return h;
+}
@@ -28,21 +28,50 @@ The views and conclusions contained in the software and documentation are those
 of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
+#include <mutex>
+#include <vector>
 #include <lpp/core/types/symbol.h>
 #include <lpp/core/memory/allocator.h>
 
 using Symbol = Lisp::Symbol;
 
+namespace
+{
+  // symbol ids are shared by all allocators
+  std::mutex idMutex;
+  std::vector<std::size_t> freeIds;
+  std::size_t nextId = 0;
+
+  std::size_t acquireId()
+  {
+    std::lock_guard<std::mutex> lock(idMutex);
+    if(freeIds.empty())
+    {
+      return nextId++;
+    }
+    std::size_t id = freeIds.back();
+    freeIds.pop_back();
+    return id;
+  }
+
+  void releaseId(std::size_t id)
+  {
+    std::lock_guard<std::mutex> lock(idMutex);
+    freeIds.push_back(id);
+  }
+}
+
 Lisp::Symbol::~Symbol()
 {
   if(allocator)
   {
     allocator->remove(this); 
   }
+  releaseId(id);
 }
 
 Symbol::Symbol(const std::string & _name, Allocator * _allocator)
-  : name(_name), allocator(_allocator)
+  : name(_name), allocator(_allocator), id(acquireId())
 {
 }
 
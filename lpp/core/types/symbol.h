@@ -31,6 +31,7 @@ either expressed or implied, of the FreeBSD Project.
 #pragma once
 #include <cstdint>
 #include <functional>
+#include <string>
 #include <lpp/core/types/type_id.h>
 #include <lpp/core/types/managed_type.h>
 
@@ -43,12 +44,19 @@ namespace Lisp
   public:
     ~Symbol();
     inline const std::string& getName() const;
+
+    /**
+     * Dense id of the symbol, unique among all living symbols.
+     * Ids of destroyed symbols are reused.
+     */
+    inline std::size_t getId() const;
   private:
     friend class Allocator;
     friend class Cell;
     Symbol(const std::string & _name, Allocator * _allocator=nullptr);
     std::string name;
     Allocator * allocator;
+    std::size_t id;
   };
 }
 
@@ -57,3 +65,8 @@ inline const std::string& Lisp::Symbol::getName() const
 {
   return name;
 }
+
+inline std::size_t Lisp::Symbol::getId() const
+{
+  return id;
+}
@@ -103,6 +103,7 @@ namespace Lisp
   class ManagedType;
   class String;
   class Symbol;
+  class BuiltinFunction;
   class PolymorphicObject;
 
   /* conses types */
@@ -115,6 +116,8 @@ namespace Lisp
   class Array;
   class Function;
   class Continuation;
+  class Closure;
+  class CapturedContinuation;
   class PolymorphicContainer;
 
   namespace Traits
@@ -160,6 +163,7 @@ namespace Lisp
   DEF_TRAITS_MATCH(ManagedType, 0x8000u,                          Traits::ManagedType);
   DEF_TRAITS(String,            0x8001u,                          Traits::ManagedType);
   DEF_TRAITS(Symbol,            0x8002u,                          Traits::Symbol);
+  DEF_TRAITS(BuiltinFunction,   0x8003u,                          Traits::ManagedType);
   DEF_TRAITS(PolymorphicObject, POLYMORPHIC_OBJECT_TYPE_ID,       Traits::ManagedType);
 
   // containers
@@ -167,6 +171,8 @@ namespace Lisp
   DEF_TRAITS(Array,                0xc001u,                       Traits::Container);
   DEF_TRAITS(Function,             0xc002u,                       Traits::Container);
   DEF_TRAITS(Continuation,         0xc003u,                       Traits::Container);
+  DEF_TRAITS(Closure,              0xc004u,                       Traits::Container);
+  DEF_TRAITS(CapturedContinuation, 0xc005u,                       Traits::Container);
   DEF_TRAITS(PolymorphicContainer, POLYMORPHIC_CONTAINER_TYPE_ID, Traits::Container);
 
   /* Collectible TypeTraits
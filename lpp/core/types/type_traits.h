@@ -305,7 +305,8 @@ namespace Lisp
       {
         if(TypeMatcher::isA(tid))
         {
-          return dynamic_cast<T*>(data.pManaged);
+          // the type id identifies the symbol class
+          return static_cast<T*>(data.pManaged);
         }
         else
         {
@@ -0,0 +1,54 @@
+#include <lpp/core/value_stack.h>
+
+using ValueStack = Lisp::ValueStack;
+
+const std::size_t ValueStack::defaultCapacity = 64;
+const std::size_t ValueStack::defaultMaxSize = 1u << 20;
+
+ValueStack::ValueStack(std::size_t _capacity, std::size_t _maxSize)
+  : cells(nullptr), top(0), cap(_capacity < _maxSize ? _capacity : _maxSize), maxSize(_maxSize)
+{
+  assert(cap > 0);
+  cells = static_cast<Cell*>(std::malloc(cap * sizeof(Cell)));
+  if(!cells)
+  {
+    throw std::bad_alloc();
+  }
+}
+
+ValueStack::~ValueStack()
+{
+  truncate(0);
+  std::free(cells);
+}
+
+void ValueStack::setMaxSize(std::size_t _maxSize)
+{
+  if(_maxSize < top)
+  {
+    throw StackOverflow(_maxSize);
+  }
+  maxSize = _maxSize;
+}
+
+void ValueStack::grow(std::size_t n)
+{
+  if(n > maxSize)
+  {
+    throw StackOverflow(maxSize);
+  }
+  if(n < 2 * cap)
+  {
+    n = 2 * cap < maxSize ? 2 * cap : maxSize;
+  }
+  // a Cell is a type id and a pointer or an atom without self references,
+  // it can be relocated bitwise
+  Cell * tmp = static_cast<Cell*>(std::realloc(static_cast<void*>(cells),
+                                               n * sizeof(Cell)));
+  if(!tmp)
+  {
+    throw std::bad_alloc();
+  }
+  cells = tmp;
+  cap = n;
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <lpp/core/cell.h>
+#include <lpp/core/exception.h>
+
+namespace Lisp
+{
+  /**
+   * Contiguous value stack of a continuation.
+   *
+   * The storage is preallocated and only grows (by doubling) when the
+   * capacity is exhausted, up to a maximum size. Pushing beyond the
+   * maximum size throws StackOverflow.
+   * Cells above the top are not constructed: removing cells does not
+   * reset them, only cells of managed types release their reference.
+   * Cells are relocated bitwise, which keeps reference counts intact.
+   */
+  class ValueStack
+  {
+  public:
+    static const std::size_t defaultCapacity;
+    static const std::size_t defaultMaxSize;
+
+    ValueStack(std::size_t _capacity = defaultCapacity,
+               std::size_t _maxSize = defaultMaxSize);
+    ~ValueStack();
+    ValueStack(const ValueStack & rhs) = delete;
+    ValueStack & operator=(const ValueStack & rhs) = delete;
+
+    inline std::size_t size() const;
+    inline bool empty() const;
+    inline std::size_t capacity() const;
+
+    inline std::size_t getMaxSize() const;
+    void setMaxSize(std::size_t _maxSize);
+
+    inline Cell & operator[](std::size_t i);
+    inline const Cell & operator[](std::size_t i) const;
+    inline Cell & back();
+    inline const Cell & back() const;
+    inline Cell * data();
+    inline Cell * begin();
+    inline Cell * end();
+    inline const Cell * begin() const;
+    inline const Cell * end() const;
+
+    inline void push_back(const Cell & rhs);
+    inline void pop_back();
+
+    /**
+     * Make room for n cells in total.
+     * @throw StackOverflow if n exceeds the maximum size
+     */
+    inline void reserve(std::size_t n);
+
+    /**
+     * push_back without capacity check: the room has to be reserved.
+     */
+    inline void pushUnchecked(const Cell & rhs);
+
+    /**
+     * Insert a cell at position pos, the cells above are moved up.
+     */
+    inline void insert(std::size_t pos, const Cell & rhs);
+
+    /**
+     * Remove all cells at positions >= n.
+     */
+    inline void truncate(std::size_t n);
+
+    /**
+     * Replace the cell at pos by the top cell and remove all
+     * cells above pos (function return).
+     */
+    inline void collapse(std::size_t pos);
+
+    /**
+     * Move the n top cells to position pos and remove all
+     * cells above them (tail call).
+     */
+    inline void shift(std::size_t pos, std::size_t n);
+
+  private:
+    Cell * cells;
+    std::size_t top;
+    std::size_t cap;
+    std::size_t maxSize;
+
+    void grow(std::size_t n);
+    inline static void release(Cell * first, Cell * last);
+  };
+}
+
+/******************************************************************************
+ * implementation
+ ******************************************************************************/
+inline std::size_t Lisp::ValueStack::size() const
+{
+  return top;
+}
+
+inline bool Lisp::ValueStack::empty() const
+{
+  return top == 0;
+}
+
+inline std::size_t Lisp::ValueStack::capacity() const
+{
+  return cap;
+}
+
+inline std::size_t Lisp::ValueStack::getMaxSize() const
+{
+  return maxSize;
+}
+
+inline Lisp::Cell & Lisp::ValueStack::operator[](std::size_t i)
+{
+  assert(i < top);
+  return cells[i];
+}
+
+inline const Lisp::Cell & Lisp::ValueStack::operator[](std::size_t i) const
+{
+  assert(i < top);
+  return cells[i];
+}
+
+inline Lisp::Cell & Lisp::ValueStack::back()
+{
+  assert(top > 0);
+  return cells[top - 1];
+}
+
+inline const Lisp::Cell & Lisp::ValueStack::back() const
+{
+  assert(top > 0);
+  return cells[top - 1];
+}
+
+inline Lisp::Cell * Lisp::ValueStack::data()
+{
+  return cells;
+}
+
+inline Lisp::Cell * Lisp::ValueStack::begin()
+{
+  return cells;
+}
+
+inline Lisp::Cell * Lisp::ValueStack::end()
+{
+  return cells + top;
+}
+
+inline const Lisp::Cell * Lisp::ValueStack::begin() const
+{
+  return cells;
+}
+
+inline const Lisp::Cell * Lisp::ValueStack::end() const
+{
+  return cells + top;
+}
+
+inline void Lisp::ValueStack::push_back(const Cell & rhs)
+{
+  if(top == cap)
+  {
+    // rhs may refer to a cell of this stack
+    Cell tmp(rhs);
+    grow(top + 1);
+    new (cells + top) Cell(tmp);
+  }
+  else
+  {
+    new (cells + top) Cell(rhs);
+  }
+  ++top;
+}
+
+inline void Lisp::ValueStack::reserve(std::size_t n)
+{
+  if(n > cap)
+  {
+    grow(n);
+  }
+}
+
+inline void Lisp::ValueStack::pushUnchecked(const Cell & rhs)
+{
+  assert(top < cap);
+  new (cells + top) Cell(rhs);
+  ++top;
+}
+
+inline void Lisp::ValueStack::insert(std::size_t pos, const Cell & rhs)
+{
+  assert(pos <= top);
+  // rhs may refer to a cell of this stack
+  Cell tmp(rhs);
+  if(top == cap)
+  {
+    grow(top + 1);
+  }
+  std::memmove(static_cast<void*>(cells + pos + 1),
+               static_cast<const void*>(cells + pos),
+               (top - pos) * sizeof(Cell));
+  new (cells + pos) Cell(tmp);
+  ++top;
+}
+
+inline void Lisp::ValueStack::pop_back()
+{
+  assert(top > 0);
+  --top;
+  cells[top].~Cell();
+}
+
+inline void Lisp::ValueStack::release(Cell * first, Cell * last)
+{
+  for(; first != last; ++first)
+  {
+    if(first->isA<ManagedType>())
+    {
+      first->~Cell();
+    }
+  }
+}
+
+inline void Lisp::ValueStack::truncate(std::size_t n)
+{
+  assert(n <= top);
+  release(cells + n, cells + top);
+  top = n;
+}
+
+inline void Lisp::ValueStack::collapse(std::size_t pos)
+{
+  assert(pos < top);
+  if(pos + 1 < top)
+  {
+    release(cells + pos, cells + top - 1);
+    std::memcpy(static_cast<void*>(cells + pos),
+                static_cast<const void*>(cells + top - 1),
+                sizeof(Cell));
+    top = pos + 1;
+  }
+}
+
+inline void Lisp::ValueStack::shift(std::size_t pos, std::size_t n)
+{
+  assert(pos + n <= top);
+  if(pos + n < top)
+  {
+    release(cells + pos, cells + top - n);
+    std::memmove(static_cast<void*>(cells + pos),
+                 static_cast<const void*>(cells + top - n),
+                 n * sizeof(Cell));
+    top = pos + n;
+  }
+}
@@ -0,0 +1,289 @@
+#include <limits>
+#include <vector>
+#include <unordered_set>
+#include <lpp/core/verifier.h>
+#include <lpp/core/opcode.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+
+using Function = Lisp::Function;
+using InvalidBytecode = Lisp::InvalidBytecode;
+using InstructionType = Lisp::InstructionType;
+
+static const std::size_t variadic = std::numeric_limits<std::size_t>::max();
+
+namespace
+{
+  class Verifier
+  {
+  public:
+    Verifier(Function & _f) : f(_f), itr(_f.cbegin()), end(_f.cend())
+    {
+      // the function and its arguments
+      stack.assign(f.numArguments() + 1, nullptr);
+      maxDepth = stack.size();
+    }
+
+    std::size_t run()
+    {
+      while(itr != end)
+      {
+        pos = itr - f.cbegin();
+        InstructionType opcode = *itr++;
+        std::size_t n;
+        switch(opcode)
+        {
+        case Lisp::PUSHV:
+          push(dataFunction(operand()));
+          break;
+
+        case Lisp::PUSHL:
+        case Lisp::RETURNL:
+          symbol(operand());
+          push();
+          break;
+
+        case Lisp::DEFINES:
+          symbol(operand());
+          require(1);
+          break;
+
+        case Lisp::RETURNS:
+          n = operand();
+          if(n == 0 || n > stack.size())
+          {
+            fail("RETURNS beyond the frame");
+          }
+          stack.resize(1);
+          break;
+
+        case Lisp::FUNCALL:
+          call(operand());
+          break;
+
+        case Lisp::PUSHV2:
+          push(dataFunction(operand()));
+          push(dataFunction(operand()));
+          break;
+
+        case Lisp::PUSHVFUNCALL:
+          push(dataFunction(operand()));
+          call(operand());
+          break;
+
+        case Lisp::PUSHLFUNCALL:
+          symbol(operand());
+          push();
+          call(operand());
+          break;
+
+        case Lisp::CAR:
+        case Lisp::CDR:
+          primitive(operand(), 1, 1);
+          break;
+
+        case Lisp::CONS:
+        case Lisp::EQ:
+          primitive(operand(), 2, 2);
+          break;
+
+        case Lisp::ADD:
+          primitive(operand(), 0, variadic);
+          break;
+
+        case Lisp::SUB:
+        case Lisp::LT:
+          primitive(operand(), 1, variadic);
+          break;
+
+        case Lisp::PUSHA:
+          // the slot of the rest parameter holds the number of
+          // rest arguments
+          if(operand() >= f.numArguments() - (f.hasRestArgument() ? 1 : 0))
+          {
+            fail("argument out of range");
+          }
+          push();
+          break;
+
+        case Lisp::PUSHR:
+          if(!f.hasRestArgument() || operand() + 1 != f.numArguments())
+          {
+            fail("PUSHR of a non-rest argument");
+          }
+          push();
+          break;
+
+        case Lisp::PUSHC:
+          if(operand() >= f.numCaptured())
+          {
+            fail("captured value out of range");
+          }
+          push();
+          break;
+
+        case Lisp::CLOSURE:
+          {
+            Function * g = dataFunction(operand());
+            if(!g)
+            {
+              fail("CLOSURE of a non-function");
+            }
+            require(g->numCaptured());
+            stack.resize(stack.size() - g->numCaptured());
+            push(g);
+          }
+          break;
+
+        case Lisp::CALLCC:
+          primitive(operand(), 1, 1);
+          break;
+
+        default:
+          fail("unknown opcode");
+        }
+      }
+      return maxDepth;
+    }
+
+  private:
+    [[noreturn]] void fail(const char * reason)
+    {
+      throw InvalidBytecode(&f, pos, reason);
+    }
+
+    std::size_t operand()
+    {
+      std::size_t value = 0;
+      unsigned int shift = 0;
+      InstructionType byte;
+      do
+      {
+        if(itr == end || shift >= 8 * sizeof(std::size_t))
+        {
+          fail("truncated operand");
+        }
+        byte = *itr++;
+        value |= std::size_t(byte & 0x7f) << shift;
+        shift += 7;
+      } while(byte & 0x80);
+      return value;
+    }
+
+    const Lisp::Cell & data(std::size_t i)
+    {
+      if(i >= f.dataSize())
+      {
+        fail("data element out of range");
+      }
+      return f.atCell(i);
+    }
+
+    void symbol(std::size_t i)
+    {
+      if(!data(i).isA<Lisp::Symbol>())
+      {
+        fail("data element is not a symbol");
+      }
+    }
+
+    Function * dataFunction(std::size_t i)
+    {
+      const Lisp::Cell & cell = data(i);
+      return cell.isA<Function>() ? cell.as<Function>() : nullptr;
+    }
+
+    // n operands above the function of the frame
+    void require(std::size_t n)
+    {
+      if(stack.size() < n + 1)
+      {
+        fail("stack underflow");
+      }
+    }
+
+    void push(Function * g = nullptr)
+    {
+      stack.push_back(g);
+      if(stack.size() > maxDepth)
+      {
+        maxDepth = stack.size();
+      }
+    }
+
+    void call(std::size_t n)
+    {
+      // the callee and its arguments
+      require(n + 1);
+      const Function * g = stack[stack.size() - n - 1];
+      if(g && !g->acceptsArguments(n))
+      {
+        fail("number of arguments does not match the function");
+      }
+      stack.resize(stack.size() - n);
+      stack.back() = nullptr;
+    }
+
+    void primitive(std::size_t n, std::size_t minArgs, std::size_t maxArgs)
+    {
+      if(n < minArgs || n > maxArgs)
+      {
+        fail("number of arguments does not match the primitive");
+      }
+      if(n == 0)
+      {
+        push();
+      }
+      else
+      {
+        require(n);
+        stack.resize(stack.size() - n + 1);
+        stack.back() = nullptr;
+      }
+    }
+
+    Function & f;
+    Function::const_iterator itr;
+    Function::const_iterator end;
+    std::size_t pos = 0;
+    // known function constants on the stack of the frame
+    std::vector<const Function*> stack;
+    std::size_t maxDepth;
+  };
+}
+
+std::size_t Lisp::verify(Function & f)
+{
+  // the functions in the data are verified once and may refer to
+  // each other; frozen functions have been verified by
+  // Allocator::freeze and are shared read-only
+  std::unordered_set<const Function*> visited({&f});
+  std::vector<Function*> todo({&f});
+  std::size_t ret = 0;
+  while(!todo.empty())
+  {
+    Function * g = todo.back();
+    todo.pop_back();
+    std::size_t maxDepth = Verifier(*g).run();
+    if(!g->isFrozen())
+    {
+      g->verified = true;
+      g->maxStackDepth = maxDepth;
+    }
+    if(g == &f)
+    {
+      ret = maxDepth;
+    }
+    for(std::size_t i = 0; i < g->dataSize(); i++)
+    {
+      const Cell & cell = g->atCell(i);
+      if(cell.isA<Function>() && !cell.as<Function>()->isVerified() &&
+         visited.insert(cell.as<Function>()).second)
+      {
+        todo.push_back(cell.as<Function>());
+      }
+    }
+  }
+  return ret;
+}
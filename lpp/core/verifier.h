@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+
+namespace Lisp
+{
+  class Function;
+
+  /**
+   * Bytecode verifier.
+   *
+   * Proves for the code of f:
+   * - all opcodes are known and all operands lie within the code,
+   * - data operands are in range and refer to a symbol (PUSHL, RETURNL,
+   *   DEFINES) or a function (CLOSURE),
+   * - argument and captured value indices are in range,
+   * - the stack never drops below the frame: calls, primitives and
+   *   closures find their operands above the function of the frame,
+   *   primitives are applied to a number of arguments they accept,
+   * - calls of function constants pass a number of arguments they accept.
+   * It computes the maximum number of cells of a frame of f, not
+   * counting rest arguments. The interpreter reserves them on entry and
+   * pushes without checks.
+   *
+   * On success f and the functions in its data (lambda expressions)
+   * are marked verified, unless they are frozen (shared between
+   * threads): frozen functions are verified without being modified.
+   *
+   * @return maximum stack depth of f (see Function::getMaxStackDepth())
+   * @throw InvalidBytecode
+   */
+  std::size_t verify(Function & f);
+
+  /**
+   * Maximum stack depth of a function, f is verified if it has not
+   * been verified yet.
+   * @throw InvalidBytecode
+   */
+  inline std::size_t verified(Function & f);
+}
+
+#include <lpp/core/types/function.h>
+
+inline std::size_t Lisp::verified(Function & f)
+{
+  return f.isVerified() ? f.getMaxStackDepth() : verify(f);
+}
@@ -33,12 +33,14 @@ either expressed or implied, of the FreeBSD Project.
 #include <lpp/core/env.h>
 #include <lpp/core/opcode.h>
 #include <lpp/core/types/function.h>
+#include <lpp/core/types/closure.h>
 #include <lpp/core/types/form.h>
 #include <lpp/core/types/type_id.h>
 #include <lpp/core/types/symbol.h>
 #include <lpp/core/types/reference.h>
 #include <lpp/core/types/continuation.h>
 #include <lpp/core/exception.h>
+#include <lpp/core/builtins.h>
 #include "config.h"
 
 
@@ -54,16 +56,23 @@ using Cell = Lisp::Cell;
 using Env = Lisp::Env;
 
 using Function = Lisp::Function;
+using Closure = Lisp::Closure;
 using Cons = Lisp::Cons;
 using Symbol = Lisp::Symbol;
 using Reference = Lisp::Reference;
+using Continuation = Lisp::Continuation;
+using ValueStack = Lisp::ValueStack;
 
 Vm::Vm(std::shared_ptr<Allocator> _alloc,
        std::shared_ptr<Env> _env)
   : alloc(_alloc ? _alloc : std::make_shared<Allocator>()),
-    env(_env ? _env : std::make_shared<Env>())
+    env(_env ? _env : std::make_shared<Env>()),
+    maxStackSize(ValueStack::defaultMaxSize),
+    budget(Continuation::unlimited),
+    timeLimit(Continuation::Clock::duration::zero())
 {
   dataStack.reserve(1024);
+  Builtin::define(*this);
 }
 
 Lisp::Object Lisp::Vm::reference(const Cell & car, const Cell & value)
@@ -83,13 +92,44 @@ Object Lisp::Vm::find(const std::string & name) const
 
 Object Lisp::Vm::eval(const Cell & func)
 {
-  assert(func.isA<Function>());
-  Object cont = make<Continuation>(func);
-  return Object(cont.as<Continuation>()->eval());
+  return call<Object>(func);
 }
 
-Object Lisp::Vm::eval(std::vector<Cell> && args)
+Object Lisp::Vm::acquireContinuation()
 {
-  Object cont = make<Continuation>(std::move(args));
-  return Object(cont.as<Continuation>()->eval());
+  Object cont;
+  if(continuations.empty())
+  {
+    cont = Object(alloc->makeRoot<Continuation>(env));
+  }
+  else
+  {
+    cont = std::move(continuations.back());
+    continuations.pop_back();
+  }
+  cont.as<Continuation>()->setMaxStackSize(maxStackSize);
+  cont.as<Continuation>()->setProfiler(profiler.get());
+  cont.as<Continuation>()->setInstrumentation(&instrumentation);
+  cont.as<Continuation>()->setBudget(budget);
+  if(timeLimit != Continuation::Clock::duration::zero())
+  {
+    cont.as<Continuation>()->setDeadline(Continuation::Clock::now() + timeLimit);
+  }
+  else
+  {
+    cont.as<Continuation>()->clearDeadline();
+  }
+  return cont;
+}
+
+void Lisp::Vm::releaseContinuation(Object && cont)
+{
+  if(cont.as<Continuation>()->isExhausted())
+  {
+    // suspended by its budget: owned by the Timeout exception
+    return;
+  }
+  // the finished continuation must not keep its values alive
+  cont.as<Continuation>()->reset();
+  continuations.push_back(std::move(cont));
 }
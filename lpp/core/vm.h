@@ -30,13 +30,20 @@ either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #pragma once
 #include <memory>
+#include <type_traits>
+#include <vector>
 #include <lpp/core/object.h>
+#include <lpp/core/convert.h>
 #include <lpp/core/language_interface.h>
 #include <lpp/core/memory/allocator.h>
 #include <lpp/core/types/array.h>
+#include <lpp/core/types/continuation.h>
+#include <lpp/core/instrumentation.h>
 
 namespace Lisp
 {
+  class Profiler;
+
   class Vm
   {
   public:
@@ -46,6 +53,7 @@ namespace Lisp
        std::shared_ptr<Env> _env = nullptr);
     
     inline std::shared_ptr<Allocator> getAllocator() const;
+    inline std::shared_ptr<Env> getEnv() const;
 
     template<typename T, typename... ARGS>
     inline Object make(ARGS && ...rest);
@@ -74,11 +82,61 @@ namespace Lisp
     void define(const std::string & name, const Object & rhs);
     Object find(const std::string & name) const;
 
+    /**
+     * Call func with the arguments and return the result.
+     * Evaluations run on continuations of a pool of the vm that are
+     * reused, evaluations may be nested (e.g. by builtins).
+     */
     Object eval(const Cell & func);
 
     template<typename... ARGS>
     inline Object eval(const Cell & func, ARGS && ...arg);
 
+    /**
+     * Call func with the arguments converted to cells and convert the
+     * result to R (see convert.h). The arguments are pushed directly
+     * on the stack of a pooled continuation. func is a function, a
+     * closure, a builtin function or a captured continuation.
+     * @throw NonMatchingArguments, NotAFunction, NotAnInteger, ...
+     */
+    template<typename R, typename... ARGS>
+    inline R call(const Cell & func, ARGS && ...arg);
+
+    /**
+     * Maximum number of cells on the value stack of an evaluation.
+     * Deeper evaluations raise StackOverflow.
+     */
+    inline std::size_t getMaxStackSize() const;
+    inline void setMaxStackSize(std::size_t n);
+
+    /**
+     * Number of function calls of each evaluation and of each green
+     * thread (see Scheduler::spawn), Continuation::unlimited by default.
+     * Exhausting it raises Timeout with the suspended continuation.
+     */
+    inline std::size_t getBudget() const;
+    inline void setBudget(std::size_t calls);
+
+    /**
+     * Wall clock time of each evaluation and of each green thread,
+     * zero: no limit. Exceeding it raises Timeout.
+     */
+    inline Continuation::Clock::duration getTimeLimit() const;
+    inline void setTimeLimit(Continuation::Clock::duration limit);
+
+    /**
+     * Profiler of all evaluations (nullptr: no profiling).
+     */
+    inline std::shared_ptr<Profiler> getProfiler() const;
+    inline void setProfiler(std::shared_ptr<Profiler> _profiler);
+
+    /**
+     * Execution counters of all evaluations, only collected by
+     * instrumented builds (Instrumentation::enabled).
+     */
+    inline Instrumentation & getInstrumentation();
+    inline const Instrumentation & getInstrumentation() const;
+
   private:
     template<typename C>
     inline const C & _makeRoot(std::true_type, const C & c);
@@ -94,17 +152,40 @@ namespace Lisp
     template<typename T, typename ARG>
     inline Continuation * _allocRoot(std::true_type, ARG&& args);
 
-    inline void vectorAppender(std::vector<Cell> & v);
-    inline void vectorAppender(std::vector<Cell> & v, const Cell & c);
-
-    template<typename... ARGS>
-    inline void vectorAppender(std::vector<Cell> & v, const Cell & c, ARGS && ...rest);
-
-    Object eval(std::vector<Cell> && args);
+    /**
+     * Continuation of the pool, returned to the pool on destruction.
+     */
+    class PooledContinuation
+    {
+    public:
+      inline PooledContinuation(Vm & _vm);
+      inline ~PooledContinuation();
+      PooledContinuation(const PooledContinuation & rhs) = delete;
+      PooledContinuation & operator=(const PooledContinuation & rhs) = delete;
+      inline Continuation * operator->() const;
+    private:
+      Vm & vm;
+      Object cont;
+    };
+
+    Object acquireContinuation();
+    void releaseContinuation(Object && cont);
+
+    inline void pushArguments(Continuation * cont);
+
+    template<typename ARG, typename... ARGS>
+    inline void pushArguments(Continuation * cont, ARG && arg, ARGS && ...rest);
 
     std::shared_ptr<Allocator> alloc;
     std::shared_ptr<Env> env;
     std::vector<Object> dataStack;
+    // continuations of finished evaluations
+    std::vector<Object> continuations;
+    std::size_t maxStackSize;
+    std::size_t budget;
+    Continuation::Clock::duration timeLimit;
+    std::shared_ptr<Profiler> profiler;
+    Instrumentation instrumentation;
   };
 }
 
@@ -122,6 +203,61 @@ std::shared_ptr<Lisp::Allocator> Lisp::Vm::getAllocator() const
 //  return Lisp::Object(_makeRoot<T>(typename TypeTraits<T>::IsAtomic(),  rest...));
 //}
 
+std::shared_ptr<Lisp::Env> Lisp::Vm::getEnv() const
+{
+  return env;
+}
+
+inline std::size_t Lisp::Vm::getMaxStackSize() const
+{
+  return maxStackSize;
+}
+
+inline void Lisp::Vm::setMaxStackSize(std::size_t n)
+{
+  maxStackSize = n;
+}
+
+inline std::size_t Lisp::Vm::getBudget() const
+{
+  return budget;
+}
+
+inline void Lisp::Vm::setBudget(std::size_t calls)
+{
+  budget = calls;
+}
+
+inline Lisp::Continuation::Clock::duration Lisp::Vm::getTimeLimit() const
+{
+  return timeLimit;
+}
+
+inline void Lisp::Vm::setTimeLimit(Continuation::Clock::duration limit)
+{
+  timeLimit = limit;
+}
+
+inline std::shared_ptr<Lisp::Profiler> Lisp::Vm::getProfiler() const
+{
+  return profiler;
+}
+
+inline void Lisp::Vm::setProfiler(std::shared_ptr<Profiler> _profiler)
+{
+  profiler = _profiler;
+}
+
+inline Lisp::Instrumentation & Lisp::Vm::getInstrumentation()
+{
+  return instrumentation;
+}
+
+inline const Lisp::Instrumentation & Lisp::Vm::getInstrumentation() const
+{
+  return instrumentation;
+}
+
 template<typename T, typename... ARGS>
 inline Lisp::Object Lisp::Vm::make(ARGS && ...rest)
 {
@@ -195,27 +331,45 @@ inline Lisp::Continuation * Lisp::Vm::_allocRoot(std::true_type, ARG&& args)
   return alloc->makeRoot<Continuation>(std::forward<ARG>(args), env);
 }
 
-inline void Lisp::Vm::vectorAppender(std::vector<Cell> & v)
+inline Lisp::Vm::PooledContinuation::PooledContinuation(Vm & _vm)
+  : vm(_vm), cont(_vm.acquireContinuation())
 {
 }
 
-inline void Lisp::Vm::vectorAppender(std::vector<Cell> & v, const Cell & c)
+inline Lisp::Vm::PooledContinuation::~PooledContinuation()
 {
-  v.push_back(c);
+  vm.releaseContinuation(std::move(cont));
 }
 
-template<typename... ARGS>
-inline void Lisp::Vm::vectorAppender(std::vector<Cell> & v, const Cell & c, ARGS && ...rest)
+inline Lisp::Continuation * Lisp::Vm::PooledContinuation::operator->() const
 {
-  v.push_back(c);
-  vectorAppender(v, rest...);
+  return cont.as<Continuation>();
+}
+
+inline void Lisp::Vm::pushArguments(Continuation * cont)
+{
+}
+
+template<typename ARG, typename... ARGS>
+inline void Lisp::Vm::pushArguments(Continuation * cont, ARG && arg, ARGS && ...rest)
+{
+  using T = typename std::decay<ARG>::type;
+  cont->push(Convert<T>::toCell(*alloc, arg));
+  pushArguments(cont, std::forward<ARGS>(rest)...);
 }
 
 template<typename... ARGS>
 inline Lisp::Object Lisp::Vm::eval(const Cell & func, ARGS && ...rest)
 {
-  std::vector<Cell> args{func};
-  vectorAppender(args, rest...);
-  return eval(std::move(args));
+  return call<Object>(func, std::forward<ARGS>(rest)...);
 }
 
+template<typename R, typename... ARGS>
+inline R Lisp::Vm::call(const Cell & func, ARGS && ...rest)
+{
+  PooledContinuation cont(*this);
+  cont->push(func);
+  pushArguments(cont.operator->(), std::forward<ARGS>(rest)...);
+  cont->call(sizeof...(ARGS));
+  return Convert<R>::fromCell(cont->eval());
+}
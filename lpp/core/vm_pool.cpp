@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <lpp/core/vm_pool.h>
+#include <lpp/core/env.h>
+#include <lpp/core/memory/allocator.h>
+
+using VmPool = Lisp::VmPool;
+using Vm = Lisp::Vm;
+using Env = Lisp::Env;
+using Allocator = Lisp::Allocator;
+using Cell = Lisp::Cell;
+using Object = Lisp::Object;
+
+VmPool::VmPool(const Vm & code, std::size_t numThreads)
+  : codeAllocator(code.getAllocator()), stopped(false)
+{
+  // promote the global bindings to the shared code space,
+  // functions are verified before they become immutable (see freeze)
+  std::shared_ptr<Env> codeEnv = code.getEnv();
+  codeEnv->forEach([this](const Cell & symbol, const Object & value) {
+      codeAllocator->share(symbol);
+      codeAllocator->freeze(value);
+    });
+  if(numThreads == 0)
+  {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers.reserve(numThreads);
+  for(std::size_t i = 0; i < numThreads; i++)
+  {
+    auto alloc = std::make_shared<Allocator>();
+    alloc->importSymbols(*codeAllocator);
+    auto env = std::make_shared<Env>(*codeEnv);
+    workers.emplace_back(&VmPool::run, this, alloc, env);
+  }
+}
+
+VmPool::~VmPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  condition.notify_all();
+  for(auto & worker : workers)
+  {
+    worker.join();
+  }
+}
+
+void VmPool::push(Task && task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+  }
+  condition.notify_one();
+}
+
+void VmPool::run(std::shared_ptr<Allocator> alloc, std::shared_ptr<Env> env)
+{
+  Vm vm(alloc, env);
+  while(true)
+  {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this]{ return stopped || !tasks.empty(); });
+      if(tasks.empty())
+      {
+        // stopped, all tasks are done
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task(vm);
+  }
+}
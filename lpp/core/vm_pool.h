@@ -0,0 +1,86 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <lpp/core/vm.h>
+
+namespace Lisp
+{
+  class Env;
+  class Allocator;
+
+  /**
+   * Pool of worker threads that evaluate independent requests.
+   *
+   * All global bindings of the code vm (compiled functions and their
+   * constant data, builtins) are frozen into the permanent space of its
+   * allocator and shared read-only by the workers. Each worker has its
+   * own Vm with its own allocator and a copy of the global bindings,
+   * evaluations on different workers do not synchronize.
+   * All functions reachable from the bindings are verified when
+   * they are frozen (see Allocator::freeze).
+   *
+   * The code vm must not be modified while the pool exists.
+   * Objects of a worker heap must not leave the task that created them:
+   * tasks return plain values (or results converted to C++ types).
+   */
+  class VmPool
+  {
+  public:
+    /**
+     * @param code vm with the global bindings to share
+     * @param numThreads number of workers, 0: one per hardware thread
+     */
+    VmPool(const Vm & code, std::size_t numThreads = 0);
+    ~VmPool();
+    VmPool(const VmPool & rhs) = delete;
+    VmPool & operator=(const VmPool & rhs) = delete;
+
+    inline std::size_t numThreads() const;
+
+    /**
+     * Run task(Vm&) on the next free worker.
+     */
+    template<typename F>
+    std::future<typename std::result_of<F(Vm&)>::type> submit(F && task);
+
+  private:
+    using Task = std::function<void(Vm&)>;
+    void run(std::shared_ptr<Allocator> alloc, std::shared_ptr<Env> env);
+    void push(Task && task);
+
+    // keeps the frozen objects alive
+    std::shared_ptr<Allocator> codeAllocator;
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopped;
+  };
+}
+
+/******************************************************************************
+ * implementation
+ ******************************************************************************/
+inline std::size_t Lisp::VmPool::numThreads() const
+{
+  return workers.size();
+}
+
+template<typename F>
+std::future<typename std::result_of<F(Lisp::Vm&)>::type> Lisp::VmPool::submit(F && task)
+{
+  using R = typename std::result_of<F(Vm&)>::type;
+  // std::function requires a copyable callable
+  auto packaged = std::make_shared<std::packaged_task<R(Vm&)>>(std::forward<F>(task));
+  std::future<R> result = packaged->get_future();
+  push([packaged](Vm & vm) { (*packaged)(vm); });
+  return result;
+}
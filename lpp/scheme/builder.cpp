@@ -2,6 +2,9 @@
 #include <lpp/core/types/function.h>
 #include <lpp/core/util.h>
 #include <lpp/core/opcode.h>
+#include <lpp/core/builtins.h>
+#include <lpp/core/verifier.h>
+#include <lpp/core/types/symbol.h>
 
 using Builder = Lisp::Scheme::Builder;
 
@@ -15,7 +18,14 @@ Builder::Builder(Allocator * _allocator, Builder * _parent)
 
 void Builder::finalize()
 {
+  func->setNumCaptured(captured.size());
+  peephole(func, statistics);
   func->shrink();
+  verify(*func);
+  if(parent)
+  {
+    parent->statistics += statistics;
+  }
 }
 
 void Builder::idempotent(const Cell & cell)
@@ -32,34 +42,88 @@ void Builder::reference(const Cell & cell)
 
 void Builder::symbol(const Cell & cell)
 {
-  std::size_t argPos = func->getArgumentPos(cell);
-  if(argPos == Function::notFound)
+  std::size_t pos = func->getArgumentPos(cell);
+  if(pos != Function::notFound)
   {
-    Builder * p = parent;
-    while(p)
+    if(func->hasRestArgument() && pos + 1 == func->numArguments())
+    {
+      func->addPUSHR(pos);
+    }
+    else
     {
-      argPos = p->func->getArgumentPos(cell);
-      if(argPos == Function::notFound)
-      {
-        p = p->parent;
-      }
-      else
-      {
-        func->addPUSHV(p->func->shareArgument(argPos));
-        return;
-      }
+      func->addPUSHA(pos);
     }
+    return;
+  }
+  pos = capture(cell);
+  if(pos != Function::notFound)
+  {
+    func->addPUSHC(pos);
+  }
+  else
+  {
     func->addPUSHL(cell);
   }
+}
+
+std::size_t Builder::capture(const Cell & cell)
+{
+  for(std::size_t i = 0; i < captured.size(); i++)
+  {
+    if(captured[i].as<Symbol>() == cell.as<Symbol>())
+    {
+      return i;
+    }
+  }
+  if(parent && parent->isLocal(cell))
+  {
+    captured.push_back(Object(cell));
+    return captured.size() - 1;
+  }
+  return Function::notFound;
+}
+
+void Builder::closure(const Builder & inner)
+{
+  if(inner.captured.empty())
+  {
+    func->addPUSHV(inner.getFunctionObject());
+  }
   else
   {
-    assert(func->numArguments() > argPos);
-    func->addRETURNS(func->numArguments() - argPos);
+    // the free variables of the inner function are arguments
+    // or free variables of this function
+    for(const Object & cell : inner.captured)
+    {
+      symbol(cell);
+    }
+    func->addCLOSURE(inner.getFunctionObject());
   }
+  lastLambda = inner.func;
+  lastLambdaEnd = func->numInstructions();
+}
+
+bool Builder::isLocal(const Cell & cell) const
+{
+  const Builder * b = this;
+  while(b)
+  {
+    if(b->func->getArgumentPos(cell) != Function::notFound)
+    {
+      return true;
+    }
+    b = b->parent;
+  }
+  return false;
 }
 
 void Builder::define(const Cell & car, const Cell & cdr)
 {
+  if(lastLambda && lastLambdaEnd == func->numInstructions() &&
+     lastLambda->getName().empty())
+  {
+    lastLambda->setName(car.as<Symbol>()->getName());
+  }
   func->addDEFINES(car);
 }
 
@@ -68,6 +132,21 @@ void Builder::lambdaArgument(const Cell & arg)
   func->addArgument(arg);
 }
 
+void Builder::optionalArgument(const Cell & arg)
+{
+  func->addOptionalArgument(arg);
+}
+
+void Builder::restArgument(const Cell & arg)
+{
+  func->addRestArgument(arg);
+}
+
+void Builder::procedureCallArgument()
+{
+  argumentPositions.push_back(func->numInstructions());
+}
+
 void Builder::funcall(const Cell & lst)
 {
   std::size_t l = listLength(lst);
@@ -77,7 +156,28 @@ void Builder::funcall(const Cell & lst)
   }
   else
   {
-    func->addFUNCALL(l - 1);
+    // Calls of builtins with a matching number of arguments are
+    // compiled to primitive operations: the names of the builtins
+    // are integrable, redefining them globally does not affect
+    // compiled code.
+    assert(argumentPositions.size() >= l);
+    std::size_t headPos = argumentPositions[argumentPositions.size() - l];
+    argumentPositions.resize(argumentPositions.size() - l);
+    const Cell & head = lst.as<Cons>()->getCarCell();
+    InstructionType opcode = 0;
+    if(head.isA<Symbol>() && !isLocal(head))
+    {
+      opcode = Builtin::primitive(head.as<Symbol>()->getName(), l - 1);
+    }
+    if(opcode)
+    {
+      func->removeInstruction(headPos);
+      func->addPrimitive(opcode, l - 1);
+    }
+    else
+    {
+      func->addFUNCALL(l - 1);
+    }
   }
 }
 
@@ -1,5 +1,7 @@
 #pragma once
+#include <vector>
 #include <lpp/core/object.h>
+#include <lpp/core/peephole.h>
 
 namespace Lisp
 {
@@ -18,18 +20,63 @@ namespace Lisp
       void symbol(const Cell & cell);
       void define(const Cell & car, const Cell & cdr);
       void lambdaArgument(const Cell & arg);
+      void optionalArgument(const Cell & arg);
+      void restArgument(const Cell & arg);
       void funcall(const Cell & arg);
       void lambda(const Cell & functionCell);
 
+      /**
+       * Evaluate the lambda expression compiled by inner:
+       * push the function, or a closure of the function and
+       * its free variables.
+       */
+      void closure(const Builder & inner);
 
+      /**
+       * Record the code position of the next element of a
+       * procedure call (operator or operand).
+       */
+      void procedureCallArgument();
+
+
+      /**
+       * Optimize the function and add the peephole statistics
+       * to the parent builder.
+       */
       void finalize();
       inline const Object & getFunctionObject() const;
       Function * getFunction() const;
+
+      /**
+       * Peephole statistics of the function and all nested lambdas.
+       */
+      inline const PeepholeStatistics & getStatistics() const;
     private:
+      /**
+       * True if cell is a lambda argument of this function or
+       * one of its enclosing functions.
+       */
+      bool isLocal(const Cell & cell) const;
+
+      /**
+       * Position of the symbol in the free variables of the function.
+       * The symbol is added if it is bound in an enclosing function.
+       * @return position or Function::notFound for global symbols
+       */
+      std::size_t capture(const Cell & cell);
+
       Builder * parent;
       Function * func;
       Allocator * allocator;
       Object funcObject;
+      PeepholeStatistics statistics;
+      std::vector<std::size_t> argumentPositions;
+      std::vector<Object> captured;
+
+      // the lambda expression compiled last and the code position
+      // after it: (define name (lambda ...)) names the function
+      Function * lastLambda = nullptr;
+      std::size_t lastLambdaEnd = 0;
     };
   }
 }
@@ -43,3 +90,8 @@ inline Lisp::Function * Lisp::Scheme::Builder::getFunction() const
 {
   return func;
 }
+
+inline const Lisp::PeepholeStatistics & Lisp::Scheme::Builder::getStatistics() const
+{
+  return statistics;
+}
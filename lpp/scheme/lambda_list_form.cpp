@@ -0,0 +1,99 @@
+#include <lpp/scheme/lambda_list_form.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/symbol.h>
+
+// lisp
+using Cell = Lisp::Cell;
+using Form = Lisp::Form;
+
+// types
+using Cons = Lisp::Cons;
+using Nil = Lisp::Nil;
+using Symbol = Lisp::Symbol;
+
+// scheme
+using Builder = Lisp::Scheme::Builder;
+using LambdaListForm = Lisp::Scheme::LambdaListForm;
+
+
+LambdaListForm::LambdaListForm(Form * _optionalMarker, Form * _restMarker)
+{
+  cells.push_back(Cell(_optionalMarker));
+  cells.push_back(Cell(_restMarker));
+  optionalMarker = _optionalMarker;
+  restMarker = _restMarker;
+}
+
+bool LambdaListForm::isInstance(const Cell & cell) const
+{
+  return parse(cell, nullptr);
+}
+
+bool LambdaListForm::match(const Cell & cell, Builder & builder) const
+{
+  return parse(cell, &builder);
+}
+
+bool LambdaListForm::parse(const Cell & cell, Builder * builder) const
+{
+  bool optional = false;
+  const Cell * c = &cell;
+  while(!c->isA<Nil>())
+  {
+    if(c->isA<Symbol>())
+    {
+      // dotted tail
+      if(builder)
+      {
+        builder->restArgument(*c);
+      }
+      return true;
+    }
+    Cons * cons = c->as<Cons>();
+    if(!cons)
+    {
+      return false;
+    }
+    const Cell & car = cons->getCarCell();
+    if(optionalMarker->isInstance(car))
+    {
+      if(optional)
+      {
+        return false;
+      }
+      optional = true;
+    }
+    else if(restMarker->isInstance(car))
+    {
+      // exactly one symbol follows #!rest
+      Cons * tail = cons->getCdrCell().as<Cons>();
+      if(!tail || !tail->getCarCell().isA<Symbol>() ||
+         !tail->getCdrCell().isA<Nil>())
+      {
+        return false;
+      }
+      c = &tail->getCarCell();
+      continue;
+    }
+    else if(car.isA<Symbol>())
+    {
+      if(builder)
+      {
+        if(optional)
+        {
+          builder->optionalArgument(car);
+        }
+        else
+        {
+          builder->lambdaArgument(car);
+        }
+      }
+    }
+    else
+    {
+      return false;
+    }
+    c = &cons->getCdrCell();
+  }
+  return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <lpp/core/types/form_builder.h>
+#include <lpp/scheme/builder.h>
+
+namespace Lisp
+{
+  class Cell;
+
+  namespace Scheme
+  {
+    /**
+     * Parameter list of a lambda expression:
+     *
+     * (a b)                    required parameters
+     * (a #!optional b c)       optional parameters
+     * (a #!rest r), (a . r)    rest parameter
+     * r                        all arguments are rest arguments
+     */
+    class LambdaListForm : public Lisp::FormBuilder<Builder>
+    {
+    public:
+      LambdaListForm(Form * _optionalMarker, Form * _restMarker);
+      bool isInstance(const Cell & cell) const override;
+      bool match(const Cell & cell, Builder & builder) const override;
+    private:
+      bool parse(const Cell & cell, Builder * builder) const;
+      Form * optionalMarker;
+      Form * restMarker;
+    };
+  }
+}
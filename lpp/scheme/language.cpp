@@ -1,6 +1,7 @@
 #include <lpp/scheme/builder.h>
 #include <lpp/scheme/language.h>
 #include <lpp/scheme/lambda_form.h>
+#include <lpp/scheme/lambda_list_form.h>
 #include <lpp/scheme/procedure_call_arg_decorator.h>
 #include <lpp/core/vm.h>
 #include <lpp/core/cell.h>
@@ -40,6 +41,7 @@ using Guard = Lisp::Allocator::Guard;
 using Language = Lisp::Scheme::Language;
 using Builder = Lisp::Scheme::Builder;
 using ProcedureCallArgDecorator = Lisp::Scheme::ProcedureCallArgDecorator;
+using LambdaListForm = Lisp::Scheme::LambdaListForm;
 
 // forms 
 using ChoiceOfForm = Lisp::ChoiceOf<Builder>;
@@ -71,6 +73,8 @@ Object Language::compile(const Cell & cell) const
   Builder builder(getAllocator());
   if(topLevelForm->match(cell, builder))
   {
+    builder.finalize();
+    statistics += builder.getStatistics();
   }
   else
   {
@@ -98,6 +102,7 @@ bool ProcedureCallArgDecorator::isInstance(const Cell & cell) const
 
 bool ProcedureCallArgDecorator::match(const Cell & cell, Builder & builder) const
 {
+  builder.procedureCallArgument();
   return expression->match(cell, builder);
 }
 //////////////////////////////////////////
@@ -119,8 +124,8 @@ void Language::init()
   expression->add(make<SymbolForm>(&Builder::symbol));
 
   expression->add(make<ConsOfForm>(symbolEq("lambda"),
-                                   make<LambdaForm>(make<ListOfForm>(make<SymbolForm>(),
-                                                                     &Builder::lambdaArgument),
+                                   make<LambdaForm>(make<LambdaListForm>(symbolEq("#!optional"),
+                                                                         symbolEq("#!rest")),
                                                     make<ConsOfForm>(expression,
                                                                      make<NilForm>()))));
 
@@ -25,11 +25,22 @@ namespace Lisp
       bool isInstance(const Cell & cell) const override;
       Object compile(const Cell & cell) const override;
 
+      /**
+       * Accumulated peephole statistics of all compiled functions.
+       */
+      inline const PeepholeStatistics & getStatistics() const;
+
     private:
       Form * symbolEq(const std::string & name);
       ChoiceOf<Builder> * expression;
       ChoiceOf<Builder> * topLevelForm;
       Form * lambdaForm;
+      mutable PeepholeStatistics statistics;
     };
   }
 }
+
+inline const Lisp::PeepholeStatistics & Lisp::Scheme::Language::getStatistics() const
+{
+  return statistics;
+}
@@ -39,6 +39,8 @@ either expressed or implied, of the FreeBSD Project.
 #include <lpp/core/types/cons.h>
 #include <lpp/core/types/array.h>
 #include <lpp/core/types/symbol.h>
+#include <lpp/core/types/string.h>
+#include <lpp/core/exception.h>
 #include <lpp/core/object.h>
 
 #include <lpp/simul/collectible_graph.h>
@@ -992,6 +994,93 @@ TEST_CASE("symbol_life_cycle", "[Allcator]")
   REQUIRE(psymb->getRefCount() == 1);
 }
 
+TEST_CASE("symbol_shared", "[Allcator]")
+{
+  Object symb;
+  {
+    Allocator alloc;
+    symb = Object(alloc.makeRoot<Symbol>("symb1"));
+    REQUIRE_FALSE(symb.as<Symbol>()->isShared());
+    alloc.share(symb);
+    REQUIRE(symb.as<Symbol>()->isShared());
+    // pinned by the allocator
+    REQUIRE(symb.getRefCount() == 2);
+    symb = Lisp::nil;
+    Object symb2(alloc.makeRoot<Symbol>("symb1"));
+    REQUIRE(symb2.getRefCount() == 2);
+    symb = symb2;
+  }
+  // survives the allocator
+  REQUIRE(symb.getRefCount() == 1);
+  REQUIRE(symb.as<Symbol>()->getName() == "symb1");
+}
+
+TEST_CASE("freeze", "[Allocator]")
+{
+  Allocator alloc;
+  alloc.disableCollector();
+  Object str(alloc.makeRoot<Lisp::String>("str"));
+  Object arr(alloc.makeRoot<Array>());
+  Object lst(alloc.makeRoot<Cons>(Cell(alloc.make<Cons>(str, Lisp::nil)),
+                                  Cell(alloc.make<Cons>(arr, Lisp::nil))));
+  arr.as<Array>()->append(Cell(alloc.make<Cons>(str, str)));
+  REQUIRE(alloc.numCollectible() == 5u);
+  alloc.freeze(lst);
+  REQUIRE(alloc.numFrozenCollectible() == 5u);
+  REQUIRE(alloc.numCollectible() == 0u);
+  REQUIRE(lst.isFrozen());
+  REQUIRE(arr.isFrozen());
+  REQUIRE(lst.as<Cons>()->getCarCell().isFrozen());
+  REQUIRE(str.as<Lisp::String>()->isShared());
+
+  // mutators fail fast
+  REQUIRE_THROWS_AS(lst.as<Cons>()->setCar(Lisp::nil), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(lst.as<Cons>()->setCdr(Lisp::nil), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(arr.as<Array>()->set(0, Lisp::nil), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(arr.as<Array>()->append(Lisp::nil), Lisp::FrozenObject);
+
+  // rooting is not tracked
+  std::size_t refCount = lst.getRefCount();
+  {
+    Object copy(lst);
+    Object assigned;
+    assigned = lst;
+    REQUIRE(lst.getRefCount() == refCount);
+  }
+  REQUIRE(lst.getRefCount() == refCount);
+
+  // never collected
+  lst = Lisp::nil;
+  arr = Lisp::nil;
+  alloc.cycle();
+  REQUIRE(alloc.numFrozenCollectible() == 5u);
+  REQUIRE(alloc.numCollectible() == 0u);
+  REQUIRE(alloc.checkSanity());
+}
+
+TEST_CASE("freeze_shared", "[Allocator]")
+{
+  Allocator alloc1;
+  Object frozen(alloc1.makeRoot<Cons>(Cell(1), Lisp::nil));
+  alloc1.freeze(frozen);
+  {
+    Allocator alloc2;
+    Object obj(alloc2.makeRoot<Cons>(frozen, Lisp::nil));
+    Object arr(alloc2.makeRoot<Array>(frozen));
+    // a frozen subgraph is never scanned by the other allocator
+    alloc2.cycle();
+    REQUIRE(alloc2.numCollectible() == 2u);
+    REQUIRE(alloc2.numFrozenCollectible() == 0u);
+    REQUIRE(alloc2.checkSanity());
+    obj = Lisp::nil;
+    arr = Lisp::nil;
+    alloc2.cycle();
+    REQUIRE(alloc2.numCollectible() == 0u);
+  }
+  REQUIRE(frozen.as<Cons>()->getCarCell().as<Lisp::UIntegerType>() == 1u);
+  REQUIRE(alloc1.numFrozenCollectible() == 1u);
+}
+
 //////////////////////////////////////////////////////////
 /// implementation
 //////////////////////////////////////////////////////////
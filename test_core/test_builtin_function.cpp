@@ -30,29 +30,80 @@ either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #include <catch.hpp>
 #include <lpp/core/vm.h>
+#include <lpp/core/exception.h>
 #include <lpp/core/types/lisp_builtin_function.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/cons.h>
 #include <lpp/core/object.h>
 
 using BuiltinFunction = Lisp::BuiltinFunction;
 using Vm = Lisp::Vm;
 using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using Cons = Lisp::Cons;
+using Allocator = Lisp::Allocator;
+using UIntegerType = Lisp::UIntegerType;
+using BooleanType = Lisp::BooleanType;
+using NonMatchingArguments = Lisp::NonMatchingArguments;
+using NotAnInteger = Lisp::NotAnInteger;
 
-TEST_CASE("compile_builtin_function", "[BuiltinFunction]")
+TEST_CASE("builtin_function_call", "[BuiltinFunction]")
 {
-  //Vm vm;
-  //auto code = vm.list(Object(new BuiltinFunction([](Vm &){})),
-  //Object(1),
-  //Object(2),
-  //Object(3));
-  //auto program = vm.compile(code);
-  //vm.eval(program);
-  //REQUIRE(vm.value().isA<Integer>());
-  //REQUIRE(vm.value().as<Integer>(), 6);
-  //vm.push(1);
-  //vm.push(2);
-  //vm.push(3);
-  //vm.push(3);
-  //vm.push
-  //REQUIRE(cell.isA<ManagedType>());
-  //REQUIRE(cell.isA<String>());
+  Vm vm;
+  vm.define("sum3", vm.make<BuiltinFunction>(
+                "sum3",
+                [](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return Object(Cell(args[0].as<UIntegerType>() +
+                                     args[1].as<UIntegerType>() +
+                                     args[2].as<UIntegerType>()));
+                },
+                3));
+  REQUIRE(vm.find("sum3").isA<BuiltinFunction>());
+  // (sum3 1 2 3)
+  Object func = vm.make<Function>();
+  func.as<Function>()->addPUSHL(vm.make<Symbol>("sum3"));
+  func.as<Function>()->addPUSHV(Cell(1u));
+  func.as<Function>()->addPUSHV(Cell(2u));
+  func.as<Function>()->addPUSHV(Cell(3u));
+  func.as<Function>()->addFUNCALL(3);
+  Object res = vm.eval(func);
+  REQUIRE(res.isA<UIntegerType>());
+  REQUIRE(res.as<UIntegerType>() == 6u);
+
+  // (sum3 1 2)
+  Object func2 = vm.make<Function>();
+  func2.as<Function>()->addPUSHL(vm.make<Symbol>("sum3"));
+  func2.as<Function>()->addPUSHV(Cell(1u));
+  func2.as<Function>()->addPUSHV(Cell(2u));
+  func2.as<Function>()->addFUNCALL(2);
+  REQUIRE_THROWS_AS(vm.eval(func2), NonMatchingArguments);
+}
+
+TEST_CASE("builtin_function_predefined", "[BuiltinFunction]")
+{
+  Vm vm;
+  REQUIRE(vm.find("car").isA<BuiltinFunction>());
+  REQUIRE(vm.find("cdr").isA<BuiltinFunction>());
+  REQUIRE(vm.find("cons").isA<BuiltinFunction>());
+  REQUIRE(vm.find("eq?").isA<BuiltinFunction>());
+  REQUIRE(vm.find("+").isA<BuiltinFunction>());
+  REQUIRE(vm.find("-").isA<BuiltinFunction>());
+  REQUIRE(vm.find("<").isA<BuiltinFunction>());
+  Allocator & alloc = *vm.getAllocator();
+  Cell args[3] = { Cell(5u), Cell(3u), Cell(1u) };
+  Object res = vm.find("-").as<BuiltinFunction>()->call(alloc, args, 3);
+  REQUIRE(res.as<UIntegerType>() == 1u);
+  res = vm.find("<").as<BuiltinFunction>()->call(alloc, args, 3);
+  REQUIRE(res.isA<BooleanType>());
+  REQUIRE_FALSE(res.as<BooleanType>());
+  res = vm.find("cons").as<BuiltinFunction>()->call(alloc, args, 2);
+  REQUIRE(res.isA<Cons>());
+  REQUIRE(res.as<Cons>()->getCarCell().as<UIntegerType>() == 5u);
+  REQUIRE_THROWS_AS(vm.find("car").as<BuiltinFunction>()->call(alloc, args, 2),
+                    NonMatchingArguments);
+  REQUIRE_THROWS_AS(vm.find("+").as<BuiltinFunction>()->call(alloc, &res, 1),
+                    NotAnInteger);
 }
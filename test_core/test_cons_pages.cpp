@@ -98,3 +98,24 @@ TEST_CASE("cons_pages_life_time", "[ConsPages]")
   REQUIRE(pages.getNumVoid() == 3u);
 }
 
+
+TEST_CASE("cons_pages_reserve", "[ConsPages]")
+{
+  ConsPages pages(4);
+  BasicCons * cons1 = pages.next();
+  pages.reserve(10);
+  // the reserved pages are used when the current page is full
+  REQUIRE(pages.getNumAllocated() == 4u);
+  std::vector<BasicCons*> conses({cons1});
+  for(std::size_t i = 0; i < 10; i++)
+  {
+    conses.push_back(pages.next());
+  }
+  REQUIRE(pages.getNumAllocated() == 12u);
+  REQUIRE(pages.getNumVoid() == 1u);
+  REQUIRE(testRandomAccessIterator(conses, pages.cbegin(), pages.cend()));
+  // nothing to reserve
+  pages.reserve(1);
+  pages.next();
+  REQUIRE(pages.getNumAllocated() == 12u);
+}
@@ -70,3 +70,76 @@ TEST_CASE("env_make_reference", "[Env]")
   REQUIRE(env.find(a).isA<UIntegerType>());
   REQUIRE(env.find(a).as<UIntegerType>() == 2);
 }
+
+TEST_CASE("env_version", "[Env]")
+{
+  Allocator alloc;
+  Env env1;
+  Env env2;
+  REQUIRE(env1.getVersion() != env2.getVersion());
+  Object a(alloc.makeRoot<Symbol>("a"));
+  Object b(alloc.makeRoot<Symbol>("b"));
+  std::size_t version = env1.getVersion();
+  env1.set(a, Object(1));
+  REQUIRE(env1.getVersion() != version);
+  version = env1.getVersion();
+  // modifying a binding keeps the version
+  env1.set(a, Object(2));
+  REQUIRE(env1.getVersion() == version);
+  env1.define(b, Object(3));
+  REQUIRE(env1.getVersion() != version);
+  version = env1.getVersion();
+  REQUIRE(env1.unset(b.as<Symbol>()));
+  REQUIRE(env1.getVersion() != version);
+  version = env1.getVersion();
+  REQUIRE_FALSE(env1.unset(b.as<Symbol>()));
+  REQUIRE(env1.getVersion() == version);
+}
+
+TEST_CASE("env_inline_cache", "[Env]")
+{
+  Allocator alloc;
+  Env env1;
+  Env env2;
+  Lisp::InlineCache cache;
+  Object a(alloc.makeRoot<Symbol>("a"));
+  REQUIRE(cache.find(env1, a).isA<Undefined>());
+  env1.set(a, Object(1));
+  REQUIRE(cache.find(env1, a).as<UIntegerType>() == 1);
+  env1.set(a, Object(2));
+  REQUIRE(cache.find(env1, a).as<UIntegerType>() == 2);
+  env2.set(a, Object(3));
+  REQUIRE(cache.find(env2, a).as<UIntegerType>() == 3);
+  REQUIRE(cache.find(env1, a).as<UIntegerType>() == 2);
+  env1.unset(a.as<Symbol>());
+  REQUIRE(cache.find(env1, a).isA<Undefined>());
+}
+
+TEST_CASE("env_symbol_ids", "[Env]")
+{
+  Allocator alloc;
+  Env env;
+  Object a(alloc.makeRoot<Symbol>("a"));
+  std::size_t idB;
+  {
+    Object b(alloc.makeRoot<Symbol>("b"));
+    REQUIRE(a.as<Symbol>()->getId() != b.as<Symbol>()->getId());
+    idB = b.as<Symbol>()->getId();
+  }
+  // ids are recycled
+  Object c(alloc.makeRoot<Symbol>("c"));
+  REQUIRE(c.as<Symbol>()->getId() == idB);
+  REQUIRE(env.find(c).isA<Undefined>());
+  env.set(c, Object(1));
+  env.set(a, Object(2));
+  REQUIRE(env.find(c).as<UIntegerType>() == 1);
+  REQUIRE(env.find(a).as<UIntegerType>() == 2);
+  // the env keeps the symbol and its id alive
+  std::size_t idC = c.as<Symbol>()->getId();
+  c = Lisp::nil;
+  Object d(alloc.makeRoot<Symbol>("d"));
+  REQUIRE(d.as<Symbol>()->getId() != idC);
+  REQUIRE(env.find(d).isA<Undefined>());
+  Object c2(alloc.makeRoot<Symbol>("c"));
+  REQUIRE(env.find(c2).as<UIntegerType>() == 1);
+}
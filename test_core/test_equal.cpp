@@ -0,0 +1,176 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <unordered_map>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/equal.h>
+#include <lpp/core/types/string.h>
+
+using Vm = Lisp::Vm;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Cons = Lisp::Cons;
+using String = Lisp::String;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+
+TEST_CASE("equal_atoms", "[Equal]")
+{
+  Vm vm;
+  REQUIRE(Lisp::equal(Lisp::nil, Lisp::nil));
+  REQUIRE(Lisp::equal(Object(1), Object(1)));
+  REQUIRE_FALSE(Lisp::equal(Object(1), Object(2)));
+  REQUIRE_FALSE(Lisp::equal(Object(1), Lisp::nil));
+  REQUIRE(Lisp::equal(vm.make<Symbol>("a"), vm.make<Symbol>("a")));
+  REQUIRE_FALSE(Lisp::equal(vm.make<Symbol>("a"), vm.make<Symbol>("b")));
+  REQUIRE(Lisp::equal(vm.make<String>("abc"), vm.make<String>("abc")));
+  REQUIRE_FALSE(Lisp::equal(vm.make<String>("abc"), vm.make<String>("abd")));
+  REQUIRE(Lisp::equalHash(vm.make<String>("abc")) == Lisp::equalHash(vm.make<String>("abc")));
+  REQUIRE(Lisp::equalHash(Object(1)) == Lisp::equalHash(Object(1)));
+}
+
+TEST_CASE("equal_lists", "[Equal]")
+{
+  Vm vm;
+  Object a = vm.list(Object(1), vm.list(Object(2), vm.make<String>("x")), Object(3));
+  Object b = vm.list(Object(1), vm.list(Object(2), vm.make<String>("x")), Object(3));
+  Object c = vm.list(Object(1), vm.list(Object(2), vm.make<String>("y")), Object(3));
+  REQUIRE_FALSE(a == b);
+  REQUIRE(Lisp::equal(a, b));
+  REQUIRE_FALSE(Lisp::equal(a, c));
+  REQUIRE(Lisp::equalHash(a) == Lisp::equalHash(b));
+  REQUIRE(Lisp::equal(vm.array(Object(1), a), vm.array(Object(1), b)));
+  REQUIRE_FALSE(Lisp::equal(vm.array(Object(1), a), vm.array(Object(1))));
+  REQUIRE(Lisp::equalHash(vm.array(Object(1), a)) == Lisp::equalHash(vm.array(Object(1), b)));
+}
+
+TEST_CASE("equal_long_lists", "[Equal]")
+{
+  Vm vm;
+  auto alloc = vm.getAllocator();
+  alloc->disableCollector();
+  Cell ca = Lisp::nil;
+  Cell cb = Lisp::nil;
+  for(std::size_t i = 0; i < 100000; i++)
+  {
+    ca = Cell(alloc->make<Cons>(Cell(i), ca));
+    cb = Cell(alloc->make<Cons>(Cell(i), cb));
+  }
+  Object a(ca);
+  Object b(cb);
+  alloc->enableCollector();
+  REQUIRE(Lisp::equal(a, b));
+  REQUIRE(Lisp::equalHash(a) == Lisp::equalHash(b));
+  b.as<Cons>()->setCar(Object(1));
+  REQUIRE_FALSE(Lisp::equal(a, b));
+}
+
+TEST_CASE("equal_cyclic", "[Equal]")
+{
+  // a = (1 . a), b = (1 1 . b)
+  Vm vm;
+  Object a = vm.make<Cons>(Object(1), Lisp::nil);
+  a.as<Cons>()->setCdr(a);
+  Object b = vm.make<Cons>(Object(1), vm.make<Cons>(Object(1), Lisp::nil));
+  b.as<Cons>()->getCdrCell().as<Cons>()->setCdr(b);
+  REQUIRE(Lisp::equal(a, b));
+  REQUIRE(Lisp::equalHash(a) == Lisp::equalHash(b));
+  Object c = vm.make<Cons>(Object(2), Lisp::nil);
+  c.as<Cons>()->setCdr(c);
+  REQUIRE_FALSE(Lisp::equal(a, c));
+}
+
+TEST_CASE("equal_hash_common_prefix", "[Equal]")
+{
+  Vm vm;
+  Object a = vm.list(Object(1));
+  Object b = vm.list(Object(2));
+  for(std::size_t i = 0; i < 1000; i++)
+  {
+    a = vm.make<Cons>(Object(i), a);
+    b = vm.make<Cons>(Object(i), b);
+  }
+  REQUIRE(Lisp::equalHash(a) != Lisp::equalHash(b));
+  REQUIRE(Lisp::equalHash(vm.array(a)) != Lisp::equalHash(vm.array(b)));
+}
+
+TEST_CASE("equal_hash_frozen", "[Equal]")
+{
+  Vm vm;
+  auto alloc = vm.getAllocator();
+  Object shared = vm.list(Object(1), vm.make<String>("x"));
+  Object a = vm.array(shared, shared);
+  Object b = vm.array(vm.list(Object(1), vm.make<String>("x")),
+                      vm.list(Object(1), vm.make<String>("x")));
+  Object c = Lisp::nil;
+  Object d = Lisp::nil;
+  for(std::size_t i = 0; i < 10000; i++)
+  {
+    c = vm.make<Cons>(a, c);
+    d = vm.make<Cons>(b, d);
+  }
+  std::size_t h = Lisp::equalHash(c);
+  alloc->freeze(c);
+  REQUIRE(c.as<Cons>()->isFrozen());
+  REQUIRE(Lisp::equalHash(c) == h);
+  REQUIRE(Lisp::equalHash(d) == h);
+  REQUIRE(Lisp::equalHash(a) == Lisp::equalHash(b));
+  REQUIRE(Lisp::equalHash(vm.list(Object(0), c)) == Lisp::equalHash(vm.list(Object(0), d)));
+}
+
+TEST_CASE("equal_hash_frozen_cyclic", "[Equal]")
+{
+  // a = (1 . a), b = (1 1 . b), c = (0 . a)
+  Vm vm;
+  auto alloc = vm.getAllocator();
+  Object a = vm.make<Cons>(Object(1), Lisp::nil);
+  a.as<Cons>()->setCdr(a);
+  Object b = vm.make<Cons>(Object(1), vm.make<Cons>(Object(1), Lisp::nil));
+  b.as<Cons>()->getCdrCell().as<Cons>()->setCdr(b);
+  Object c = vm.make<Cons>(Object(0), a);
+  alloc->freeze(c);
+  REQUIRE(a.as<Cons>()->isFrozen());
+  REQUIRE(Lisp::equalHash(a) == Lisp::equalHash(b));
+  REQUIRE(Lisp::equalHash(c) == Lisp::equalHash(vm.make<Cons>(Object(0), b)));
+  REQUIRE(Lisp::equalHash(vm.list(c)) == Lisp::equalHash(vm.list(vm.make<Cons>(Object(0), b))));
+}
+
+TEST_CASE("equal_hash_table", "[Equal]")
+{
+  Vm vm;
+  std::unordered_map<Object, Object, Lisp::EqualHash, Lisp::EqualTo> table;
+  table[vm.list(Object(1), Object(2))] = Object(12);
+  table[vm.list(Object(1), Object(3))] = Object(13);
+  REQUIRE(table.size() == 2u);
+  REQUIRE(table.find(vm.list(Object(1), Object(2))) != table.end());
+  REQUIRE(table.find(vm.list(Object(1), Object(2)))->second.as<UIntegerType>() == 12u);
+  REQUIRE(table.find(vm.list(Object(1), Object(4))) == table.end());
+}
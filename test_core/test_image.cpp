@@ -0,0 +1,326 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/env.h>
+#include <lpp/core/image.h>
+#include <lpp/core/opcode.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/equal.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/array.h>
+#include <lpp/core/types/closure.h>
+#include <lpp/core/types/continuation.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/string.h>
+
+using Vm = Lisp::Vm;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Array = Lisp::Array;
+using Closure = Lisp::Closure;
+using Continuation = Lisp::Continuation;
+using BuiltinFunction = Lisp::BuiltinFunction;
+using Cons = Lisp::Cons;
+using Symbol = Lisp::Symbol;
+using String = Lisp::String;
+using UIntegerType = Lisp::UIntegerType;
+using InvalidImage = Lisp::InvalidImage;
+using NotSerializable = Lisp::NotSerializable;
+
+namespace
+{
+  // (define g (lambda (a #!optional b . r) r))
+  // (g 1 2 3 4)
+  std::vector<Cell> program(Vm & vm)
+  {
+    Object g = vm.make<Function>();
+    g.as<Function>()->addArgument(vm.make<Symbol>("a"));
+    g.as<Function>()->addOptionalArgument(vm.make<Symbol>("b"));
+    g.as<Function>()->addRestArgument(vm.make<Symbol>("r"));
+    g.as<Function>()->addPUSHR(2);
+    g.as<Function>()->setName("g");
+    Object define = vm.make<Function>();
+    define.as<Function>()->addPUSHV(g);
+    define.as<Function>()->addDEFINES(vm.make<Symbol>("g"));
+    Object call = vm.make<Function>();
+    call.as<Function>()->addPUSHL(vm.make<Symbol>("g"));
+    for(UIntegerType i = 1; i <= 4; i++)
+    {
+      call.as<Function>()->addPUSHV(Cell(i));
+    }
+    call.as<Function>()->addFUNCALL(4);
+    return {define, call};
+  }
+}
+
+TEST_CASE("image_round_trip", "[Image]")
+{
+  std::stringstream ss;
+  {
+    Vm vm;
+    Lisp::writeImage(ss, program(vm));
+  }
+  std::string image(ss.str());
+  Vm vm;
+  std::vector<Object> functions(Lisp::readImage(image.data(), image.size(),
+                                                *vm.getAllocator()));
+  REQUIRE(functions.size() == 2u);
+  vm.eval(functions[0]);
+  Function * g = vm.find("g").as<Function>();
+  REQUIRE(g->getName() == "g");
+  REQUIRE(g->numArguments() == 3u);
+  REQUIRE(g->numOptionalArguments() == 1u);
+  REQUIRE(g->hasRestArgument());
+  // the symbols are interned by the allocator of vm
+  REQUIRE(g->atCell(0).as<Symbol>() == vm.make<Symbol>("a").as<Symbol>());
+  REQUIRE(Lisp::equal(vm.eval(functions[1]), vm.list(Object(3), Object(4))));
+}
+
+TEST_CASE("image_shared_structure", "[Image]")
+{
+  std::stringstream ss;
+  {
+    Vm vm;
+    // an array that contains itself and a list referenced twice
+    Object arr = vm.make<Array>();
+    Object lst = vm.list(Object(1), vm.make<String>("abc"), Object::boolean(true));
+    arr.as<Array>()->append(arr);
+    arr.as<Array>()->append(lst);
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHV(lst);
+    func.as<Function>()->addPUSHV(arr);
+    func.as<Function>()->addPrimitive(Lisp::CONS, 2);
+    Lisp::writeImage(ss, {func});
+  }
+  std::string image(ss.str());
+  Vm vm;
+  std::vector<Object> functions(Lisp::readImage(image.data(), image.size(),
+                                                *vm.getAllocator()));
+  REQUIRE(functions.size() == 1u);
+  Object res = vm.eval(functions[0]);
+  const Cell & lst = res.as<Cons>()->getCarCell();
+  Array * arr = res.as<Cons>()->getCdrCell().as<Array>();
+  REQUIRE(arr->atCell(0).as<Array>() == arr);
+  REQUIRE(arr->atCell(1).as<Cons>() == lst.as<Cons>());
+  REQUIRE(Lisp::equal(lst, vm.list(Object(1),
+                                   vm.make<String>("abc"),
+                                   Object::boolean(true))));
+}
+
+TEST_CASE("image_load_file", "[Image]")
+{
+  std::string path("/tmp/lpp_test_image_" + std::to_string(getpid()));
+  {
+    Vm vm;
+    Lisp::saveImage(path, program(vm));
+  }
+  Vm vm;
+  std::vector<Object> functions(Lisp::loadImage(path, *vm.getAllocator()));
+  std::remove(path.c_str());
+  REQUIRE(functions.size() == 2u);
+  vm.eval(functions[0]);
+  REQUIRE(Lisp::equal(vm.eval(functions[1]), vm.list(Object(3), Object(4))));
+  REQUIRE_THROWS_AS(Lisp::loadImage(path, *vm.getAllocator()), InvalidImage);
+}
+
+TEST_CASE("image_errors", "[Image]")
+{
+  Vm vm;
+  std::stringstream ss;
+  Lisp::writeImage(ss, program(vm));
+  std::string image(ss.str());
+  // truncated image
+  for(std::size_t n = 0; n < image.size(); n += 7)
+  {
+    REQUIRE_THROWS_AS(Lisp::readImage(image.data(), n, *vm.getAllocator()),
+                      InvalidImage);
+  }
+  // number of roots out of range
+  {
+    std::string corrupt(image);
+    std::memset(&corrupt[20], 0xff, 4);
+    REQUIRE_THROWS_AS(Lisp::readImage(corrupt.data(), corrupt.size(),
+                                      *vm.getAllocator()),
+                      InvalidImage);
+  }
+  // bad magic
+  image[0] = 'X';
+  REQUIRE_THROWS_AS(Lisp::readImage(image.data(), image.size(), *vm.getAllocator()),
+                    InvalidImage);
+  // builtins are not stored in images
+  Object func = vm.make<Function>();
+  func.as<Function>()->addPUSHV(vm.find("car"));
+  REQUIRE_THROWS_AS(Lisp::writeImage(ss, {func}), NotSerializable);
+  // closures are only stored in heap images
+  Object inner = vm.make<Function>();
+  inner.as<Function>()->setNumCaptured(1);
+  Cell captured[] = { Cell(1u) };
+  Object withClosure = vm.make<Function>();
+  withClosure.as<Function>()->addPUSHV(vm.make<Closure>(inner, captured, 1));
+  REQUIRE_THROWS_AS(Lisp::writeImage(ss, {withClosure}), NotSerializable);
+}
+
+TEST_CASE("heap_image_round_trip", "[Image]")
+{
+  std::stringstream ss;
+  {
+    Vm vm;
+    // (define lst '(1 "abc" #t))
+    // (define same lst)
+    // (define first car)
+    // (define f <closure capturing lst>)
+    Object lst = vm.list(Object(1), vm.make<String>("abc"), Object::boolean(true));
+    vm.define("lst", lst);
+    vm.define("same", lst);
+    vm.define("first", vm.find("car"));
+    Object func = vm.make<Function>();
+    func.as<Function>()->setNumCaptured(1);
+    Cell captured[] = { lst };
+    vm.define("f", vm.make<Closure>(func, captured, 1));
+    Lisp::writeHeapImage(ss, *vm.getEnv(), {vm.make<Symbol>("root"), func});
+  }
+  std::string image(ss.str());
+  Vm vm;
+  std::vector<Object> roots(Lisp::readHeapImage(image.data(), image.size(),
+                                                *vm.getAllocator(),
+                                                *vm.getEnv()));
+  REQUIRE(roots.size() == 2u);
+  REQUIRE(roots[0].as<Symbol>() == vm.make<Symbol>("root").as<Symbol>());
+  Object lst = vm.find("lst");
+  REQUIRE(Lisp::equal(lst, vm.list(Object(1),
+                                   vm.make<String>("abc"),
+                                   Object::boolean(true))));
+  REQUIRE(vm.find("same").as<Cons>() == lst.as<Cons>());
+  REQUIRE(vm.find("first").as<BuiltinFunction>() ==
+          vm.find("car").as<BuiltinFunction>());
+  Closure * f = vm.find("f").as<Closure>();
+  REQUIRE(f->getFunction() == roots[1].as<Function>());
+  REQUIRE(f->numCaptured() == 1u);
+  REQUIRE(f->getCaptured(0).as<Cons>() == lst.as<Cons>());
+  // the restored objects are collected like any other object
+  REQUIRE(vm.getAllocator()->checkSanity());
+  vm.getAllocator()->cycle();
+  vm.getAllocator()->cycle();
+  REQUIRE(vm.getAllocator()->checkSanity());
+  REQUIRE(Lisp::equal(vm.find("lst"), vm.list(Object(1),
+                                              vm.make<String>("abc"),
+                                              Object::boolean(true))));
+}
+
+TEST_CASE("heap_image_load_file", "[Image]")
+{
+  std::string path("/tmp/lpp_test_heap_image_" + std::to_string(getpid()));
+  {
+    Vm vm;
+    std::vector<Cell> functions(program(vm));
+    vm.eval(Object(functions[0]));
+    Lisp::saveHeapImage(path, *vm.getEnv());
+  }
+  Vm vm;
+  std::vector<Object> roots(Lisp::loadHeapImage(path, *vm.getAllocator(),
+                                                *vm.getEnv()));
+  std::remove(path.c_str());
+  REQUIRE(roots.empty());
+  Object call = vm.make<Function>();
+  call.as<Function>()->addPUSHL(vm.make<Symbol>("g"));
+  call.as<Function>()->addPUSHV(Cell(UIntegerType(1)));
+  call.as<Function>()->addFUNCALL(1);
+  REQUIRE(vm.eval(call).isA<Lisp::Nil>());
+}
+
+TEST_CASE("heap_image_errors", "[Image]")
+{
+  Vm vm;
+  vm.define("x", Object(1));
+  std::stringstream ss;
+  Lisp::writeHeapImage(ss, *vm.getEnv());
+  std::string image(ss.str());
+  // truncated images do not modify the environment
+  Vm target;
+  for(std::size_t n = 0; n < image.size(); n += 3)
+  {
+    REQUIRE_THROWS_AS(Lisp::readHeapImage(image.data(), n,
+                                          *target.getAllocator(),
+                                          *target.getEnv()),
+                      InvalidImage);
+  }
+  REQUIRE(target.find("x").isA<Lisp::Undefined>());
+  // number of bindings out of range
+  {
+    std::string corrupt(image);
+    std::memset(&corrupt[24], 0xff, 4);
+    REQUIRE_THROWS_AS(Lisp::readHeapImage(corrupt.data(), corrupt.size(),
+                                          *target.getAllocator(),
+                                          *target.getEnv()),
+                      InvalidImage);
+  }
+  // code images are not heap images and vice versa
+  std::stringstream code;
+  Lisp::writeImage(code, program(vm));
+  std::string codeImage(code.str());
+  REQUIRE_THROWS_AS(Lisp::readHeapImage(codeImage.data(), codeImage.size(),
+                                        *target.getAllocator(),
+                                        *target.getEnv()),
+                    InvalidImage);
+  REQUIRE_THROWS_AS(Lisp::readImage(image.data(), image.size(),
+                                    *target.getAllocator()),
+                    InvalidImage);
+  // the size of a closure has to match its function
+  {
+    Vm source;
+    Object func = source.make<Function>();
+    func.as<Function>()->setNumCaptured(2);
+    Cell captured[] = { Cell(1u) };
+    source.define("f", source.make<Closure>(func, captured, 1));
+    std::stringstream closure;
+    Lisp::writeHeapImage(closure, *source.getEnv());
+    std::string closureImage(closure.str());
+    REQUIRE_THROWS_AS(Lisp::readHeapImage(closureImage.data(), closureImage.size(),
+                                          *target.getAllocator(),
+                                          *target.getEnv()),
+                      InvalidImage);
+    REQUIRE(target.find("f").isA<Lisp::Undefined>());
+  }
+  // continuations are not stored
+  Object func = vm.make<Function>();
+  vm.define("k", vm.make<Continuation>(func));
+  REQUIRE_THROWS_AS(Lisp::writeHeapImage(ss, *vm.getEnv()), NotSerializable);
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <sstream>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/instrumentation.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+
+using Vm = Lisp::Vm;
+using Instrumentation = Lisp::Instrumentation;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+
+TEST_CASE("instrumentation_counters", "[Instrumentation]")
+{
+  Vm vm;
+  // (define inner (lambda () (+ 1 2)))
+  Object inner = vm.make<Function>();
+  inner.as<Function>()->addPUSHV(Cell(UIntegerType(1)));
+  inner.as<Function>()->addPUSHV(Cell(UIntegerType(2)));
+  inner.as<Function>()->addPrimitive(Lisp::ADD, 2);
+  vm.define("inner", inner);
+  // (lambda () (inner) (inner))
+  Object outer = vm.make<Function>();
+  outer.as<Function>()->addPUSHL(vm.make<Symbol>("inner"));
+  outer.as<Function>()->addFUNCALL(0);
+  outer.as<Function>()->addPUSHL(vm.make<Symbol>("inner"));
+  outer.as<Function>()->addFUNCALL(0);
+  REQUIRE(vm.eval(outer).as<UIntegerType>() == 3u);
+  const Instrumentation & instr = vm.getInstrumentation();
+  if(Instrumentation::enabled)
+  {
+    REQUIRE(instr.getOpcodeCounter(Lisp::PUSHL).count == 2u);
+    REQUIRE(instr.getOpcodeCounter(Lisp::FUNCALL).count == 2u);
+    REQUIRE(instr.getOpcodeCounter(Lisp::PUSHV).count == 4u);
+    REQUIRE(instr.getOpcodeCounter(Lisp::ADD).count == 2u);
+    REQUIRE(instr.getOpcodeCounter(Lisp::CAR).count == 0u);
+    REQUIRE(instr.numCalls() == 1u);
+    REQUIRE(instr.numTailCalls() == 1u);
+    REQUIRE(instr.getMaxCallDepth() == 2u);
+    REQUIRE(instr.getMaxStackSize() == 2u);
+    std::stringstream ss;
+    instr.dump(ss);
+    REQUIRE(ss.str().find("FUNCALL") != std::string::npos);
+    REQUIRE(ss.str().find("CAR") == std::string::npos);
+  }
+  else
+  {
+    REQUIRE(instr.getOpcodeCounter(Lisp::PUSHL).count == 0u);
+    REQUIRE(instr.numCalls() == 0u);
+  }
+  vm.getInstrumentation().reset();
+  REQUIRE(instr.getOpcodeCounter(Lisp::PUSHL).count == 0u);
+  REQUIRE(instr.getMaxCallDepth() == 0u);
+}
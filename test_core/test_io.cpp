@@ -0,0 +1,343 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <cerrno>
+#include <climits>
+#include <limits>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/builtins.h>
+#include <lpp/core/scheduler.h>
+#include <lpp/core/event_loop.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/string.h>
+#include <lpp/core/types/continuation.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+
+using Vm = Lisp::Vm;
+using Scheduler = Lisp::Scheduler;
+using EventLoop = Lisp::EventLoop;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using String = Lisp::String;
+using Continuation = Lisp::Continuation;
+using UIntegerType = Lisp::UIntegerType;
+using IoError = Lisp::IoError;
+using BuiltinFunction = Lisp::BuiltinFunction;
+
+namespace
+{
+  class Pipe
+  {
+  public:
+    Pipe()
+    {
+      REQUIRE(pipe(fds) == 0);
+    }
+
+    ~Pipe()
+    {
+      close(fds[0]);
+      close(fds[1]);
+    }
+
+    int in() const
+    {
+      return fds[0];
+    }
+
+    int out() const
+    {
+      return fds[1];
+    }
+
+  private:
+    int fds[2];
+  };
+
+  // (read-fd fd n)
+  Object reader(Vm & vm, UIntegerType fd, UIntegerType n)
+  {
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHL(vm.make<Symbol>("read-fd"));
+    func.as<Function>()->addPUSHV(Cell(UIntegerType(fd)));
+    func.as<Function>()->addPUSHV(Cell(n));
+    func.as<Function>()->addFUNCALL(2);
+    return func;
+  }
+
+  // (write-fd fd str)
+  void addWrite(Vm & vm, Function * func, int fd, const std::string & str)
+  {
+    func->addPUSHL(vm.make<Symbol>("write-fd"));
+    func->addPUSHV(Cell(UIntegerType(fd)));
+    func->addPUSHV(vm.make<String>(str));
+    func->addFUNCALL(2);
+  }
+
+  std::string str(const Cell & cell)
+  {
+    return cell.as<String>()->getCString();
+  }
+}
+
+TEST_CASE("event_loop_wait", "[IO]")
+{
+  Pipe p;
+  EventLoop loop;
+  std::vector<int> trace;
+  loop.wait(p.in(), EventLoop::Readable, [&trace]() { trace.push_back(1); });
+  loop.wait(p.in(), EventLoop::Readable, [&trace]() { trace.push_back(2); });
+  loop.wait(p.out(), EventLoop::Writable, [&trace]() { trace.push_back(3); });
+  REQUIRE(loop.size() == 3u);
+  REQUIRE(loop.poll(0) == 1u);
+  REQUIRE(trace == std::vector<int>({3}));
+  REQUIRE(write(p.out(), "x", 1) == 1);
+  // one callback per descriptor and event in each poll
+  REQUIRE(loop.poll() == 1u);
+  REQUIRE(loop.poll() == 1u);
+  REQUIRE(trace == std::vector<int>({3, 1, 2}));
+  REQUIRE(loop.size() == 0u);
+  REQUIRE(loop.poll() == 0u);
+  // forget calls the waiting callbacks
+  Pipe q;
+  loop.wait(q.in(), EventLoop::Readable, [&trace]() { trace.push_back(4); });
+  loop.forget(q.in());
+  REQUIRE(loop.size() == 1u);
+  REQUIRE(loop.poll() == 1u);
+  REQUIRE(trace == std::vector<int>({3, 1, 2, 4}));
+}
+
+TEST_CASE("io_opt_in", "[IO]")
+{
+  // the I/O builtins are only bound on request
+  Vm vm;
+  REQUIRE_FALSE(vm.find("read-fd").isA<BuiltinFunction>());
+  REQUIRE_FALSE(vm.find("write-fd").isA<BuiltinFunction>());
+  REQUIRE_FALSE(vm.find("close-fd").isA<BuiltinFunction>());
+  Lisp::Builtin::defineIo(vm);
+  REQUIRE(vm.find("read-fd").isA<BuiltinFunction>());
+  REQUIRE(vm.find("write-fd").isA<BuiltinFunction>());
+  REQUIRE(vm.find("close-fd").isA<BuiltinFunction>());
+}
+
+TEST_CASE("io_blocking_without_scheduler", "[IO]")
+{
+  Vm vm;
+  Lisp::Builtin::defineIo(vm);
+  Pipe p;
+  Object func = vm.make<Function>();
+  addWrite(vm, func.as<Function>(), p.out(), "abc");
+  REQUIRE(vm.eval(func).as<UIntegerType>() == 3u);
+  REQUIRE(str(vm.eval(reader(vm, p.in(), 2))) == "ab");
+  REQUIRE(str(vm.eval(reader(vm, p.in(), 10))) == "c");
+  REQUIRE(str(vm.eval(reader(vm, p.in(), 0))) == "");
+  // (close-fd fd) twice
+  Pipe q;
+  Object closeFd = vm.make<Function>();
+  closeFd.as<Function>()->addPUSHL(vm.make<Symbol>("close-fd"));
+  closeFd.as<Function>()->addPUSHV(Cell(UIntegerType(dup(q.out()))));
+  closeFd.as<Function>()->addFUNCALL(1);
+  vm.eval(closeFd);
+  REQUIRE_THROWS_AS(vm.eval(closeFd), IoError);
+}
+
+TEST_CASE("io_limits", "[IO]")
+{
+  Vm vm;
+  Lisp::Builtin::defineIo(vm);
+  Pipe p;
+  Object func = vm.make<Function>();
+  addWrite(vm, func.as<Function>(), p.out(), "abc");
+  REQUIRE(vm.eval(func).as<UIntegerType>() == 3u);
+  // the buffer is limited to maxReadSize bytes
+  REQUIRE(str(vm.eval(reader(vm, p.in(),
+                             std::numeric_limits<UIntegerType>::max()))) == "abc");
+  // descriptors are not truncated to int
+  UIntegerType fd = (UIntegerType(1) << 32) + p.in();
+  try
+  {
+    vm.eval(reader(vm, fd, 1));
+    FAIL("read from truncated descriptor");
+  }
+  catch(const IoError & ex)
+  {
+    REQUIRE(ex.getErrorNumber() == EBADF);
+  }
+  REQUIRE_THROWS_AS(vm.eval(reader(vm, UIntegerType(INT_MAX) + 1, 1)), IoError);
+}
+
+TEST_CASE("io_end_of_file", "[IO]")
+{
+  Vm vm;
+  Lisp::Builtin::defineIo(vm);
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  close(fds[1]);
+  REQUIRE(vm.eval(reader(vm, fds[0], 10)).isA<Lisp::Nil>());
+  close(fds[0]);
+}
+
+TEST_CASE("scheduler_parks_readers", "[IO]")
+{
+  const std::size_t n = 1000;
+  Vm vm;
+  Lisp::Builtin::defineIo(vm);
+  Scheduler scheduler(vm);
+  std::vector<Pipe> pipes(n);
+  std::vector<Object> threads;
+  for(std::size_t i = 0; i < n; i++)
+  {
+    threads.push_back(scheduler.spawn(reader(vm, pipes[i].in(), 16)));
+  }
+  for(std::size_t i = 0; i < n; i++)
+  {
+    REQUIRE(scheduler.step());
+  }
+  REQUIRE(scheduler.numParked() == n);
+  REQUIRE(scheduler.size() == n);
+  for(std::size_t i = n; i-- > 0; )
+  {
+    std::string msg(std::to_string(i));
+    REQUIRE(write(pipes[i].out(), msg.data(), msg.size()) == ssize_t(msg.size()));
+  }
+  scheduler.run();
+  REQUIRE(scheduler.size() == 0u);
+  REQUIRE(scheduler.numParked() == 0u);
+  for(std::size_t i = 0; i < n; i++)
+  {
+    REQUIRE(threads[i].as<Continuation>()->isFinished());
+    REQUIRE(str(threads[i].as<Continuation>()->eval()) == std::to_string(i));
+  }
+}
+
+TEST_CASE("scheduler_socket_ping_pong", "[IO]")
+{
+  Vm vm;
+  Lisp::Builtin::defineIo(vm);
+  Scheduler scheduler(vm);
+  int sv[2];
+  REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+  // (write-fd s0 "ping") (read-fd s0 16)
+  Object client = vm.make<Function>();
+  addWrite(vm, client.as<Function>(), sv[0], "ping");
+  client.as<Function>()->addPUSHL(vm.make<Symbol>("read-fd"));
+  client.as<Function>()->addPUSHV(Cell(UIntegerType(sv[0])));
+  client.as<Function>()->addPUSHV(Cell(UIntegerType(16)));
+  client.as<Function>()->addFUNCALL(2);
+  // (write-fd s1 (read-fd s1 16))
+  Object server = vm.make<Function>();
+  server.as<Function>()->addPUSHL(vm.make<Symbol>("write-fd"));
+  server.as<Function>()->addPUSHV(Cell(UIntegerType(sv[1])));
+  server.as<Function>()->addPUSHL(vm.make<Symbol>("read-fd"));
+  server.as<Function>()->addPUSHV(Cell(UIntegerType(sv[1])));
+  server.as<Function>()->addPUSHV(Cell(UIntegerType(16)));
+  server.as<Function>()->addFUNCALL(2);
+  server.as<Function>()->addFUNCALL(2);
+  // the server waits before the client has written
+  Object s = scheduler.spawn(server);
+  Object c = scheduler.spawn(client);
+  scheduler.run();
+  REQUIRE(s.as<Continuation>()->eval().as<UIntegerType>() == 4u);
+  REQUIRE(str(c.as<Continuation>()->eval()) == "ping");
+  close(sv[0]);
+  close(sv[1]);
+}
+
+TEST_CASE("scheduler_parks_writers", "[IO]")
+{
+  Vm vm;
+  Lisp::Builtin::defineIo(vm);
+  Scheduler scheduler(vm);
+  Pipe p;
+  REQUIRE(fcntl(p.in(), F_SETFL, O_NONBLOCK) == 0);
+  // larger than the pipe buffer
+  std::string data(1 << 20, 'x');
+  Object func = vm.make<Function>();
+  addWrite(vm, func.as<Function>(), p.out(), data);
+  Object writer = scheduler.spawn(func);
+  REQUIRE(scheduler.step());
+  REQUIRE(scheduler.numParked() == 1u);
+  std::size_t received = 0;
+  while(scheduler.size())
+  {
+    char buffer[4096];
+    ssize_t r;
+    while((r = read(p.in(), buffer, sizeof(buffer))) > 0)
+    {
+      received += r;
+    }
+    scheduler.step();
+  }
+  REQUIRE(writer.as<Continuation>()->eval().as<UIntegerType>() == data.size());
+  char buffer[4096];
+  ssize_t r;
+  while((r = read(p.in(), buffer, sizeof(buffer))) > 0)
+  {
+    received += r;
+  }
+  REQUIRE(received == data.size());
+}
+
+TEST_CASE("scheduler_close_while_parked", "[IO]")
+{
+  Vm vm;
+  Lisp::Builtin::defineIo(vm);
+  Scheduler scheduler(vm);
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  // (close-fd in)
+  Object func = vm.make<Function>();
+  func.as<Function>()->addPUSHL(vm.make<Symbol>("close-fd"));
+  func.as<Function>()->addPUSHV(Cell(UIntegerType(fds[0])));
+  func.as<Function>()->addFUNCALL(1);
+  Object waiting = scheduler.spawn(reader(vm, fds[0], 16));
+  Object closing = scheduler.spawn(func);
+  REQUIRE(scheduler.step());
+  REQUIRE(scheduler.numParked() == 1u);
+  REQUIRE(scheduler.step());
+  REQUIRE(closing.as<Continuation>()->isFinished());
+  // the read fails in the green thread that waits for the descriptor
+  REQUIRE_THROWS_AS(scheduler.step(), IoError);
+  REQUIRE_FALSE(waiting.as<Continuation>()->isFinished());
+  REQUIRE(scheduler.size() == 0u);
+  REQUIRE(scheduler.numParked() == 0u);
+  REQUIRE(closing.as<Continuation>()->eval().isA<Lisp::Nil>());
+  close(fds[1]);
+}
@@ -0,0 +1,126 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <sstream>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/profiler.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+
+using Vm = Lisp::Vm;
+using Profiler = Lisp::Profiler;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+
+namespace
+{
+  // (define inner (lambda () (+ 1 2)))
+  // (define outer (lambda () (inner) (inner) (inner)))
+  Object defineFunctions(Vm & vm)
+  {
+    Object inner = vm.make<Function>();
+    inner.as<Function>()->addPUSHV(Cell(UIntegerType(1)));
+    inner.as<Function>()->addPUSHV(Cell(UIntegerType(2)));
+    inner.as<Function>()->addPrimitive(Lisp::ADD, 2);
+    inner.as<Function>()->setName("inner");
+    vm.define("inner", inner);
+    Object outer = vm.make<Function>();
+    for(int i = 0; i < 3; i++)
+    {
+      outer.as<Function>()->addPUSHL(vm.make<Symbol>("inner"));
+      outer.as<Function>()->addFUNCALL(0);
+    }
+    outer.as<Function>()->setName("outer");
+    vm.define("outer", outer);
+    return outer;
+  }
+}
+
+TEST_CASE("profiler_counting", "[Profiler]")
+{
+  Vm vm;
+  Object outer = defineFunctions(vm);
+  auto profiler = std::make_shared<Profiler>();
+  vm.setProfiler(profiler);
+  profiler->startCounting(1);
+  REQUIRE(vm.eval(outer).as<UIntegerType>() == 3u);
+  profiler->stop();
+  // entry of outer, entry of and return from inner (2x),
+  // tail call of inner
+  REQUIRE(profiler->numSamples() == 6u);
+  {
+    std::stringstream ss;
+    profiler->writeFolded(ss);
+    REQUIRE(ss.str() == "inner 1\nouter 3\nouter;inner 2\n");
+  }
+  {
+    std::stringstream ss;
+    profiler->writeFolded(ss, true);
+    REQUIRE(ss.str().find("outer+0 1\n") != std::string::npos);
+    REQUIRE(ss.str().find(";inner+0 1\n") != std::string::npos);
+  }
+  {
+    std::stringstream ss;
+    profiler->writeTop(ss, 1);
+    REQUIRE(ss.str().find("outer") != std::string::npos);
+    REQUIRE(ss.str().find("inner") == std::string::npos);
+  }
+  // no samples after stop
+  REQUIRE(vm.eval(outer).as<UIntegerType>() == 3u);
+  REQUIRE(profiler->numSamples() == 6u);
+  profiler->clear();
+  REQUIRE(profiler->numSamples() == 0u);
+  REQUIRE(profiler->getStacks().empty());
+}
+
+TEST_CASE("profiler_timer", "[Profiler]")
+{
+  Vm vm;
+  Object outer = defineFunctions(vm);
+  auto profiler = std::make_shared<Profiler>();
+  vm.setProfiler(profiler);
+  profiler->start(100);
+  for(std::size_t i = 0; i < 1000000 && profiler->numSamples() == 0; i++)
+  {
+    vm.eval(outer);
+  }
+  profiler->stop();
+  REQUIRE(profiler->numSamples() > 0u);
+  // the last call of outer is a tail call that replaces its frame
+  for(const auto & p : profiler->getStacks())
+  {
+    REQUIRE((p.first.front().function == outer.as<Function>() ||
+             p.first.front().function == vm.find("inner").as<Function>()));
+  }
+}
@@ -0,0 +1,268 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/reader.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/equal.h>
+#include <lpp/core/memory/allocator.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/string.h>
+
+using Vm = Lisp::Vm;
+using Reader = Lisp::Reader;
+using ParseError = Lisp::ParseError;
+using IoError = Lisp::IoError;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Cons = Lisp::Cons;
+using Symbol = Lisp::Symbol;
+using String = Lisp::String;
+using UIntegerType = Lisp::UIntegerType;
+
+namespace
+{
+  std::vector<Object> readString(Vm & vm, const std::string & text)
+  {
+    return Reader(*vm.getAllocator(), text.c_str(), text.size()).readAll();
+  }
+
+  std::vector<Object> readStream(Vm & vm, const std::string & text,
+                                 std::size_t chunkSize)
+  {
+    std::istringstream ist(text);
+    return Reader(*vm.getAllocator(), ist, chunkSize).readAll();
+  }
+
+  std::size_t errorOffset(Vm & vm, const std::string & text)
+  {
+    try
+    {
+      readString(vm, text);
+    }
+    catch(const ParseError & e)
+    {
+      return e.getOffset();
+    }
+    return std::string::npos;
+  }
+}
+
+TEST_CASE("reader_atoms", "[Reader]")
+{
+  Vm vm;
+  std::vector<Object> values(readString(vm, "  42 abc \"x\\\"y\\n\" #t #f\n18446744073709551615 -1"));
+  REQUIRE(values.size() == 7u);
+  REQUIRE(values[0].isA<UIntegerType>());
+  REQUIRE(values[0].as<UIntegerType>() == 42u);
+  REQUIRE(values[1].isA<Symbol>());
+  REQUIRE(values[1].as<Symbol>() == vm.make<Symbol>("abc").as<Symbol>());
+  REQUIRE(values[2].isA<String>());
+  REQUIRE(values[2].as<String>()->getCString() == "x\"y\n");
+  REQUIRE(Lisp::equal(values[3], Object::boolean(true)));
+  REQUIRE(Lisp::equal(values[4], Object::boolean(false)));
+  REQUIRE(values[5].as<UIntegerType>() == 18446744073709551615u);
+  // there are no negative integers
+  REQUIRE(values[6].isA<Symbol>());
+  REQUIRE(readString(vm, "").empty());
+  REQUIRE(readString(vm, " ; comment only").empty());
+}
+
+TEST_CASE("reader_lists", "[Reader]")
+{
+  Vm vm;
+  Object a(vm.make<Symbol>("a"));
+  Object b(vm.make<Symbol>("b"));
+  Object quote(vm.make<Symbol>("quote"));
+  std::vector<Object> values(readString(vm,
+                                        "(a (b 1) () 2) ; comment\n"
+                                        "(a . b) (a b . 1)\n"
+                                        "'a '(a 'b) ()"));
+  REQUIRE(values.size() == 6u);
+  REQUIRE(Lisp::equal(values[0], vm.list(a, vm.list(b, Object(1)), Object(Lisp::nil), Object(2))));
+  REQUIRE(Lisp::equal(values[1], vm.make<Cons>(a, b)));
+  REQUIRE(Lisp::equal(values[2], vm.make<Cons>(a, vm.make<Cons>(b, Object(1)))));
+  REQUIRE(Lisp::equal(values[3], vm.list(quote, a)));
+  REQUIRE(Lisp::equal(values[4], vm.list(quote, vm.list(a, vm.list(quote, b)))));
+  REQUIRE(values[5].isA<Lisp::Nil>());
+}
+
+TEST_CASE("reader_stream_chunks", "[Reader]")
+{
+  Vm vm;
+  std::string text("(define (f x) ; the identity\n"
+                   "  (lambda-with-a-long-name x \"a string with \\\\ escapes \\t\"))\n"
+                   "'(1 22 333 4444 . 55555) symbol-at-the-end");
+  std::vector<Object> expected(readString(vm, text));
+  REQUIRE(expected.size() == 3u);
+  for(std::size_t chunkSize = 1; chunkSize < 20; chunkSize++)
+  {
+    std::vector<Object> values(readStream(vm, text, chunkSize));
+    REQUIRE(values.size() == expected.size());
+    for(std::size_t i = 0; i < values.size(); i++)
+    {
+      REQUIRE(Lisp::equal(values[i], expected[i]));
+    }
+  }
+}
+
+TEST_CASE("reader_deep_nesting", "[Reader]")
+{
+  Vm vm;
+  const std::size_t depth = 100000;
+  std::string text(depth, '(');
+  text += "x";
+  text += std::string(depth, ')');
+  std::vector<Object> values(readString(vm, text));
+  REQUIRE(values.size() == 1u);
+  Cell cell(values[0]);
+  std::size_t n = 0;
+  while(cell.isA<Cons>())
+  {
+    REQUIRE(cell.as<Cons>()->getCdrCell().isA<Lisp::Nil>());
+    cell = cell.as<Cons>()->getCarCell();
+    n++;
+  }
+  REQUIRE(n == depth);
+  REQUIRE(cell.isA<Symbol>());
+}
+
+TEST_CASE("reader_collects_between_batches", "[Reader]")
+{
+  auto alloc = std::make_shared<Lisp::Allocator>(512, 10, 10);
+  Vm vm(alloc);
+  std::stringstream ss;
+  for(int i = 0; i < 2000; i++)
+  {
+    ss << "(" << i << " (s" << i << " \"t\") . " << i << ") ";
+  }
+  std::string text("(" + ss.str() + ")");
+  Reader reader(*alloc, text.c_str(), text.size());
+  reader.setBatchSize(16);
+  Object value;
+  REQUIRE(reader.read(value));
+  alloc->cycle();
+  alloc->cycle();
+  REQUIRE(alloc->checkSanity());
+  Cell cell(value);
+  UIntegerType i = 0;
+  for(; cell.isA<Cons>(); cell = cell.as<Cons>()->getCdrCell(), i++)
+  {
+    const Cell & item(cell.as<Cons>()->getCarCell());
+    REQUIRE(item.as<Cons>()->getCarCell().as<UIntegerType>() == i);
+    REQUIRE(item.as<Cons>()->getCdrCell().as<Cons>()->getCdrCell().as<UIntegerType>() == i);
+  }
+  REQUIRE(i == 2000u);
+}
+
+TEST_CASE("reader_recycles_garbage", "[Reader]")
+{
+  // the collector and the recycler keep up with the allocations
+  auto alloc = std::make_shared<Lisp::Allocator>(512, 1, 1);
+  Vm vm(alloc);
+  std::stringstream ss;
+  for(int i = 0; i < 1000; i++)
+  {
+    ss << "(";
+    for(int j = 0; j < 100; j++)
+    {
+      ss << j << " ";
+    }
+    ss << ") ";
+  }
+  std::string text(ss.str());
+  Reader reader(*alloc, text.c_str(), text.size());
+  reader.setBatchSize(16);
+  Object value;
+  std::size_t n = 0;
+  while(reader.read(value))
+  {
+    n++;
+  }
+  REQUIRE(n == 1000u);
+  // the discarded expressions are collected and recycled
+  REQUIRE(alloc->numCollectible() < 1000u);
+  REQUIRE(alloc->numDisposedCollectible() < 1000u);
+}
+
+TEST_CASE("reader_errors", "[Reader]")
+{
+  Vm vm;
+  REQUIRE_THROWS_AS(readString(vm, "(a b"), ParseError);
+  REQUIRE_THROWS_AS(readString(vm, "\"abc"), ParseError);
+  REQUIRE_THROWS_AS(readString(vm, "'"), ParseError);
+  REQUIRE_THROWS_AS(readString(vm, "18446744073709551616"), ParseError);
+  REQUIRE(errorOffset(vm, "a )") == 2u);
+  REQUIRE(errorOffset(vm, "(. a)") == 1u);
+  REQUIRE(errorOffset(vm, "(a . )") == 5u);
+  REQUIRE(errorOffset(vm, "(a . b c)") == 7u);
+  REQUIRE(errorOffset(vm, "(a . b)") == std::string::npos);
+}
+
+TEST_CASE("reader_file", "[Reader]")
+{
+  Vm vm;
+  std::string path("/tmp/lpp_test_reader_" + std::to_string(getpid()));
+  {
+    std::ofstream ost(path);
+    ost << "(a 1)\n(b \"2\")\n";
+  }
+  std::vector<Object> values(Lisp::readFile(path, *vm.getAllocator()));
+  std::remove(path.c_str());
+  REQUIRE(values.size() == 2u);
+  REQUIRE(Lisp::equal(values[0], vm.list(vm.make<Symbol>("a"), Object(1))));
+  REQUIRE(values[1].as<Cons>()->getCdrCell().as<Cons>()->getCarCell().isA<String>());
+  // missing files are I/O errors, malformed files are parse errors
+  try
+  {
+    Lisp::readFile(path, *vm.getAllocator());
+    FAIL("no exception");
+  }
+  catch(const IoError & ex)
+  {
+    REQUIRE(ex.getErrorNumber() == ENOENT);
+  }
+  REQUIRE_THROWS_AS(Lisp::readFile("/tmp", *vm.getAllocator()), IoError);
+  {
+    std::ofstream ost(path);
+    ost << "(a 1)\n(b";
+  }
+  REQUIRE_THROWS_AS(Lisp::readFile(path, *vm.getAllocator()), ParseError);
+  std::remove(path.c_str());
+}
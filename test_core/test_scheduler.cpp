@@ -0,0 +1,291 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <chrono>
+#include <vector>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/scheduler.h>
+#include <lpp/core/opcode.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/continuation.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+
+using Vm = Lisp::Vm;
+using Scheduler = Lisp::Scheduler;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using Continuation = Lisp::Continuation;
+using BuiltinFunction = Lisp::BuiltinFunction;
+using Allocator = Lisp::Allocator;
+using UIntegerType = Lisp::UIntegerType;
+using Timeout = Lisp::Timeout;
+
+namespace
+{
+  // (trace v0) (yield) (trace v1) (yield) ... (trace vn)
+  Object tracer(Vm & vm, const std::vector<UIntegerType> & values)
+  {
+    Object func = vm.make<Function>();
+    for(std::size_t i = 0; i < values.size(); i++)
+    {
+      if(i > 0)
+      {
+        func.as<Function>()->addPUSHL(vm.make<Symbol>("yield"));
+        func.as<Function>()->addFUNCALL(0);
+      }
+      func.as<Function>()->addPUSHL(vm.make<Symbol>("trace"));
+      func.as<Function>()->addPUSHV(Cell(values[i]));
+      func.as<Function>()->addFUNCALL(1);
+    }
+    return func;
+  }
+
+  void defineTrace(Vm & vm, std::vector<UIntegerType> & trace)
+  {
+    vm.define("trace", vm.make<BuiltinFunction>(
+                  "trace",
+                  [&trace](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                    trace.push_back(args[0].as<UIntegerType>());
+                    return Object(args[0]);
+                  },
+                  1));
+  }
+
+  // (define loop (lambda () (loop)))
+  Object endlessLoop(Vm & vm)
+  {
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHL(vm.make<Symbol>("loop"));
+    func.as<Function>()->addFUNCALL(0);
+    vm.define("loop", func);
+    return func;
+  }
+
+  // (g) (g) (g) (trace v) with (define g (lambda () 1))
+  Object busy(Vm & vm, UIntegerType v)
+  {
+    Object g = vm.make<Function>();
+    g.as<Function>()->addPUSHV(Cell(1u));
+    vm.define("g", g);
+    Object func = vm.make<Function>();
+    for(int i = 0; i < 3; i++)
+    {
+      func.as<Function>()->addPUSHL(vm.make<Symbol>("g"));
+      func.as<Function>()->addFUNCALL(0);
+    }
+    func.as<Function>()->addPUSHL(vm.make<Symbol>("trace"));
+    func.as<Function>()->addPUSHV(Cell(v));
+    func.as<Function>()->addFUNCALL(1);
+    return func;
+  }
+}
+
+TEST_CASE("continuation_yield", "[Scheduler]")
+{
+  Vm vm;
+  std::vector<UIntegerType> trace;
+  defineTrace(vm, trace);
+  Object func = tracer(vm, {1, 2});
+  Object cont = vm.make<Continuation>(func);
+  REQUIRE_FALSE(cont.as<Continuation>()->run());
+  REQUIRE(trace == std::vector<UIntegerType>({1}));
+  REQUIRE_FALSE(cont.as<Continuation>()->isFinished());
+  REQUIRE(cont.as<Continuation>()->run());
+  REQUIRE(cont.as<Continuation>()->isFinished());
+  REQUIRE(trace == std::vector<UIntegerType>({1, 2}));
+  REQUIRE(cont.as<Continuation>()->eval().as<UIntegerType>() == 2u);
+
+  // eval runs through yields
+  trace.clear();
+  REQUIRE(vm.eval(func).as<UIntegerType>() == 2u);
+  REQUIRE(trace == std::vector<UIntegerType>({1, 2}));
+}
+
+TEST_CASE("scheduler_round_robin", "[Scheduler]")
+{
+  Vm vm;
+  std::vector<UIntegerType> trace;
+  defineTrace(vm, trace);
+  Scheduler scheduler(vm);
+  Object a = scheduler.spawn(tracer(vm, {1, 2, 3}));
+  Object b = scheduler.spawn(tracer(vm, {10, 20}));
+  REQUIRE(scheduler.size() == 2u);
+  scheduler.run();
+  REQUIRE(scheduler.size() == 0u);
+  REQUIRE(trace == std::vector<UIntegerType>({1, 10, 2, 20, 3}));
+  REQUIRE(a.as<Continuation>()->isFinished());
+  REQUIRE(a.as<Continuation>()->eval().as<UIntegerType>() == 3u);
+  REQUIRE(b.as<Continuation>()->eval().as<UIntegerType>() == 20u);
+}
+
+TEST_CASE("scheduler_time_slice", "[Scheduler]")
+{
+  Vm vm;
+  std::vector<UIntegerType> trace;
+  defineTrace(vm, trace);
+  Scheduler scheduler(vm, 2);
+  scheduler.spawn(busy(vm, 1));
+  scheduler.spawn(tracer(vm, {2}));
+  REQUIRE(scheduler.step());
+  // preempted after two calls
+  REQUIRE(scheduler.size() == 2u);
+  REQUIRE(trace.empty());
+  scheduler.run();
+  REQUIRE(trace == std::vector<UIntegerType>({2, 1}));
+}
+
+TEST_CASE("scheduler_many_green_threads", "[Scheduler]")
+{
+  Vm vm;
+  std::vector<UIntegerType> trace;
+  defineTrace(vm, trace);
+  Scheduler scheduler(vm);
+  Object func = tracer(vm, {1, 2, 3});
+  std::vector<Object> threads;
+  for(int i = 0; i < 1000; i++)
+  {
+    threads.push_back(scheduler.spawn(func));
+  }
+  scheduler.run();
+  REQUIRE(trace.size() == 3000u);
+  REQUIRE(trace[999] == 1u);
+  REQUIRE(trace[1000] == 2u);
+  for(const Object & thread : threads)
+  {
+    REQUIRE(thread.as<Continuation>()->isFinished());
+  }
+}
+
+TEST_CASE("continuation_budget", "[Scheduler]")
+{
+  Vm vm;
+  std::vector<UIntegerType> trace;
+  defineTrace(vm, trace);
+  Object func = busy(vm, 1);
+  // the entry of the third call of g uses up the budget
+  vm.setBudget(3);
+  Object k;
+  try
+  {
+    vm.eval(func);
+    FAIL("no timeout");
+  }
+  catch(const Timeout & e)
+  {
+    k = e.getObject();
+  }
+  REQUIRE(k.isA<Continuation>());
+  REQUIRE(k.as<Continuation>()->isExhausted());
+  REQUIRE(k.as<Continuation>()->getBudget() == 0u);
+  REQUIRE(trace.empty());
+  REQUIRE_FALSE(k.as<Continuation>()->run());
+  REQUIRE(k.as<Continuation>()->isExhausted());
+
+  // resume with a new budget
+  k.as<Continuation>()->setBudget(10);
+  REQUIRE(k.as<Continuation>()->eval().as<UIntegerType>() == 1u);
+  REQUIRE(k.as<Continuation>()->getBudget() == 10u);
+  REQUIRE(trace == std::vector<UIntegerType>({1}));
+
+  // builtin calls are not counted
+  vm.setBudget(4);
+  REQUIRE(vm.eval(func).as<UIntegerType>() == 1u);
+  REQUIRE(trace == std::vector<UIntegerType>({1, 1}));
+}
+
+TEST_CASE("continuation_budget_tail_calls", "[Scheduler]")
+{
+  Vm vm;
+  Object func = endlessLoop(vm);
+  vm.setBudget(100000);
+  REQUIRE_THROWS_AS(vm.eval(func), Timeout);
+
+  // the budget and the time slice are independent
+  Object cont = vm.make<Continuation>(func);
+  cont.as<Continuation>()->setBudget(25);
+  for(int i = 0; i < 2; i++)
+  {
+    REQUIRE_FALSE(cont.as<Continuation>()->run(10));
+    REQUIRE_FALSE(cont.as<Continuation>()->isExhausted());
+  }
+  REQUIRE(cont.as<Continuation>()->getBudget() == 5u);
+  REQUIRE_FALSE(cont.as<Continuation>()->run(10));
+  REQUIRE(cont.as<Continuation>()->isExhausted());
+  REQUIRE(cont.as<Continuation>()->getBudget() == 0u);
+}
+
+TEST_CASE("continuation_time_limit", "[Scheduler]")
+{
+  Vm vm;
+  Object func = endlessLoop(vm);
+  vm.setTimeLimit(std::chrono::milliseconds(20));
+  auto start = std::chrono::steady_clock::now();
+  REQUIRE_THROWS_AS(vm.eval(func), Timeout);
+  REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+  // evaluations without limit are not affected
+  vm.setTimeLimit(Continuation::Clock::duration::zero());
+  std::vector<UIntegerType> trace;
+  defineTrace(vm, trace);
+  REQUIRE(vm.eval(busy(vm, 2)).as<UIntegerType>() == 2u);
+}
+
+TEST_CASE("scheduler_budget", "[Scheduler]")
+{
+  Vm vm;
+  std::vector<UIntegerType> trace;
+  defineTrace(vm, trace);
+  vm.setBudget(20);
+  Scheduler scheduler(vm, 10);
+  Object runaway = scheduler.spawn(endlessLoop(vm));
+  Object a = scheduler.spawn(tracer(vm, {1, 2, 3}));
+  bool timeout = false;
+  try
+  {
+    scheduler.run();
+  }
+  catch(const Timeout & e)
+  {
+    REQUIRE(e.getObject().as<Continuation>() == runaway.as<Continuation>());
+    timeout = true;
+  }
+  REQUIRE(timeout);
+  REQUIRE(trace == std::vector<UIntegerType>({1}));
+  // the runaway green thread is removed, the others continue
+  REQUIRE(scheduler.size() == 1u);
+  scheduler.run();
+  REQUIRE(trace == std::vector<UIntegerType>({1, 2, 3}));
+  REQUIRE(a.as<Continuation>()->isFinished());
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <catch.hpp>
+#include <lpp/core/value_stack.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/types/string.h>
+
+using ValueStack = Lisp::ValueStack;
+using Cell = Lisp::Cell;
+using String = Lisp::String;
+using UIntegerType = Lisp::UIntegerType;
+using StackOverflow = Lisp::StackOverflow;
+
+TEST_CASE("value_stack_push_truncate", "[ValueStack]")
+{
+  Cell str(new String("abc"));
+  {
+    ValueStack stack(2, 16);
+    REQUIRE(stack.empty());
+    for(UIntegerType i = 0; i < 8; i++)
+    {
+      stack.push_back(Cell(i));
+      stack.push_back(str);
+    }
+    REQUIRE(stack.size() == 16u);
+    REQUIRE(stack.capacity() == 16u);
+    REQUIRE(str.getRefCount() == 9u);
+    REQUIRE(stack[6].as<UIntegerType>() == 3u);
+    stack.truncate(10);
+    REQUIRE(stack.size() == 10u);
+    REQUIRE(str.getRefCount() == 6u);
+    stack.pop_back();
+    REQUIRE(str.getRefCount() == 5u);
+    REQUIRE(stack.back().as<UIntegerType>() == 4u);
+  }
+  REQUIRE(str.getRefCount() == 1u);
+}
+
+TEST_CASE("value_stack_collapse_shift", "[ValueStack]")
+{
+  Cell str(new String("abc"));
+  ValueStack stack;
+  stack.push_back(str);
+  stack.push_back(Cell(1u));
+  stack.push_back(str);
+  stack.push_back(Cell(2u));
+  stack.push_back(str);
+  REQUIRE(str.getRefCount() == 4u);
+
+  // str 2 str
+  stack.shift(0, 3);
+  REQUIRE(stack.size() == 3u);
+  REQUIRE(str.getRefCount() == 3u);
+  REQUIRE(stack[0].isA<String>());
+  REQUIRE(stack[1].as<UIntegerType>() == 2u);
+  REQUIRE(stack[2].isA<String>());
+
+  // str <- top
+  stack.push_back(Cell(3u));
+  stack.collapse(0);
+  REQUIRE(stack.size() == 1u);
+  REQUIRE(str.getRefCount() == 1u);
+  REQUIRE(stack.back().as<UIntegerType>() == 3u);
+}
+
+TEST_CASE("value_stack_insert", "[ValueStack]")
+{
+  Cell str(new String("abc"));
+  ValueStack stack(2, 16);
+  stack.push_back(Cell(1u));
+  stack.push_back(Cell(2u));
+  // 1 str 2, grows the capacity
+  stack.insert(1, str);
+  REQUIRE(stack.size() == 3u);
+  REQUIRE(stack.capacity() >= 3u);
+  REQUIRE(str.getRefCount() == 2u);
+  REQUIRE(stack[0].as<UIntegerType>() == 1u);
+  REQUIRE(stack[1].isA<String>());
+  REQUIRE(stack[2].as<UIntegerType>() == 2u);
+  // 1 str 2 str
+  stack.insert(3, stack[1]);
+  REQUIRE(str.getRefCount() == 3u);
+  REQUIRE(stack[3].isA<String>());
+  stack.truncate(0);
+  REQUIRE(str.getRefCount() == 1u);
+}
+
+TEST_CASE("value_stack_overflow", "[ValueStack]")
+{
+  ValueStack stack(4, 8);
+  for(UIntegerType i = 0; i < 8; i++)
+  {
+    stack.push_back(Cell(i));
+  }
+  REQUIRE_THROWS_AS(stack.push_back(Cell(8u)), StackOverflow);
+  REQUIRE(stack.size() == 8u);
+  REQUIRE_THROWS_AS(stack.setMaxSize(4), StackOverflow);
+  stack.setMaxSize(9);
+  stack.push_back(Cell(8u));
+  REQUIRE(stack.back().as<UIntegerType>() == 8u);
+}
@@ -0,0 +1,211 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/verifier.h>
+#include <lpp/core/opcode.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+
+using Vm = Lisp::Vm;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+using InvalidBytecode = Lisp::InvalidBytecode;
+using Code = Function::Code;
+
+namespace
+{
+  std::size_t rejectedAt(Function & f)
+  {
+    try
+    {
+      Lisp::verify(f);
+    }
+    catch(const InvalidBytecode & ex)
+    {
+      REQUIRE(!f.isVerified());
+      return ex.getOffset();
+    }
+    FAIL("code has been accepted");
+    return 0;
+  }
+}
+
+TEST_CASE("verifier_accepts", "[Verifier]")
+{
+  Vm vm;
+  // (lambda (a) (+ a (car (cons 1 2))))
+  Object func = vm.make<Function>();
+  Function * f = func.as<Function>();
+  f->addArgument(vm.make<Symbol>("a"));
+  f->addPUSHA(0);
+  f->addPUSHV(Cell(UIntegerType(1)));
+  f->addPUSHV(Cell(UIntegerType(2)));
+  f->addPrimitive(Lisp::CONS, 2);
+  f->addPrimitive(Lisp::CAR, 1);
+  f->addPrimitive(Lisp::ADD, 2);
+  REQUIRE_FALSE(f->isVerified());
+  // function, argument, a, 1, 2
+  REQUIRE(Lisp::verify(*f) == 5u);
+  REQUIRE(f->isVerified());
+  REQUIRE(f->getMaxStackDepth() == 5u);
+  REQUIRE(vm.eval(func, Cell(UIntegerType(3))).as<UIntegerType>() == 4u);
+
+  // modifying the code resets the flag
+  f->addPUSHV(Cell(UIntegerType(1)));
+  REQUIRE_FALSE(f->isVerified());
+  // verified on the first call
+  REQUIRE(vm.eval(func, Cell(UIntegerType(3))).as<UIntegerType>() == 1u);
+  REQUIRE(f->isVerified());
+
+  // nested functions are verified with their enclosing function
+  Object inner = vm.make<Function>();
+  inner.as<Function>()->addPUSHV(Cell(UIntegerType(7)));
+  Object outer = vm.make<Function>();
+  outer.as<Function>()->addPUSHV(inner);
+  outer.as<Function>()->addFUNCALL(0);
+  Lisp::verify(*outer.as<Function>());
+  REQUIRE(inner.as<Function>()->isVerified());
+  REQUIRE(inner.as<Function>()->getMaxStackDepth() == 2u);
+}
+
+TEST_CASE("verifier_rejects", "[Verifier]")
+{
+  Vm vm;
+  {
+    // argument out of range
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHV(Cell(UIntegerType(1)));
+    func.as<Function>()->addPUSHA(0);
+    REQUIRE(rejectedAt(*func.as<Function>()) == 2u);
+  }
+  {
+    // data element out of range
+    Object func = vm.make<Function>();
+    func.as<Function>()->setCode(Code({Lisp::PUSHV, 0}));
+    REQUIRE(rejectedAt(*func.as<Function>()) == 0u);
+  }
+  {
+    // lookup of a non-symbol
+    Object func = vm.make<Function>();
+    func.as<Function>()->appendData(Cell(UIntegerType(1)));
+    func.as<Function>()->setCode(Code({Lisp::PUSHL, 0}));
+    REQUIRE(rejectedAt(*func.as<Function>()) == 0u);
+  }
+  {
+    // unknown opcode and truncated operand
+    Object func = vm.make<Function>();
+    func.as<Function>()->setCode(Code({0x7f, 0}));
+    REQUIRE(rejectedAt(*func.as<Function>()) == 0u);
+    func.as<Function>()->setCode(Code({Lisp::FUNCALL, 0x80}));
+    REQUIRE(rejectedAt(*func.as<Function>()) == 0u);
+  }
+  {
+    // stack underflow: FUNCALL without function
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHV(Cell(UIntegerType(1)));
+    func.as<Function>()->addFUNCALL(1);
+    REQUIRE(rejectedAt(*func.as<Function>()) == 2u);
+  }
+  {
+    // arity of a primitive
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHV(Cell(UIntegerType(1)));
+    func.as<Function>()->addPUSHV(Cell(UIntegerType(2)));
+    func.as<Function>()->addPrimitive(Lisp::CAR, 2);
+    REQUIRE(rejectedAt(*func.as<Function>()) == 4u);
+  }
+  {
+    // arity of a function constant
+    Object inner = vm.make<Function>();
+    inner.as<Function>()->addArgument(vm.make<Symbol>("a"));
+    inner.as<Function>()->addPUSHA(0);
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHV(inner);
+    func.as<Function>()->addFUNCALL(0);
+    REQUIRE(rejectedAt(*func.as<Function>()) == 2u);
+    REQUIRE_THROWS_AS(vm.eval(func), InvalidBytecode);
+  }
+  {
+    // the rest parameter is only accessible through PUSHR
+    Object func = vm.make<Function>();
+    func.as<Function>()->addArgument(vm.make<Symbol>("a"));
+    func.as<Function>()->addRestArgument(vm.make<Symbol>("r"));
+    func.as<Function>()->addPUSHA(1);
+    REQUIRE(rejectedAt(*func.as<Function>()) == 0u);
+    func.as<Function>()->setCode(Code({Lisp::PUSHR, 0}));
+    REQUIRE(rejectedAt(*func.as<Function>()) == 0u);
+    func.as<Function>()->setCode(Code({Lisp::PUSHR, 1}));
+    REQUIRE(Lisp::verify(*func.as<Function>()) == 4u);
+  }
+  {
+    // arity of a function constant with optional and rest parameters
+    Object inner = vm.make<Function>();
+    inner.as<Function>()->addArgument(vm.make<Symbol>("a"));
+    inner.as<Function>()->addOptionalArgument(vm.make<Symbol>("b"));
+    Object func = vm.make<Function>();
+    func.as<Function>()->addPUSHV(inner);
+    func.as<Function>()->addPUSHV(Cell(UIntegerType(1)));
+    func.as<Function>()->addFUNCALL(1);
+    REQUIRE(Lisp::verify(*func.as<Function>()) == 3u);
+    func.as<Function>()->addPUSHV(inner);
+    func.as<Function>()->addFUNCALL(0);
+    REQUIRE(rejectedAt(*func.as<Function>()) == 8u);
+  }
+}
+
+TEST_CASE("verifier_frozen_cycle", "[Verifier]")
+{
+  // f and g refer to each other, freezing verifies both
+  Vm vm;
+  Object f = vm.make<Function>();
+  Object g = vm.make<Function>();
+  f.as<Function>()->addPUSHV(g);
+  g.as<Function>()->addPUSHV(f);
+  vm.getAllocator()->freeze(f);
+  REQUIRE(g.as<Function>()->isFrozen());
+  REQUIRE(f.as<Function>()->isVerified());
+  REQUIRE(g.as<Function>()->isVerified());
+  REQUIRE(f.as<Function>()->getMaxStackDepth() == 2u);
+  REQUIRE(Lisp::verify(*f.as<Function>()) == 2u);
+
+  // invalid code is rejected before anything is frozen
+  Object h = vm.make<Function>();
+  Object lst = vm.list(Object(1), h);
+  h.as<Function>()->addFUNCALL(0);
+  REQUIRE_THROWS_AS(vm.getAllocator()->freeze(lst), InvalidBytecode);
+  REQUIRE_FALSE(lst.isFrozen());
+  REQUIRE_FALSE(h.as<Function>()->isFrozen());
+}
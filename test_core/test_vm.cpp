@@ -28,18 +28,57 @@ The views and conclusions contained in the software and documentation are those
 of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
+#include <string>
 #include <catch.hpp>
 #include <lpp/core/vm.h>
 #include <lpp/core/opcode.h>
+#include <lpp/core/exception.h>
 #include <lpp/core/types/cons.h>
 #include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/string.h>
+#include <lpp/core/types/lisp_builtin_function.h>
+#include <lpp/core/types/captured_continuation.h>
 
 
 using Vm = Lisp::Vm;
 using Object = Lisp::Object;
+using Cell = Lisp::Cell;
 using Cons = Lisp::Cons;
 using Nil = Lisp::Nil;
 using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using String = Lisp::String;
+using BuiltinFunction = Lisp::BuiltinFunction;
+using Allocator = Lisp::Allocator;
+using NonMatchingArguments = Lisp::NonMatchingArguments;
+using NotAnInteger = Lisp::NotAnInteger;
+using NotAFunction = Lisp::NotAFunction;
+using UIntegerType = Lisp::UIntegerType;
+
+namespace
+{
+  // (lambda (a b) (+ a b))
+  Object adder(Vm & vm)
+  {
+    Object func = vm.make<Function>();
+    func.as<Function>()->addArgument(vm.make<Symbol>("a"));
+    func.as<Function>()->addArgument(vm.make<Symbol>("b"));
+    func.as<Function>()->addPUSHA(0);
+    func.as<Function>()->addPUSHA(1);
+    func.as<Function>()->addPrimitive(Lisp::ADD, 2);
+    return func;
+  }
+
+  // (lambda (a) a)
+  Object identity(Vm & vm)
+  {
+    Object func = vm.make<Function>();
+    func.as<Function>()->addArgument(vm.make<Symbol>("a"));
+    func.as<Function>()->addPUSHA(0);
+    return func;
+  }
+}
 
 
 TEST_CASE("is_debug_enabled", "[Vm]")
@@ -97,3 +136,102 @@ TEST_CASE("vm_list_does_not_create_temporary_objects", "[Vm]")
             ->getCar().isA<Nil>());
   }
 }
+
+TEST_CASE("vm_call_converts_arguments_and_result", "[Vm]")
+{
+  Vm vm;
+  Object add = adder(vm);
+  REQUIRE(vm.call<int>(add, 1, 2) == 3);
+  REQUIRE(vm.call<std::size_t>(add, Cell(2u), 40u) == 42u);
+  REQUIRE(vm.call<Object>(add, 1, 2).as<Lisp::UIntegerType>() == 3u);
+  REQUIRE(vm.eval(add, Cell(1u), Cell(2u)).as<Lisp::UIntegerType>() == 3u);
+  Object id = identity(vm);
+  REQUIRE(vm.call<std::string>(id, "abc") == "abc");
+  REQUIRE(vm.call<std::string>(id, std::string("xyz")) == "xyz");
+  REQUIRE(vm.call<bool>(id, false) == false);
+  REQUIRE(vm.call<bool>(id, true) == true);
+  // every value except #f is true
+  REQUIRE(vm.call<bool>(id, Lisp::nil) == true);
+  vm.call<void>(id, 1);
+  REQUIRE_THROWS_AS(vm.call<int>(id, "abc"), NotAnInteger);
+  REQUIRE_THROWS_AS(vm.call<int>(add, 1), NonMatchingArguments);
+  // the continuation is returned to the pool after an exception
+  REQUIRE(vm.call<int>(add, 1, 2) == 3);
+}
+
+TEST_CASE("vm_call_not_a_function", "[Vm]")
+{
+  Vm vm;
+  // (nosuchfn 1)
+  Object func = vm.make<Function>();
+  func.as<Function>()->addPUSHL(vm.make<Symbol>("nosuchfn"));
+  func.as<Function>()->addPUSHV(Cell(1u));
+  func.as<Function>()->addFUNCALL(1);
+  REQUIRE_THROWS_AS(vm.eval(func), NotAFunction);
+  // (1 2)
+  func = vm.make<Function>();
+  func.as<Function>()->addPUSHV(Cell(1u));
+  func.as<Function>()->addPUSHV(Cell(2u));
+  func.as<Function>()->addFUNCALL(1);
+  REQUIRE_THROWS_AS(vm.eval(func), NotAFunction);
+  REQUIRE(vm.call<int>(adder(vm), 1, 2) == 3);
+}
+
+TEST_CASE("vm_call_builtins", "[Vm]")
+{
+  Vm vm;
+  REQUIRE(vm.call<UIntegerType>(vm.find("+"), 1, 2) == 3u);
+  REQUIRE(vm.call<UIntegerType>(vm.find("car"), vm.list(Object(4), Object(5))) == 4u);
+  REQUIRE_THROWS_AS(vm.call<UIntegerType>(vm.find("car"), 1, 2), NonMatchingArguments);
+  REQUIRE_THROWS_AS(vm.call<UIntegerType>(Object(1), 2), NotAFunction);
+  REQUIRE_THROWS_AS(vm.eval(vm.find("nosuchfn")), NotAFunction);
+  // (call/cc f) with f = (lambda (k) (k 7) 8): k escapes from the call
+  Object func = vm.make<Function>();
+  func.as<Function>()->addArgument(vm.make<Symbol>("k"));
+  func.as<Function>()->addPUSHA(0);
+  func.as<Function>()->addPUSHV(Cell(7u));
+  func.as<Function>()->addFUNCALL(1);
+  func.as<Function>()->addPUSHV(Cell(8u));
+  REQUIRE(vm.call<UIntegerType>(vm.find("call/cc"), func) == 7u);
+  // a captured continuation is a callable value: (call/cc identity)
+  Object k = vm.call<Object>(vm.find("call/cc"), identity(vm));
+  REQUIRE(k.isA<Lisp::CapturedContinuation>());
+  REQUIRE(vm.call<UIntegerType>(k, 9) == 9u);
+  REQUIRE_THROWS_AS(vm.call<UIntegerType>(k, 1, 2), NonMatchingArguments);
+}
+
+TEST_CASE("vm_eval_reuses_continuations", "[Vm]")
+{
+  Vm vm;
+  Object add = adder(vm);
+  REQUIRE(vm.call<int>(add, 1, 2) == 3);
+  std::size_t numCollectible = vm.getAllocator()->numCollectible();
+  for(int i = 0; i < 1000; i++)
+  {
+    REQUIRE(vm.call<int>(add, i, 1) == i + 1);
+  }
+  REQUIRE(vm.getAllocator()->numCollectible() == numCollectible);
+}
+
+TEST_CASE("vm_nested_eval", "[Vm]")
+{
+  Vm vm;
+  Object add = adder(vm);
+  // (twice x) calls (add x x) from a builtin
+  vm.define("twice", vm.make<BuiltinFunction>(
+                "twice",
+                [&vm, &add](Allocator & alloc, const Cell * args, std::size_t nargs) {
+                  return vm.call<Object>(add, args[0], args[0]);
+                },
+                1));
+  // (lambda (a) (+ 1 (twice a)))
+  Object func = vm.make<Function>();
+  func.as<Function>()->addArgument(vm.make<Symbol>("a"));
+  func.as<Function>()->addPUSHV(Cell(1u));
+  func.as<Function>()->addPUSHL(vm.make<Symbol>("twice"));
+  func.as<Function>()->addPUSHA(0);
+  func.as<Function>()->addFUNCALL(1);
+  func.as<Function>()->addPrimitive(Lisp::ADD, 2);
+  REQUIRE(vm.call<int>(func, 20) == 41);
+  REQUIRE(vm.call<int>(func, 1) == 3);
+}
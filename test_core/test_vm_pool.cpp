@@ -0,0 +1,117 @@
+/******************************************************************************
+Copyright (c) 2019, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#include <future>
+#include <vector>
+#include <catch.hpp>
+#include <lpp/core/vm.h>
+#include <lpp/core/vm_pool.h>
+#include <lpp/core/opcode.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/types/function.h>
+#include <lpp/core/types/symbol.h>
+#include <lpp/core/types/closure.h>
+
+using Vm = Lisp::Vm;
+using VmPool = Lisp::VmPool;
+using Object = Lisp::Object;
+using Cell = Lisp::Cell;
+using Function = Lisp::Function;
+using Symbol = Lisp::Symbol;
+using UIntegerType = Lisp::UIntegerType;
+using Closure = Lisp::Closure;
+using NotAList = Lisp::NotAList;
+
+TEST_CASE("vm_pool_shared_function", "[VmPool]")
+{
+  Vm code;
+  // (define f (lambda () (+ x 1)))
+  Object func = code.make<Function>();
+  func.as<Function>()->addPUSHL(code.make<Symbol>("x"));
+  func.as<Function>()->addPUSHV(Cell(1u));
+  func.as<Function>()->addPrimitive(Lisp::ADD, 2);
+  code.define("f", func);
+  VmPool pool(code, 4);
+  REQUIRE(pool.numThreads() == 4u);
+  REQUIRE(func.isFrozen());
+  std::vector<std::future<UIntegerType>> results;
+  for(UIntegerType i = 0; i < 100; i++)
+  {
+    results.push_back(pool.submit([i](Vm & vm) {
+          // x is bound in the env of the worker,
+          // the shared function sees the same symbol
+          vm.define("x", Object(Cell(i)));
+          return vm.eval(vm.find("f")).as<UIntegerType>();
+        }));
+  }
+  for(UIntegerType i = 0; i < 100; i++)
+  {
+    REQUIRE(results[i].get() == i + 1);
+  }
+}
+
+TEST_CASE("vm_pool_exception", "[VmPool]")
+{
+  Vm code;
+  // (define f (lambda () (car 1)))
+  Object func = code.make<Function>();
+  func.as<Function>()->addPUSHV(Cell(1u));
+  func.as<Function>()->addPrimitive(Lisp::CAR, 1);
+  code.define("f", func);
+  VmPool pool(code, 2);
+  auto result = pool.submit([](Vm & vm) {
+      return vm.eval(vm.find("f")).as<UIntegerType>();
+    });
+  REQUIRE_THROWS_AS(result.get(), NotAList);
+}
+
+TEST_CASE("vm_pool_verifies_reachable_functions", "[VmPool]")
+{
+  // functions bound through a closure and a list are
+  // verified before they are frozen
+  Vm code;
+  Object inner = code.make<Function>();
+  inner.as<Function>()->addPUSHC(0);
+  inner.as<Function>()->setNumCaptured(1);
+  Cell captured(UIntegerType(5));
+  code.define("f", code.make<Closure>(inner, &captured, 1));
+  Object listed = code.make<Function>();
+  listed.as<Function>()->addPUSHV(Cell(UIntegerType(7)));
+  code.define("l", code.list(Object(Cell(UIntegerType(1))), listed));
+  VmPool pool(code, 1);
+  REQUIRE(inner.isFrozen());
+  REQUIRE(inner.as<Function>()->isVerified());
+  REQUIRE(listed.isFrozen());
+  REQUIRE(listed.as<Function>()->isVerified());
+  auto result = pool.submit([](Vm & vm) {
+      return vm.eval(vm.find("f")).as<UIntegerType>();
+    });
+  REQUIRE(result.get() == 5u);
+}
@@ -227,3 +227,18 @@ TEST_CASE("continuation_funcall", "[Continuation]")
   REQUIRE(res.as<UIntegerType>() == 10);
   REQUIRE(cont.as<Continuation>()->stackSize() == 1u);
 }
+
+TEST_CASE("continuation_missing_closure", "[Continuation]")
+{
+  Vm vm;
+  Object lambda = vm.make<Function>();
+  lambda.as<Function>()->setNumCaptured(1);
+  lambda.as<Function>()->addPUSHC(0);
+  REQUIRE_THROWS_AS(vm.make<Continuation>(lambda.as<Function>()), Lisp::MissingClosure);
+  REQUIRE_THROWS_AS(vm.eval(lambda), Lisp::MissingClosure);
+
+  Object func = vm.make<Function>();
+  func.as<Function>()->addPUSHV(lambda);
+  func.as<Function>()->addFUNCALL(0);
+  REQUIRE_THROWS_AS(vm.eval(func), Lisp::MissingClosure);
+}
@@ -28,6 +28,8 @@ The views and conclusions contained in the software and documentation are those
 of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
+#include <limits>
+#include <sstream>
 #include <catch.hpp>
 #include <lpp/core/vm.h>
 #include <lpp/core/types/function.h>
@@ -54,16 +56,93 @@ TEST_CASE("function", "[Function]")
   REQUIRE(f1.as<Function>()->getArgumentPos(vm.make<Symbol>("a")) == 0);
   REQUIRE(f1.as<Function>()->getArgumentPos(vm.make<Symbol>("b")) == 1);
   REQUIRE(f1.as<Function>()->getArgumentPos(vm.make<Symbol>("c")) == Function::notFound);
-  REQUIRE_FALSE(f1.as<Function>()->getArgumentTraits(0).isReference());
-  REQUIRE_FALSE(f1.as<Function>()->getArgumentTraits(1).isReference());
+  REQUIRE(f1.as<Function>()->numCaptured() == 0u);
+  f1.as<Function>()->setNumCaptured(1);
+  REQUIRE(f1.as<Function>()->numCaptured() == 1u);
 
-  Object sa = f1.as<Function>()->shareArgument(0);
-  REQUIRE(f1.as<Function>()->getArgumentTraits(0).isReference());
-  REQUIRE_FALSE(f1.as<Function>()->getArgumentTraits(1).isReference());
-  std::size_t refIndex = f1.as<Function>()->getArgumentTraits(0).getReferenceIndex();
-  REQUIRE(f1.as<Function>()->atCell(refIndex).isA<Reference>());
-  REQUIRE(sa.as<Reference>() == f1.as<Function>()->atCell(refIndex).as<Reference>());
-  sa.as<Reference>()->setValue(vm.make<UIntegerType>(12));
-  REQUIRE(f1.as<Function>()->getValue(refIndex).isA<UIntegerType>());
-  REQUIRE(f1.as<Function>()->getValue(refIndex).as<UIntegerType>() == 12);
+  // references in the data are resolved
+  Object ref = vm.make<Reference>(vm.make<Symbol>("c"), vm.make<UIntegerType>(12));
+  f1.as<Function>()->appendData(ref);
+  REQUIRE(f1.as<Function>()->atCell(2).isA<Reference>());
+  REQUIRE(f1.as<Function>()->getValue(2).isA<UIntegerType>());
+  REQUIRE(f1.as<Function>()->getValue(2).as<UIntegerType>() == 12);
+}
+
+TEST_CASE("function_code_encoding", "[Function]")
+{
+  std::vector<Lisp::InstructionType> code;
+  std::vector<std::size_t> values({0u, 1u, 127u, 128u, 300u, 16383u, 16384u,
+                                   std::numeric_limits<std::size_t>::max()});
+  for(auto v : values)
+  {
+    code.push_back(Lisp::PUSHV);
+    Lisp::appendOperand(code, v);
+  }
+  REQUIRE(code.size() == 8u + 1u + 1u + 1u + 2u + 2u + 2u + 3u + 10u);
+  auto itr = code.cbegin();
+  for(auto v : values)
+  {
+    REQUIRE(*itr == Lisp::PUSHV);
+    REQUIRE(Lisp::fetchOperand(itr) == v);
+  }
+  REQUIRE(itr == code.cend());
+
+  // one byte opcode and one byte operand for small functions
+  Vm vm;
+  Object f = vm.make<Function>();
+  for(std::size_t i = 0; i < 200; i++)
+  {
+    f.as<Function>()->addPUSHV(vm.make<UIntegerType>(i));
+  }
+  f.as<Function>()->addRETURNS(1);
+  REQUIRE(f.as<Function>()->numInstructions() == 128u * 2u + 72u * 3u + 2u);
+  std::stringstream ss;
+  f.as<Function>()->disassemble(ss);
+  REQUIRE(ss.str().find("256:\tPUSHV 128") != std::string::npos);
+  REQUIRE(ss.str().find("RETURNS 1") != std::string::npos);
+}
+
+TEST_CASE("function_frozen", "[Function]")
+{
+  // (lambda (a) 1)
+  Vm vm;
+  Object f = vm.make<Function>();
+  Object sym = vm.make<Symbol>("a");
+  f.as<Function>()->addArgument(sym);
+  f.as<Function>()->addPUSHV(vm.make<UIntegerType>(1));
+  f.as<Function>()->addRETURNS(1);
+  vm.getAllocator()->freeze(f);
+  Function * func = f.as<Function>();
+  REQUIRE(func->isFrozen());
+  std::size_t n = func->numInstructions();
+  std::size_t d = func->dataSize();
+
+  // mutators fail fast without modifying the function
+  REQUIRE_THROWS_AS(func->addPUSHV(Lisp::nil), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addRETURNS(1), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addRETURNL(sym), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addPUSHL(sym), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addFUNCALL(0), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addDEFINES(sym), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addPUSHA(0), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addPUSHC(0), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addCLOSURE(f), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addPrimitive(Lisp::CAR, 1), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->removeInstruction(0), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->appendData(Lisp::nil), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->setCode(Function::Code()), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->setNumCaptured(1), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->setName("f"), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->shrink(), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->setArguments(0, 0, false), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addArgument(sym), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addOptionalArgument(sym), Lisp::FrozenObject);
+  REQUIRE_THROWS_AS(func->addRestArgument(sym), Lisp::FrozenObject);
+  REQUIRE(func->numInstructions() == n);
+  REQUIRE(func->dataSize() == d);
+  REQUIRE(func->numArguments() == 1u);
+  REQUIRE(func->numOptionalArguments() == 0u);
+  REQUIRE_FALSE(func->hasRestArgument());
+  REQUIRE(func->numCaptured() == 0u);
+  REQUIRE(func->getName().empty());
 }
@@ -28,6 +28,8 @@ The views and conclusions contained in the software and documentation are those
 of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
+#include <thread>
+#include <vector>
 #include <catch.hpp>
 #include <lpp/core/cell.h>
 #include <lpp/core/types/string.h>
@@ -43,3 +45,30 @@ TEST_CASE("cons", "[String]")
   REQUIRE(cell.isA<String>());
   REQUIRE(cell.as<String>()->getCString() == "abc");
 }
+
+TEST_CASE("string_shared", "[String]")
+{
+  Cell cell(new String("abc"));
+  REQUIRE_FALSE(cell.as<String>()->isShared());
+  cell.as<String>()->share();
+  REQUIRE(cell.as<String>()->isShared());
+  REQUIRE(cell.getRefCount() == 1u);
+  std::vector<std::thread> threads;
+  for(std::size_t i = 0; i < 4; i++)
+  {
+    threads.emplace_back([cell]() {
+        for(std::size_t j = 0; j < 10000; j++)
+        {
+          Cell copy(cell);
+          Cell copy2;
+          copy2 = copy;
+        }
+      });
+  }
+  for(auto & t : threads)
+  {
+    t.join();
+  }
+  REQUIRE(cell.getRefCount() == 1u);
+  REQUIRE(cell.as<String>()->getCString() == "abc");
+}
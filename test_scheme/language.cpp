@@ -28,11 +28,17 @@ The views and conclusions contained in the software and documentation are those
 of the authors and should not be interpreted as representing official policies,
 either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
+#include <sstream>
 #include <catch.hpp>
 #include <lpp/core/vm.h>
 #include <lpp/core/types/function.h>
 #include <lpp/core/types/reference.h>
 #include <lpp/core/types/string.h>
+#include <lpp/core/types/cons.h>
+#include <lpp/core/types/closure.h>
+#include <lpp/core/types/captured_continuation.h>
+#include <lpp/core/exception.h>
+#include <lpp/core/equal.h>
 
 #include <lpp/scheme/language.h>
 
@@ -46,6 +52,8 @@ using String = Lisp::String;
 using Function = Lisp::Function;
 using Symbol = Lisp::Symbol;
 using Reference = Lisp::Reference;
+using Closure = Lisp::Closure;
+using Cons = Lisp::Cons;
 
 /*****************************************
  * Primitives
@@ -291,14 +299,14 @@ TEST_CASE("scm_nested_scopes_1", "[Scheme]")
   auto func = vm.eval(expr);
   REQUIRE(func.isA<Function>());
   REQUIRE(func.as<Function>()->numArguments() == 2);
-  REQUIRE(func.as<Function>()->getArgumentTraits(0).isReference());
-  REQUIRE_FALSE(func.as<Function>()->getArgumentTraits(1).isReference());
+  REQUIRE(func.as<Function>()->numCaptured() == 0);
 
+  // closure (lambda (c d) a) with a = 1
   auto func2 = vm.eval(func, vm.make<UIntegerType>(1), vm.make<UIntegerType>(2));
-  REQUIRE(func2.isA<Function>());
-  REQUIRE(func2.as<Function>()->numArguments() == 2);
-  REQUIRE_FALSE(func2.as<Function>()->getArgumentTraits(0).isReference());
-  REQUIRE_FALSE(func2.as<Function>()->getArgumentTraits(1).isReference());
+  REQUIRE(func2.isA<Closure>());
+  REQUIRE(func2.as<Closure>()->getFunction()->numArguments() == 2);
+  REQUIRE(func2.as<Closure>()->numCaptured() == 1);
+  REQUIRE(func2.as<Closure>()->getCaptured(0).as<UIntegerType>() == 1);
 
   auto res = vm.eval(func2, vm.make<UIntegerType>(3), vm.make<UIntegerType>(4));
   REQUIRE(res.isA<UIntegerType>());
@@ -332,28 +340,26 @@ TEST_CASE("scm_nested_scopes_2", "[Scheme]")
   auto func = vm.eval(expr);
   REQUIRE(func.isA<Function>());
   REQUIRE(func.as<Function>()->numArguments() == 2);
-  REQUIRE(func.as<Function>()->getArgumentTraits(0).isReference());
-  REQUIRE_FALSE(func.as<Function>()->getArgumentTraits(1).isReference());
-
+  REQUIRE(func.as<Function>()->numCaptured() == 0);
 
   /*
     (lambda (c d)
-      (lambda (c d) a)) */
+      (lambda (c d) a))
+    a is captured to create the inner closure */
   auto func1 = vm.eval(func,
                        vm.make<UIntegerType>(1),
                        vm.make<UIntegerType>(2));
-  REQUIRE(func1.isA<Function>());
-  REQUIRE(func1.as<Function>()->numArguments() == 2);
-  REQUIRE_FALSE(func1.as<Function>()->getArgumentTraits(0).isReference());
-  REQUIRE_FALSE(func1.as<Function>()->getArgumentTraits(1).isReference());
+  REQUIRE(func1.isA<Closure>());
+  REQUIRE(func1.as<Closure>()->getFunction()->numArguments() == 2);
+  REQUIRE(func1.as<Closure>()->numCaptured() == 1);
 
   /* (lambda (c d) a)) */
   auto func2 = vm.eval(func1,
                        vm.make<UIntegerType>(5),
                        vm.make<UIntegerType>(6));
-  REQUIRE(func2.as<Function>()->numArguments() == 2);
-  REQUIRE_FALSE(func2.as<Function>()->getArgumentTraits(0).isReference());
-  REQUIRE_FALSE(func2.as<Function>()->getArgumentTraits(1).isReference());
+  REQUIRE(func2.isA<Closure>());
+  REQUIRE(func2.as<Closure>()->getFunction()->numArguments() == 2);
+  REQUIRE(func2.as<Closure>()->getCaptured(0).as<UIntegerType>() == 1);
 
   auto res = vm.eval(func2,
                      vm.make<UIntegerType>(3),
@@ -451,3 +457,532 @@ TEST_CASE("scm_car_lambda_3", "[Scheme]")
   REQUIRE(res.isA<UIntegerType>());
   REQUIRE(res.as<UIntegerType>() == 4);
 }
+
+TEST_CASE("scm_peephole", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (define second (lambda (a b) b))
+  // PUSHA 1 is removed
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("second"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("a"),
+                                                vm.make<Symbol>("b")),
+                                        vm.make<Symbol>("b")))));
+  REQUIRE(lang->getStatistics().emptyBodies == 1u);
+  REQUIRE(lang->getStatistics().total() == 1u);
+  REQUIRE(vm.find("second").as<Function>()->numInstructions() == 0u);
+  {
+    // ((lambda (a b) b) 1 2)
+    // PUSHV2 #f 1, PUSHVFUNCALL 2 2
+    Object func = lang->compile(vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                                vm.list(vm.make<Symbol>("a"),
+                                                        vm.make<Symbol>("b")),
+                                                vm.make<Symbol>("b")),
+                                        vm.make<UIntegerType>(1),
+                                        vm.make<UIntegerType>(2)));
+    REQUIRE(lang->getStatistics().emptyBodies == 2u);
+    REQUIRE(lang->getStatistics().pushv2 == 1u);
+    REQUIRE(lang->getStatistics().pushvFuncall == 1u);
+    std::stringstream ss;
+    func.as<Function>()->disassemble(ss);
+    REQUIRE(ss.str().find("PUSHV2") != std::string::npos);
+    REQUIRE(ss.str().find("PUSHVFUNCALL 2 2") != std::string::npos);
+    Object res = vm.eval(func);
+    REQUIRE(res.isA<UIntegerType>());
+    REQUIRE(res.as<UIntegerType>() == 2);
+  }
+  {
+    // (define k (lambda () 7))
+    // (k)
+    // PUSHLFUNCALL k 0
+    vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                  vm.make<Symbol>("k"),
+                                  vm.list(vm.make<Symbol>("lambda"),
+                                          vm.list(),
+                                          vm.make<UIntegerType>(7)))));
+    Object func = lang->compile(vm.list(vm.make<Symbol>("k")));
+    REQUIRE(lang->getStatistics().pushlFuncall == 1u);
+    Object res = vm.eval(func);
+    REQUIRE(res.isA<UIntegerType>());
+    REQUIRE(res.as<UIntegerType>() == 7);
+  }
+  {
+    // (second (second 1 2) 3)
+    // PUSHL second, PUSHL second, PUSHV 1, PUSHVFUNCALL 2 2, PUSHVFUNCALL 3 2
+    Object func = lang->compile(vm.list(vm.make<Symbol>("second"),
+                                        vm.list(vm.make<Symbol>("second"),
+                                                vm.make<UIntegerType>(1),
+                                                vm.make<UIntegerType>(2)),
+                                        vm.make<UIntegerType>(3)));
+    REQUIRE(lang->getStatistics().pushvFuncall == 3u);
+    Object res = vm.eval(func);
+    REQUIRE(res.isA<UIntegerType>());
+    REQUIRE(res.as<UIntegerType>() == 3);
+  }
+}
+
+TEST_CASE("scm_redefine_global", "[Scheme]")
+{
+  // (define f (lambda (a b) a))
+  // (f 1 2) -> 1
+  // (define f (lambda (a b) b))
+  // (f 1 2) -> 2
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  Object funcall = lang->compile(vm.list(vm.make<Symbol>("f"),
+                                         vm.make<UIntegerType>(1),
+                                         vm.make<UIntegerType>(2)));
+  for(auto arg : {"a", "b"})
+  {
+    vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                  vm.make<Symbol>("f"),
+                                  vm.list(vm.make<Symbol>("lambda"),
+                                          vm.list(vm.make<Symbol>("a"),
+                                                  vm.make<Symbol>("b")),
+                                          vm.make<Symbol>(arg)))));
+    for(int i = 0; i < 2; i++)
+    {
+      Object res = vm.eval(funcall);
+      REQUIRE(res.isA<UIntegerType>());
+      REQUIRE(res.as<UIntegerType>() == (std::string(arg) == "a" ? 1 : 2));
+    }
+  }
+}
+
+TEST_CASE("scm_builtin_primitives", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  {
+    // (car (cons 1 2)) compiles to PUSHV2 1 2, CONS, CAR
+    Object func = lang->compile(vm.list(vm.make<Symbol>("car"),
+                                        vm.list(vm.make<Symbol>("cons"),
+                                                vm.make<UIntegerType>(1),
+                                                vm.make<UIntegerType>(2))));
+    std::stringstream ss;
+    func.as<Function>()->disassemble(ss);
+    REQUIRE(ss.str().find("CONS 2") != std::string::npos);
+    REQUIRE(ss.str().find("CAR 1") != std::string::npos);
+    REQUIRE(ss.str().find("FUNCALL") == std::string::npos);
+    Object res = vm.eval(func);
+    REQUIRE(res.isA<UIntegerType>());
+    REQUIRE(res.as<UIntegerType>() == 1u);
+  }
+  {
+    // (+ 1 2 3)
+    Object res = vm.eval(lang->compile(vm.list(vm.make<Symbol>("+"),
+                                               vm.make<UIntegerType>(1),
+                                               vm.make<UIntegerType>(2),
+                                               vm.make<UIntegerType>(3))));
+    REQUIRE(res.as<UIntegerType>() == 6u);
+  }
+  {
+    // (< 1 (- 5 2) 4)
+    Object res = vm.eval(lang->compile(vm.list(vm.make<Symbol>("<"),
+                                               vm.make<UIntegerType>(1),
+                                               vm.list(vm.make<Symbol>("-"),
+                                                       vm.make<UIntegerType>(5),
+                                                       vm.make<UIntegerType>(2)),
+                                               vm.make<UIntegerType>(4))));
+    REQUIRE(res.isA<Lisp::BooleanType>());
+    REQUIRE(res.as<Lisp::BooleanType>());
+  }
+  {
+    // (eq? (cdr (cons 1 2)) 2)
+    Object res = vm.eval(lang->compile(vm.list(vm.make<Symbol>("eq?"),
+                                               vm.list(vm.make<Symbol>("cdr"),
+                                                       vm.list(vm.make<Symbol>("cons"),
+                                                               vm.make<UIntegerType>(1),
+                                                               vm.make<UIntegerType>(2))),
+                                               vm.make<UIntegerType>(2))));
+    REQUIRE(res.as<Lisp::BooleanType>());
+  }
+  {
+    // ((lambda (car) (car 1 2)) (lambda (a b) b))
+    // car is a lambda argument, no primitive
+    Object func = lang->compile(vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                                vm.list(vm.make<Symbol>("car")),
+                                                vm.list(vm.make<Symbol>("car"),
+                                                        vm.make<UIntegerType>(1),
+                                                        vm.make<UIntegerType>(2))),
+                                        vm.list(vm.make<Symbol>("lambda"),
+                                                vm.list(vm.make<Symbol>("a"),
+                                                        vm.make<Symbol>("b")),
+                                                vm.make<Symbol>("b"))));
+    Object res = vm.eval(func);
+    REQUIRE(res.as<UIntegerType>() == 2u);
+  }
+  {
+    // ((lambda (f) (f 7 8)) cons): builtin passed as a value
+    Object res = vm.eval(lang->compile(vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                                       vm.list(vm.make<Symbol>("f")),
+                                                       vm.list(vm.make<Symbol>("f"),
+                                                               vm.make<UIntegerType>(7),
+                                                               vm.make<UIntegerType>(8))),
+                                               vm.make<Symbol>("cons"))));
+    REQUIRE(res.isA<Lisp::Cons>());
+    REQUIRE(res.as<Lisp::Cons>()->getCdrCell().as<UIntegerType>() == 8u);
+  }
+  {
+    // (car 1 2): arity does not match, compiled to a native call
+    Object func = lang->compile(vm.list(vm.make<Symbol>("car"),
+                                        vm.make<UIntegerType>(1),
+                                        vm.make<UIntegerType>(2)));
+    REQUIRE_THROWS_AS(vm.eval(func), Lisp::NonMatchingArguments);
+  }
+}
+
+TEST_CASE("scm_closures", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (define const (lambda (a) (lambda () a)))
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("const"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("a")),
+                                        vm.list(vm.make<Symbol>("lambda"),
+                                                vm.list(),
+                                                vm.make<Symbol>("a"))))));
+  {
+    std::stringstream ss;
+    vm.find("const").as<Function>()->disassemble(ss);
+    REQUIRE(ss.str().find("PUSHA 0") != std::string::npos);
+    REQUIRE(ss.str().find("CLOSURE") != std::string::npos);
+  }
+  // each closure has its own copy of a
+  Object c1 = vm.eval(lang->compile(vm.list(vm.make<Symbol>("const"),
+                                            vm.make<UIntegerType>(1))));
+  Object c2 = vm.eval(lang->compile(vm.list(vm.make<Symbol>("const"),
+                                            vm.make<UIntegerType>(2))));
+  REQUIRE(c1.isA<Closure>());
+  REQUIRE(c2.isA<Closure>());
+  REQUIRE(c1.as<Closure>()->getFunction() == c2.as<Closure>()->getFunction());
+  REQUIRE(vm.eval(c1).as<UIntegerType>() == 1u);
+  REQUIRE(vm.eval(c2).as<UIntegerType>() == 2u);
+  REQUIRE(vm.eval(lang->compile(vm.list(c2))).as<UIntegerType>() == 2u);
+
+  // ((lambda (a b) ((lambda (c) (+ a b c)) 3)) 1 2)
+  // arguments in nested expressions and captured values
+  Object res = vm.eval(lang->compile(
+                         vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                         vm.list(vm.make<Symbol>("a"),
+                                                 vm.make<Symbol>("b")),
+                                         vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                                         vm.list(vm.make<Symbol>("c")),
+                                                         vm.list(vm.make<Symbol>("+"),
+                                                                 vm.make<Symbol>("a"),
+                                                                 vm.make<Symbol>("b"),
+                                                                 vm.make<Symbol>("c"))),
+                                                 vm.make<UIntegerType>(3))),
+                                 vm.make<UIntegerType>(1),
+                                 vm.make<UIntegerType>(2))));
+  REQUIRE(res.isA<UIntegerType>());
+  REQUIRE(res.as<UIntegerType>() == 6u);
+}
+
+TEST_CASE("scm_stack_overflow", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  vm.setMaxStackSize(1000);
+  REQUIRE(vm.getMaxStackSize() == 1000u);
+  // (define f (lambda () (cons 1 (f))))
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("f"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(),
+                                        vm.list(vm.make<Symbol>("cons"),
+                                                vm.make<UIntegerType>(1),
+                                                vm.list(vm.make<Symbol>("f")))))));
+  REQUIRE_THROWS_AS(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f")))),
+                    Lisp::StackOverflow);
+  REQUIRE(vm.eval(lang->compile(vm.list(vm.make<Symbol>("+"),
+                                        vm.make<UIntegerType>(1),
+                                        vm.make<UIntegerType>(2)))).as<UIntegerType>() == 3u);
+}
+
+TEST_CASE("scm_call_cc", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (+ 1 (call/cc (lambda (k) 5)))
+  // normal return from the function
+  REQUIRE(vm.eval(lang->compile(
+                    vm.list(vm.make<Symbol>("+"),
+                            vm.make<UIntegerType>(1),
+                            vm.list(vm.make<Symbol>("call/cc"),
+                                    vm.list(vm.make<Symbol>("lambda"),
+                                            vm.list(vm.make<Symbol>("k")),
+                                            vm.make<UIntegerType>(5))))))
+          .as<UIntegerType>() == 6u);
+
+  // (+ 1 (call/cc (lambda (k) (+ 10 (k 2)))))
+  // early exit
+  {
+    Object func = lang->compile(
+        vm.list(vm.make<Symbol>("+"),
+                vm.make<UIntegerType>(1),
+                vm.list(vm.make<Symbol>("call/cc"),
+                        vm.list(vm.make<Symbol>("lambda"),
+                                vm.list(vm.make<Symbol>("k")),
+                                vm.list(vm.make<Symbol>("+"),
+                                        vm.make<UIntegerType>(10),
+                                        vm.list(vm.make<Symbol>("k"),
+                                                vm.make<UIntegerType>(2)))))));
+    std::stringstream ss;
+    func.as<Function>()->disassemble(ss);
+    REQUIRE(ss.str().find("CALLCC") != std::string::npos);
+    REQUIRE(vm.eval(func).as<UIntegerType>() == 3u);
+  }
+
+  // (define cc call-with-current-continuation)
+  // (+ 1 (cc (lambda (k) (k 4))))
+  // call/cc through a variable
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("cc"),
+                                vm.make<Symbol>("call-with-current-continuation"))));
+  REQUIRE(vm.eval(lang->compile(
+                    vm.list(vm.make<Symbol>("+"),
+                            vm.make<UIntegerType>(1),
+                            vm.list(vm.make<Symbol>("cc"),
+                                    vm.list(vm.make<Symbol>("lambda"),
+                                            vm.list(vm.make<Symbol>("k")),
+                                            vm.list(vm.make<Symbol>("k"),
+                                                    vm.make<UIntegerType>(4)))))))
+          .as<UIntegerType>() == 5u);
+
+  // (cons (cons 7 8) (call/cc (lambda (k) k)))
+  // re-entry after the expression has returned: the captured stack
+  // holds the only reference to (7 . 8)
+  Object res = vm.eval(lang->compile(
+      vm.list(vm.make<Symbol>("cons"),
+              vm.list(vm.make<Symbol>("cons"),
+                      vm.make<UIntegerType>(7),
+                      vm.make<UIntegerType>(8)),
+              vm.list(vm.make<Symbol>("call/cc"),
+                      vm.list(vm.make<Symbol>("lambda"),
+                              vm.list(vm.make<Symbol>("k")),
+                              vm.make<Symbol>("k"))))));
+  REQUIRE(res.isA<Cons>());
+  Object saved(res.as<Cons>()->getCdrCell());
+  REQUIRE(saved.isA<Lisp::CapturedContinuation>());
+  res = Lisp::nil;
+  vm.getAllocator()->cycle();
+  vm.getAllocator()->cycle();
+  // (saved i)
+  for(UIntegerType i = 2; i < 5; i++)
+  {
+    res = vm.eval(lang->compile(vm.list(saved, vm.make<UIntegerType>(i))));
+    REQUIRE(res.isA<Cons>());
+    REQUIRE(res.as<Cons>()->getCdrCell().as<UIntegerType>() == i);
+    const Lisp::Cell & inner = res.as<Cons>()->getCarCell();
+    REQUIRE(inner.isA<Cons>());
+    REQUIRE(inner.as<Cons>()->getCarCell().as<UIntegerType>() == 7u);
+    REQUIRE(inner.as<Cons>()->getCdrCell().as<UIntegerType>() == 8u);
+  }
+  REQUIRE_THROWS_AS(vm.eval(lang->compile(vm.list(saved,
+                                                  vm.make<UIntegerType>(1),
+                                                  vm.make<UIntegerType>(2)))),
+                    Lisp::NonMatchingArguments);
+}
+
+TEST_CASE("scm_define_names_lambda", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (define f (lambda (a) a))
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("f"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("a")),
+                                        vm.make<Symbol>("a")))));
+  REQUIRE(vm.find("f").as<Function>()->getName() == "f");
+  // (define g f)
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("g"),
+                                vm.make<Symbol>("f"))));
+  REQUIRE(vm.find("g").as<Function>()->getName() == "f");
+  // ((lambda (a) a) 1)
+  Object func = lang->compile(vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                              vm.list(vm.make<Symbol>("a")),
+                                              vm.make<Symbol>("a")),
+                                      vm.make<UIntegerType>(1)));
+  REQUIRE(func.as<Function>()->getName().empty());
+}
+
+TEST_CASE("scm_rest_arguments", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (define f (lambda (a . r) r))
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("f"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.make<Cons>(vm.make<Symbol>("a"),
+                                                      vm.make<Symbol>("r")),
+                                        vm.make<Symbol>("r")))));
+  REQUIRE(vm.find("f").as<Function>()->getMinArguments() == 1u);
+  REQUIRE(vm.find("f").as<Function>()->getMaxArguments() == Function::variadic);
+  // (f 1) -> ()
+  REQUIRE(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f"),
+                                        vm.make<UIntegerType>(1)))).isA<Lisp::Nil>());
+  // (f 1 2 3) -> (2 3)
+  REQUIRE(Lisp::equal(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f"),
+                                                    vm.make<UIntegerType>(1),
+                                                    vm.make<UIntegerType>(2),
+                                                    vm.make<UIntegerType>(3)))),
+                      vm.list(Object(2), Object(3))));
+  // (f)
+  REQUIRE_THROWS_AS(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f")))),
+                    Lisp::NonMatchingArguments);
+
+  // (define g (lambda (a #!rest r) a))
+  // the rest list is not built if r is not used
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("g"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("a"),
+                                                vm.make<Symbol>("#!rest"),
+                                                vm.make<Symbol>("r")),
+                                        vm.make<Symbol>("a")))));
+  {
+    std::stringstream ss;
+    vm.find("g").as<Function>()->disassemble(ss);
+    REQUIRE(ss.str().find("PUSHR") == std::string::npos);
+  }
+  REQUIRE(vm.eval(lang->compile(vm.list(vm.make<Symbol>("g"),
+                                        vm.make<UIntegerType>(1),
+                                        vm.make<UIntegerType>(2),
+                                        vm.make<UIntegerType>(3))))
+          .as<UIntegerType>() == 1u);
+
+  // (define h (lambda (a . r) (f a a a)))
+  // tail call of a function with rest parameter
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("h"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.make<Cons>(vm.make<Symbol>("a"),
+                                                      vm.make<Symbol>("r")),
+                                        vm.list(vm.make<Symbol>("f"),
+                                                vm.make<Symbol>("a"),
+                                                vm.make<Symbol>("a"),
+                                                vm.make<Symbol>("a"))))));
+  REQUIRE(Lisp::equal(vm.eval(lang->compile(vm.list(vm.make<Symbol>("h"),
+                                                    vm.make<UIntegerType>(4),
+                                                    vm.make<UIntegerType>(5)))),
+                      vm.list(Object(4), Object(4))));
+
+  // (((lambda r (lambda () r)) 1 2))
+  // all arguments are rest arguments, captured by a closure
+  REQUIRE(Lisp::equal(vm.eval(lang->compile(
+                                vm.list(vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                                        vm.make<Symbol>("r"),
+                                                        vm.list(vm.make<Symbol>("lambda"),
+                                                                vm.list(),
+                                                                vm.make<Symbol>("r"))),
+                                                vm.make<UIntegerType>(1),
+                                                vm.make<UIntegerType>(2))))),
+                      vm.list(Object(1), Object(2))));
+
+  // ((lambda r (eq? r r)) 1 2)
+  // the rest list is built once per frame
+  REQUIRE(vm.eval(lang->compile(
+                    vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                    vm.make<Symbol>("r"),
+                                    vm.list(vm.make<Symbol>("eq?"),
+                                            vm.make<Symbol>("r"),
+                                            vm.make<Symbol>("r"))),
+                            vm.make<UIntegerType>(1),
+                            vm.make<UIntegerType>(2))))
+          .as<Lisp::BooleanType>());
+
+  // ((lambda (a . r) (eq? r (car (f a r)))) 1 2 3)
+  // the rest list keeps its identity across a call
+  REQUIRE(vm.eval(lang->compile(
+                    vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                    vm.make<Cons>(vm.make<Symbol>("a"),
+                                                  vm.make<Symbol>("r")),
+                                    vm.list(vm.make<Symbol>("eq?"),
+                                            vm.make<Symbol>("r"),
+                                            vm.list(vm.make<Symbol>("car"),
+                                                    vm.list(vm.make<Symbol>("f"),
+                                                            vm.make<Symbol>("a"),
+                                                            vm.make<Symbol>("r"))))),
+                            vm.make<UIntegerType>(1),
+                            vm.make<UIntegerType>(2),
+                            vm.make<UIntegerType>(3))))
+          .as<Lisp::BooleanType>());
+}
+
+TEST_CASE("scm_optional_arguments", "[Scheme]")
+{
+  Vm vm;
+  Object langObj = vm.make<Language>();
+  Language * lang = langObj.as<Language>();
+  // (define f (lambda (a #!optional b) b))
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("f"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("a"),
+                                                vm.make<Symbol>("#!optional"),
+                                                vm.make<Symbol>("b")),
+                                        vm.make<Symbol>("b")))));
+  REQUIRE(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f"),
+                                        vm.make<UIntegerType>(1)))).isA<Lisp::Nil>());
+  REQUIRE(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f"),
+                                        vm.make<UIntegerType>(1),
+                                        vm.make<UIntegerType>(2))))
+          .as<UIntegerType>() == 2u);
+  REQUIRE_THROWS_AS(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f")))),
+                    Lisp::NonMatchingArguments);
+  REQUIRE_THROWS_AS(vm.eval(lang->compile(vm.list(vm.make<Symbol>("f"),
+                                                  vm.make<UIntegerType>(1),
+                                                  vm.make<UIntegerType>(2),
+                                                  vm.make<UIntegerType>(3)))),
+                    Lisp::NonMatchingArguments);
+
+  // ((lambda (a #!optional b . r) r) 1 2 3 4) -> (3 4)
+  REQUIRE(Lisp::equal(vm.eval(lang->compile(
+                                vm.list(vm.list(vm.make<Symbol>("lambda"),
+                                                vm.make<Cons>(vm.make<Symbol>("a"),
+                                                              vm.make<Cons>(vm.make<Symbol>("#!optional"),
+                                                                            vm.make<Cons>(vm.make<Symbol>("b"),
+                                                                                          vm.make<Symbol>("r")))),
+                                                vm.make<Symbol>("r")),
+                                        vm.make<UIntegerType>(1),
+                                        vm.make<UIntegerType>(2),
+                                        vm.make<UIntegerType>(3),
+                                        vm.make<UIntegerType>(4)))),
+                      vm.list(Object(3), Object(4))));
+
+  // (define g (lambda (a b) a))
+  // (g 1): arity error of a function with fixed arity
+  vm.eval(lang->compile(vm.list(vm.make<Symbol>("define"),
+                                vm.make<Symbol>("g"),
+                                vm.list(vm.make<Symbol>("lambda"),
+                                        vm.list(vm.make<Symbol>("a"),
+                                                vm.make<Symbol>("b")),
+                                        vm.make<Symbol>("a")))));
+  try
+  {
+    vm.eval(lang->compile(vm.list(vm.make<Symbol>("g"),
+                                  vm.make<UIntegerType>(1))));
+    FAIL("no exception");
+  }
+  catch(const Lisp::NonMatchingArguments & ex)
+  {
+    REQUIRE(ex.getNumArgumentsGiven() == 1u);
+    REQUIRE(std::string(ex.what()).find("The function g") == 0u);
+  }
+}